@@ -0,0 +1,313 @@
+/*
+   Copyright 2014 Boris T. Darchiev (boris.darchiev@gmail.com)
+                  Vasiliy Soshnikov (dedok.mad@gmail.com)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+// Throughput and call latency of loggers.
+//
+//   perf_logger [lines per thread] [max threads]
+//
+// Every logger is measured with 1, 2, 4 ... max threads (64 by default).
+// 'lines/s' is count of lines divided by time from start of producers
+// till logger is destroyed (so all lines are written). Percentiles are
+// of one NKIT_LOG_INFO() call.
+
+#include <nkit/logger_brief.h>
+#include <nkit/tools.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace nkit;
+
+static const size_t DEFAULT_LINES_PER_THREAD = 20000;
+static const size_t DEFAULT_MAX_THREADS = 64;
+
+static const char * const LOG_PATH = "./perf_logger.log";
+static const char * const SOCKET_PATH = "./perf_logger.sock";
+
+//------------------------------------------------------------------------------
+static uint64_t now_ns()
+{
+  timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return static_cast<uint64_t>(t.tv_sec) * 1000000000 + t.tv_nsec;
+}
+
+struct Producer
+{
+  Logger * logger_;
+  size_t id_;
+  size_t lines_;
+  volatile uint32_t * start_;
+  std::vector<uint64_t> latencies_;
+};
+
+static void * produce(void * arg)
+{
+  Producer * producer = static_cast<Producer *>(arg);
+  Logger * logger = producer->logger_;
+  producer->latencies_.resize(producer->lines_);
+
+  while (!detail::atomic_load(producer->start_))
+    detail::cpu_relax();
+
+  for (size_t i = 0; i < producer->lines_; ++i)
+  {
+    uint64_t begin = now_ns();
+    NKIT_LOG_INFO(logger << "perf line " << i << " of thread "
+        << producer->id_ << ", some payload to look like real line");
+    producer->latencies_[i] = now_ns() - begin;
+  }
+  return NULL;
+}
+
+//------------------------------------------------------------------------------
+// Creates new logger for each run, so every run starts with empty file
+typedef Logger::Ptr (*LoggerFactory)(std::string * error);
+
+static void remove_rotated(const std::string & path, void *)
+{
+  std::remove(path.c_str());
+}
+
+static Logger::Ptr create_console(std::string *)
+{
+  return ConsoleLogger::Create();
+}
+
+static Logger::Ptr create_rotate(std::string * error)
+{
+  std::remove(LOG_PATH);
+  return RotateLogger::Create(LOG_PATH, ROTATE_INTERVAL_DISABLED, -1, error);
+}
+
+static Logger::Ptr create_rotate_1m(std::string * error)
+{
+  std::remove(LOG_PATH);
+  RotateOptions options;
+  options.on_rotated = remove_rotated;
+  return RotateLogger::Create(LOG_PATH, ROTATE_INTERVAL_DISABLED,
+      ROTATE_SIZE_1M, options, error);
+}
+
+static Logger::Ptr create_async_rotate(std::string * error)
+{
+  Logger::Ptr target = create_rotate(error);
+  if (!target)
+    return target;
+  return AsyncLogger::Create(target, AsyncLogger::Options(), error);
+}
+
+static Logger::Ptr create_rsyslog(std::string * error)
+{
+  return RSysUnixSocketLogger::Create(LOG_USER, "perf_logger", SOCKET_PATH,
+      error);
+}
+
+//------------------------------------------------------------------------------
+// Unix datagram socket, which reads and drops everything sent to it
+class SyslogSink
+{
+public:
+  SyslogSink()
+    : fd_(-1)
+    , stop_(0)
+    , started_(false)
+  {}
+
+  ~SyslogSink()
+  {
+    if (started_)
+    {
+      detail::atomic_store(&stop_, uint32_t(1));
+      pthread_join(thread_, NULL);
+    }
+    if (fd_ >= 0)
+      close(fd_);
+    unlink(SOCKET_PATH);
+  }
+
+  bool Start(std::string * error)
+  {
+    unlink(SOCKET_PATH);
+    fd_ = socket(AF_UNIX, SOCK_DGRAM, 0);
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, SOCKET_PATH, sizeof(addr.sun_path) - 1);
+    if (fd_ < 0 ||
+        bind(fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0)
+    {
+      *error = "Could not bind syslog sink socket";
+      return false;
+    }
+
+    timeval timeout = {0, 100000};
+    setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    started_ = pthread_create(&thread_, NULL, Run, this) == 0;
+    if (!started_)
+      *error = "Could not start syslog sink thread";
+    return started_;
+  }
+
+private:
+  static void * Run(void * arg)
+  {
+    SyslogSink * sink = static_cast<SyslogSink *>(arg);
+    char buf[64 * 1024];
+    while (!detail::atomic_load(&sink->stop_))
+      recv(sink->fd_, buf, sizeof(buf), 0);
+    return NULL;
+  }
+
+private:
+  int fd_;
+  volatile uint32_t stop_;
+  pthread_t thread_;
+  bool started_;
+};
+
+//------------------------------------------------------------------------------
+static uint64_t percentile(const std::vector<uint64_t> & sorted, double p)
+{
+  size_t i = static_cast<size_t>(p * (sorted.size() - 1));
+  return sorted[i];
+}
+
+static bool run(const char * name, LoggerFactory factory, size_t threads,
+    size_t lines)
+{
+  std::string error;
+  Logger::Ptr logger = factory(&error);
+  if (!logger)
+  {
+    std::cerr << name << ": " << error << std::endl;
+    return false;
+  }
+
+  volatile uint32_t start = 0;
+  std::vector<Producer> producers(threads);
+  std::vector<pthread_t> ids(threads);
+  for (size_t i = 0; i < threads; ++i)
+  {
+    producers[i].logger_ = logger.get();
+    producers[i].id_ = i;
+    producers[i].lines_ = lines;
+    producers[i].start_ = &start;
+    if (pthread_create(&ids[i], NULL, produce, &producers[i]) != 0)
+      abort_with_core("Could not start producer thread");
+  }
+
+  uint64_t begin = now_ns();
+  detail::atomic_store(&start, uint32_t(1));
+  for (size_t i = 0; i < threads; ++i)
+    pthread_join(ids[i], NULL);
+  logger.reset();
+  uint64_t total_ns = now_ns() - begin;
+
+  std::vector<uint64_t> latencies;
+  latencies.reserve(threads * lines);
+  for (size_t i = 0; i < threads; ++i)
+    latencies.insert(latencies.end(), producers[i].latencies_.begin(),
+        producers[i].latencies_.end());
+  std::sort(latencies.begin(), latencies.end());
+
+  double lines_per_second = static_cast<double>(latencies.size()) * 1e9 /
+      static_cast<double>(total_ns ? total_ns : 1);
+
+  std::cerr << std::left << std::setw(22) << name << std::right
+      << std::setw(8) << threads
+      << std::setw(14) << static_cast<uint64_t>(lines_per_second)
+      << std::setw(12) << percentile(latencies, 0.5)
+      << std::setw(12) << percentile(latencies, 0.99)
+      << std::setw(12) << percentile(latencies, 0.999)
+      << std::endl;
+  return true;
+}
+
+// stdout of ConsoleLogger goes to /dev/null
+static bool run_console(size_t threads, size_t lines)
+{
+  std::cout.flush();
+  int saved = dup(STDOUT_FILENO);
+  int null = open("/dev/null", O_WRONLY);
+  dup2(null, STDOUT_FILENO);
+  close(null);
+
+  bool ok = run("console (/dev/null)", create_console, threads, lines);
+
+  std::cout.flush();
+  dup2(saved, STDOUT_FILENO);
+  close(saved);
+  return ok;
+}
+
+int main(int argc, char ** argv)
+{
+  size_t lines = DEFAULT_LINES_PER_THREAD;
+  size_t max_threads = DEFAULT_MAX_THREADS;
+  if (argc > 1)
+    lines = static_cast<size_t>(std::strtoul(argv[1], NULL, 10));
+  if (argc > 2)
+    max_threads = static_cast<size_t>(std::strtoul(argv[2], NULL, 10));
+  if (!lines || !max_threads)
+  {
+    std::cerr << "Usage: " << argv[0]
+        << " [lines per thread] [max threads]" << std::endl;
+    return 1;
+  }
+
+  std::string error;
+  SyslogSink sink;
+  if (!sink.Start(&error))
+  {
+    std::cerr << error << std::endl;
+    return 1;
+  }
+
+  // table goes to stderr, so console logger can be measured
+  std::cerr << std::left << std::setw(22) << "logger" << std::right
+      << std::setw(8) << "threads"
+      << std::setw(14) << "lines/s"
+      << std::setw(12) << "p50 ns"
+      << std::setw(12) << "p99 ns"
+      << std::setw(12) << "p999 ns"
+      << std::endl;
+
+  for (size_t threads = 1; threads <= max_threads; threads *= 2)
+  {
+    if (!run_console(threads, lines) ||
+        !run("rotate", create_rotate, threads, lines) ||
+        !run("rotate (1M rotation)", create_rotate_1m, threads, lines) ||
+        !run("async rotate", create_async_rotate, threads, lines) ||
+        !run("rsyslog unix socket", create_rsyslog, threads, lines))
+      return 1;
+  }
+
+  std::remove(LOG_PATH);
+  return 0;
+}
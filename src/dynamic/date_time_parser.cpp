@@ -0,0 +1,544 @@
+/*
+   Copyright 2014 Boris T. Darchiev (boris.darchiev@gmail.com)
+                  Vasiliy Soshnikov (dedok.mad@gmail.com)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "nkit/date_time_parser.h"
+#include "nkit/threading/once.h"
+#include "nkit/threading/rw_lock.h"
+
+#include <clocale>
+#include <cstring>
+#include <map>
+
+namespace nkit
+{
+  namespace detail
+  {
+    static const char * const MONTH_NAMES[12] = {"January", "February",
+        "March", "April", "May", "June", "July", "August", "September",
+        "October", "November", "December"};
+
+    static const char * const WEEKDAY_NAMES[7] = {"Sunday", "Monday",
+        "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday"};
+
+    inline bool is_space(char c)
+    {
+      return c == ' ' || (c >= '\t' && c <= '\r');
+    }
+
+    inline bool is_digit(char c)
+    {
+      return c >= '0' && c <= '9';
+    }
+
+    // Exactly 'count' digits
+    inline bool fixed_digits(const char * str, size_t count, uint32_t * out)
+    {
+      uint32_t value = 0;
+      for (size_t i = 0; i < count; ++i)
+      {
+        if (!is_digit(str[i]))
+          return false;
+        value = value * 10 + static_cast<uint32_t>(str[i] - '0');
+      }
+      *out = value;
+      return true;
+    }
+
+    // Number as glibc strptime() reads it: spaces are skipped, at most
+    // 'max_digits' digits are taken while value can stay not above 'to'
+    inline bool read_number(const char ** pos, const char * end,
+        uint32_t from, uint32_t to, uint32_t max_digits, uint32_t * out)
+    {
+      const char * p = *pos;
+      while (p < end && is_space(*p))
+        ++p;
+      if (p == end || !is_digit(*p))
+        return false;
+
+      uint32_t value = 0;
+      do
+      {
+        value = value * 10 + static_cast<uint32_t>(*p++ - '0');
+      } while (--max_digits > 0 && value * 10 <= to && p < end &&
+          is_digit(*p));
+
+      if (value < from || value > to)
+        return false;
+      *pos = p;
+      *out = value;
+      return true;
+    }
+
+    // Full name first, then its first three letters, case is ignored
+    static bool read_name(const char ** pos, const char * end,
+        const char * const * names, size_t count, uint32_t * index)
+    {
+      size_t rest = static_cast<size_t>(end - *pos);
+      for (size_t i = 0; i < count; ++i)
+      {
+        size_t length = strlen(names[i]);
+        if (length <= rest && NKIT_STRNCASECMP(*pos, names[i], length) == 0)
+        {
+          *pos += length;
+          *index = static_cast<uint32_t>(i);
+          return true;
+        }
+      }
+      for (size_t i = 0; i < count; ++i)
+      {
+        if (3 <= rest && NKIT_STRNCASECMP(*pos, names[i], 3) == 0)
+        {
+          *pos += 3;
+          *index = static_cast<uint32_t>(i);
+          return true;
+        }
+      }
+      return false;
+    }
+
+    static bool is_c_time_locale()
+    {
+      const char * locale = setlocale(LC_TIME, NULL);
+      return !locale || strcmp(locale, "C") == 0 ||
+          strcmp(locale, "POSIX") == 0;
+    }
+
+    //--------------------------------------------------------------------------
+    struct CStringLess
+    {
+      bool operator() (const char * a, const char * b) const
+      {
+        return strcmp(a, b) < 0;
+      }
+    };
+
+    // Keys point to format_ of parsers
+    typedef std::map<const char *, DateTimeParser::Ptr, CStringLess>
+        DateTimeParserMap;
+
+    struct DateTimeParserCache
+    {
+      RWLock lock_;
+      DateTimeParserMap parsers_;
+    };
+
+    static Once date_time_parser_cache_once_ = NKIT_ONCE_INIT;
+    static DateTimeParserCache * date_time_parser_cache_ = NULL;
+
+    // Last parser used by thread, most of imports use one format per column
+    static NKIT_THREAD_LOCAL const DateTimeParser * last_date_time_parser_ =
+        NULL;
+
+    static void create_date_time_parser_cache()
+    {
+      date_time_parser_cache_ = new DateTimeParserCache;
+    }
+  } // namespace detail
+
+  //----------------------------------------------------------------------------
+  bool parse_iso8601(const char * str, size_t size, DateTimeFields * out)
+  {
+    return detail::parse_date_time(str, size, 'T', out);
+  }
+
+  // First 19 characters of str: "YYYY-MM-DD<separator>hh:mm:ss"
+  static bool parse_dashed_date_time(const char * str, char separator,
+      DateTimeFields * fields)
+  {
+    return str[4] == '-' && str[7] == '-' && str[10] == separator &&
+        str[13] == ':' && str[16] == ':' &&
+        detail::fixed_digits(str, 4, &fields->year) &&
+        detail::fixed_digits(str + 5, 2, &fields->month) &&
+        detail::fixed_digits(str + 8, 2, &fields->day) &&
+        detail::fixed_digits(str + 11, 2, &fields->hour) &&
+        detail::fixed_digits(str + 14, 2, &fields->minute) &&
+        detail::fixed_digits(str + 17, 2, &fields->second);
+  }
+
+  // "YYYY-MM-DD hh:mm:ss" exactly
+  bool detail::parse_default_date_time(const char * str, size_t size,
+      DateTimeFields * out)
+  {
+    DateTimeFields fields;
+    if (size != 19 || !parse_dashed_date_time(str, ' ', &fields))
+      return false;
+    *out = fields;
+    return true;
+  }
+
+  // "YYYY-MM-DD<separator>hh:mm:ss" or "YYYYMMDD<separator>hhmmss"
+  bool detail::parse_date_time(const char * str, size_t size, char separator,
+      DateTimeFields * out)
+  {
+    size_t length;
+    DateTimeFields fields;
+    if (size >= 19 && str[4] == '-')
+    {
+      if (!parse_dashed_date_time(str, separator, &fields))
+        return false;
+      length = 19;
+    }
+    else if (size >= 15)
+    {
+      if (str[8] != separator ||
+          !detail::fixed_digits(str, 4, &fields.year) ||
+          !detail::fixed_digits(str + 4, 2, &fields.month) ||
+          !detail::fixed_digits(str + 6, 2, &fields.day) ||
+          !detail::fixed_digits(str + 9, 2, &fields.hour) ||
+          !detail::fixed_digits(str + 11, 2, &fields.minute) ||
+          !detail::fixed_digits(str + 13, 2, &fields.second))
+        return false;
+      length = 15;
+    }
+    else
+      return false;
+
+    if (length < size && (str[length] == '.' || str[length] == ','))
+    {
+      size_t digits = 0;
+      uint32_t scale = 100000;
+      while (++length < size && detail::is_digit(str[length]))
+      {
+        if (++digits > 6)
+          return false;
+        fields.microsec += static_cast<uint32_t>(str[length] - '0') * scale;
+        scale /= 10;
+      }
+      if (!digits)
+        return false;
+    }
+
+    if (length < size && str[length] == 'Z')
+      ++length;
+    if (length != size)
+      return false;
+
+    *out = fields;
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  DateTimeParser::Ptr DateTimeParser::Create(const std::string & format)
+  {
+    return Ptr(new DateTimeParser(format));
+  }
+
+  const DateTimeParser & DateTimeParser::Get(const char * format)
+  {
+    const DateTimeParser * last = detail::last_date_time_parser_;
+    if (likely(last && strcmp(last->format_.c_str(), format) == 0))
+      return *last;
+
+    CallOnce(&detail::date_time_parser_cache_once_,
+        detail::create_date_time_parser_cache);
+    detail::DateTimeParserCache * cache = detail::date_time_parser_cache_;
+
+    const DateTimeParser * parser = NULL;
+    {
+      ReadLockGuard<RWLock> guard(cache->lock_);
+      detail::DateTimeParserMap::const_iterator it =
+          cache->parsers_.find(format);
+      if (it != cache->parsers_.end())
+        parser = it->second.get();
+    }
+
+    if (!parser)
+    {
+      LockGuard<RWLock> guard(cache->lock_);
+      detail::DateTimeParserMap::const_iterator it =
+          cache->parsers_.find(format);
+      if (it != cache->parsers_.end())
+        parser = it->second.get();
+      else
+      {
+        Ptr created = Create(format);
+        cache->parsers_[created->format_.c_str()] = created;
+        parser = created.get();
+      }
+    }
+
+    detail::last_date_time_parser_ = parser;
+    return *parser;
+  }
+
+  DateTimeParser::DateTimeParser(const std::string & format)
+    : format_(format)
+    , fixed_size_(0)
+    , fallback_(false)
+  {
+    Compile();
+  }
+
+  void DateTimeParser::Add(StepKind kind, char literal)
+  {
+    // sequence of spaces in format matches any count of spaces
+    if (kind == STEP_SPACES && !steps_.empty() &&
+        steps_.back().kind_ == STEP_SPACES)
+      return;
+    steps_.push_back(Step(kind, literal));
+  }
+
+  void DateTimeParser::AddNumber(uint32_t DateTimeFields::* field,
+      uint32_t from, uint32_t to, uint32_t digits)
+  {
+    steps_.push_back(Step(field, from, to, digits));
+  }
+
+  void DateTimeParser::Compile()
+  {
+    bool c_locale = detail::is_c_time_locale();
+    for (const char * f = format_.c_str(); *f; ++f)
+    {
+      if (detail::is_space(*f))
+      {
+        Add(STEP_SPACES);
+        continue;
+      }
+
+      if (*f != '%')
+      {
+        Add(STEP_LITERAL, *f);
+        continue;
+      }
+
+      switch (*++f)
+      {
+      case '%': Add(STEP_LITERAL, '%'); break;
+      case 'n':
+      case 't': Add(STEP_SPACES); break;
+      case 'Y': AddNumber(&DateTimeFields::year, 0, 9999, 4); break;
+      case 'y': Add(STEP_YEAR2); break;
+      case 'm': AddNumber(&DateTimeFields::month, 1, 12, 2); break;
+      case 'd':
+      case 'e': AddNumber(&DateTimeFields::day, 1, 31, 2); break;
+      case 'H':
+      case 'k': AddNumber(&DateTimeFields::hour, 0, 23, 2); break;
+      case 'I':
+      case 'l': Add(STEP_HOUR12); break;
+      case 'M': AddNumber(&DateTimeFields::minute, 0, 59, 2); break;
+      case 'S': AddNumber(&DateTimeFields::second, 0, 61, 2); break;
+      case 'T':
+        AddNumber(&DateTimeFields::hour, 0, 23, 2);
+        Add(STEP_LITERAL, ':');
+        AddNumber(&DateTimeFields::minute, 0, 59, 2);
+        Add(STEP_LITERAL, ':');
+        AddNumber(&DateTimeFields::second, 0, 61, 2);
+        break;
+      case 'R':
+        AddNumber(&DateTimeFields::hour, 0, 23, 2);
+        Add(STEP_LITERAL, ':');
+        AddNumber(&DateTimeFields::minute, 0, 59, 2);
+        break;
+      case 'D':
+        AddNumber(&DateTimeFields::month, 1, 12, 2);
+        Add(STEP_LITERAL, '/');
+        AddNumber(&DateTimeFields::day, 1, 31, 2);
+        Add(STEP_LITERAL, '/');
+        Add(STEP_YEAR2);
+        break;
+      case 'F':
+        AddNumber(&DateTimeFields::year, 0, 9999, 4);
+        Add(STEP_LITERAL, '-');
+        AddNumber(&DateTimeFields::month, 1, 12, 2);
+        Add(STEP_LITERAL, '-');
+        AddNumber(&DateTimeFields::day, 1, 31, 2);
+        break;
+      case 'b':
+      case 'B':
+      case 'h':
+        if (!c_locale)
+          goto fallback;
+        Add(STEP_MONTH_NAME);
+        break;
+      case 'a':
+      case 'A':
+        if (!c_locale)
+          goto fallback;
+        Add(STEP_WEEKDAY_NAME);
+        break;
+      case 'p':
+        if (!c_locale)
+          goto fallback;
+        Add(STEP_AM_PM);
+        break;
+      default:
+        // time zones, week numbers, E and O modifiers, '%' at the end
+        goto fallback;
+      }
+    }
+
+    // "%Y-%m-%d %H:%M:%S" and alike have fixed layout
+    for (std::vector<Step>::const_iterator step = steps_.begin();
+        step != steps_.end(); ++step)
+    {
+      if (step->kind_ == STEP_NUMBER)
+        fixed_size_ += step->digits_;
+      else if (step->kind_ == STEP_LITERAL || step->kind_ == STEP_SPACES)
+        ++fixed_size_;
+      else
+      {
+        fixed_size_ = 0;
+        break;
+      }
+    }
+    return;
+
+  fallback:
+    steps_.clear();
+    fallback_ = true;
+  }
+
+  bool DateTimeParser::Parse(const char * str, size_t size,
+      DateTimeFields * out) const
+  {
+    if (fallback_)
+      return Strptime(str, size, out);
+
+    if (fixed_size_ && size >= fixed_size_ && ParseFixed(str, out))
+      return true;
+
+    DateTimeFields fields;
+    const char * p = str;
+    const char * end = str + size;
+    bool hour12 = false;
+    bool pm = false;
+    uint32_t value;
+
+    for (std::vector<Step>::const_iterator step = steps_.begin();
+        step != steps_.end(); ++step)
+    {
+      switch (step->kind_)
+      {
+      case STEP_LITERAL:
+        if (p == end || *p != step->literal_)
+          return false;
+        ++p;
+        break;
+      case STEP_SPACES:
+        while (p < end && detail::is_space(*p))
+          ++p;
+        break;
+      case STEP_NUMBER:
+        if (!detail::read_number(&p, end, step->from_, step->to_,
+            step->digits_, &(fields.*step->field_)))
+          return false;
+        // %H after %I
+        if (step->field_ == &DateTimeFields::hour)
+          hour12 = false;
+        break;
+      case STEP_YEAR2:
+        if (!detail::read_number(&p, end, 0, 99, 2, &value))
+          return false;
+        fields.year = value >= 69 ? 1900 + value : 2000 + value;
+        break;
+      case STEP_HOUR12:
+        if (!detail::read_number(&p, end, 1, 12, 2, &value))
+          return false;
+        fields.hour = value % 12;
+        hour12 = true;
+        break;
+      case STEP_AM_PM:
+        if (end - p < 2 || (p[1] != 'M' && p[1] != 'm'))
+          return false;
+        if (*p == 'P' || *p == 'p')
+          pm = true;
+        else if (*p == 'A' || *p == 'a')
+          pm = false;
+        else
+          return false;
+        p += 2;
+        break;
+      case STEP_MONTH_NAME:
+        if (!detail::read_name(&p, end, detail::MONTH_NAMES, 12, &value))
+          return false;
+        fields.month = value + 1;
+        break;
+      case STEP_WEEKDAY_NAME:
+        // week day does not change date
+        if (!detail::read_name(&p, end, detail::WEEKDAY_NAMES, 7, &value))
+          return false;
+        break;
+      }
+    }
+
+    if (hour12 && pm)
+      fields.hour += 12;
+    *out = fields;
+    return true;
+  }
+
+  // Numbers with all their digits at fixed positions, one space for each
+  // sequence of spaces. Anything else is left to Parse(). Numbers in range
+  // are read by strptime() in the same way, so result is the same. Caller
+  // checks that 'str' has fixed_size_ chars.
+  bool DateTimeParser::ParseFixed(const char * str, DateTimeFields * out) const
+  {
+    DateTimeFields fields;
+    const char * p = str;
+    for (std::vector<Step>::const_iterator step = steps_.begin();
+        step != steps_.end(); ++step)
+    {
+      if (step->kind_ == STEP_NUMBER)
+      {
+        uint32_t value;
+        if (!detail::fixed_digits(p, step->digits_, &value) ||
+            value < step->from_ || value > step->to_)
+          return false;
+        fields.*step->field_ = value;
+        p += step->digits_;
+      }
+      else if (step->kind_ == STEP_LITERAL ? *p != step->literal_ :
+          !detail::is_space(*p))
+        return false;
+      else
+        ++p;
+    }
+    *out = fields;
+    return true;
+  }
+
+  Dynamic DateTimeParser::Parse(const std::string & str) const
+  {
+    DateTimeFields fields;
+    if (!Parse(str.data(), str.size(), &fields))
+      return Dynamic();
+    return Dynamic(fields.year, fields.month, fields.day, fields.hour,
+        fields.minute, fields.second, fields.microsec);
+  }
+
+  bool DateTimeParser::Strptime(const char * str, size_t size,
+      DateTimeFields * out) const
+  {
+#ifdef NKIT_WINNT
+    struct tm _tm = { 0, 0, 0, 0, 0, 0, 0, 0, 0};
+#else
+    struct tm _tm = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+#endif
+    std::string terminated(str, size);
+    if (NKIT_STRPTIME(terminated.c_str(), format_.c_str(), &_tm) == NULL)
+      return false;
+
+    out->year = static_cast<uint32_t>(_tm.tm_year + 1900);
+    out->month = static_cast<uint32_t>(_tm.tm_mon + 1);
+    out->day = static_cast<uint32_t>(_tm.tm_mday);
+    out->hour = static_cast<uint32_t>(_tm.tm_hour);
+    out->minute = static_cast<uint32_t>(_tm.tm_min);
+    out->second = static_cast<uint32_t>(_tm.tm_sec);
+    out->microsec = 0;
+    return true;
+  }
+} // namespace nkit
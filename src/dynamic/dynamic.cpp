@@ -19,6 +19,7 @@
 #include <iomanip>
 
 #include "nkit/dynamic.h"
+#include "nkit/date_time_parser.h"
 #include "nkit/logger.h"
 #include "nkit/tools.h"
 #include "nkit/transcode.h"
@@ -37,9 +38,6 @@ namespace nkit
     const DynamicVector ConstVectorAdapter::empty_list_;
     DynamicVector VectorAdapter::empty_list_;
 
-    const StringDynamicMap ConstMapAdapter::empty_map_;
-    StringDynamicMap MapAdapter::empty_map_;
-
     Data GetDefaultData(uint64_t type)
     {
       return Operation<OP_GET_DEFAULT_DATA>::farray[type]();
@@ -268,6 +266,30 @@ namespace nkit
     return detail::Operation<detail::OP_CLONE>::farray[type_](data_);
   }
 
+  Dynamic & Dynamic::Freeze()
+  {
+    detail::Operation<detail::OP_FREEZE_DATA>::farray[type_](data_);
+    return *this;
+  }
+
+  bool Dynamic::IsFrozen() const
+  {
+    switch (type_)
+    {
+    case detail::STRING:
+    case detail::MONGODB_OID:
+      return data_.shared_string_->frozen();
+    case detail::LIST:
+      return data_.shared_vector_->frozen();
+    case detail::DICT:
+      return data_.shared_map_->frozen();
+    case detail::TABLE:
+      return data_.shared_table_->frozen();
+    default:
+      return true;
+    }
+  }
+
   Dynamic Dynamic::GetDefault(int64_t type)
   {
     switch (type)
@@ -464,72 +486,43 @@ namespace nkit
     return Dynamic(year, month, day, hour, min, sec);
   }
 
-  bool make_date_time_from_string(const std::string & str,
-      const std::string & example, const char * const format,
-      Dynamic * out, std::string * const error)
+  static Dynamic make_date_time(bool parsed, const DateTimeFields & fields,
+      const std::string & str, std::string * const error)
   {
     static const std::string WRONG_VALUES("Wrong date-time value: ");
 
-    if (str.size() != example.size())
-    {
-      *error = WRONG_VALUES + str;
-      return false;
-    }
-
-    uint32_t year, mon, dd, hh, mm, ss;
-    if (NKIT_SSCANF(str.c_str(), format, &year, &mon, &dd, &hh, &mm, &ss) != 6)
-    {
-      *error = WRONG_VALUES + str;
-      return false;
-    }
-
-    *out = Dynamic(year, mon, dd, hh, mm, ss, 0);
-    if (!*out)
-    {
+    Dynamic result;
+    if (parsed)
+      result = Dynamic(fields.year, fields.month, fields.day, fields.hour,
+          fields.minute, fields.second, fields.microsec);
+    if (!result)
       *error = WRONG_VALUES + str;
-      return false;
-    }
-    return true;
+    return result;
   }
 
   Dynamic Dynamic::DateTimeFromDefault(const std::string & str,
       std::string * const error)
   {
-    static const char * const FORMAT = "%4u-%02u-%02u %02u:%02u:%02u";
-    static const std::string EXAMPLE("1998-07-17 14:08:55");
-    Dynamic result;
-    make_date_time_from_string(str, EXAMPLE, FORMAT, &result, error);
-    return result;
+    // "1998-07-17 14:08:55"
+    DateTimeFields fields;
+    bool parsed = detail::parse_default_date_time(str.data(), str.size(),
+        &fields);
+    return make_date_time(parsed, fields, str, error);
   }
 
   Dynamic Dynamic::DateTimeFromISO8601(const std::string & str,
       std::string * const error)
   {
-    static const char * const FORMAT1 = "%4u-%02u-%02uT%02u:%02u:%02u";
-    static const std::string EXAMPLE1("1998-07-17T14:08:55");
-
-    static const char * const FORMAT2 = "%4u%02u%02uT%02u%02u%02u";
-    static const std::string EXAMPLE2("19980717T140855");
-
-    Dynamic result;
-    if (str[4] == '-')
-      make_date_time_from_string(str, EXAMPLE1, FORMAT1, &result, error);
-    else
-      make_date_time_from_string(str, EXAMPLE2, FORMAT2, &result, error);
-    return result;
+    // "1998-07-17T14:08:55" or "19980717T140855"
+    DateTimeFields fields;
+    bool parsed = parse_iso8601(str.data(), str.size(), &fields);
+    return make_date_time(parsed, fields, str, error);
   }
 
   Dynamic Dynamic::DateTimeFromString(const std::string & str,
       const char * format)
   {
-#ifdef NKIT_WINNT
-    struct tm _tm = { 0, 0, 0, 0, 0, 0, 0, 0, 0};
-#else
-    struct tm _tm = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
-#endif
-    if (NKIT_STRPTIME(str.c_str(), format, &_tm) == NULL)
-      return Dynamic();
-    return DateTimeFromTm(_tm);
+    return DateTimeParser::Get(format).Parse(str);
   }
 
   Dynamic Dynamic::List()
@@ -955,12 +948,12 @@ namespace nkit
 
   Dynamic & Dynamic::operator[](const char * const key)
   {
-    return Get(std::string(key));
+    return Get(key);
   }
 
   const Dynamic & Dynamic::operator[](const char * const key) const
   {
-    return Get(std::string(key));
+    return Get(key);
   }
 
   Dynamic & Dynamic::Get(const char * key)
@@ -977,6 +970,13 @@ namespace nkit
     return D_NONE;
   }
 
+  Dynamic & Dynamic::GetInterned(const char * key, size_t size)
+  {
+    if (IsDict())
+      return detail::Impl<detail::DICT>::GetInterned(*this, key, size);
+    return D_NONE;
+  }
+
   const Dynamic & Dynamic::Get(const std::string & key) const
   {
     if (IsDict())
@@ -1380,6 +1380,20 @@ namespace nkit
     return D_NONE;
   }
 
+  const detail::Data * Dynamic::GetRowData(const size_t row_num) const
+  {
+    if (IsTable())
+      return detail::Impl<detail::TABLE>::GetRowData(*this, row_num);
+    return NULL;
+  }
+
+  detail::DynamicTypeVector Dynamic::GetColumnTypeIds() const
+  {
+    if (IsTable())
+      return detail::Impl<detail::TABLE>::GetColumnTypeIds(*this);
+    return detail::DynamicTypeVector();
+  }
+
   void Dynamic::JoinColumnCells(const size_t col, const std::string & delimiter,
       std::string * out) const
   {
@@ -0,0 +1,175 @@
+/*
+   Copyright 2010-2015 Boris T. Darchiev (boris.darchiev@gmail.com)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "nkit/dynamic/arena.h"
+#include "nkit/tools.h"
+#include "nkit/detail/atomic.h"
+
+#include <cstdlib>
+
+namespace nkit
+{
+  namespace detail
+  {
+    //--------------------------------------------------------------------------
+    // Every chunk returned by DynamicArena::Allocate() is prefixed with
+    // a header, pointing to the owner arena (NULL for heap chunks)
+    union ArenaChunkHeader
+    {
+      ArenaBlocks * arena_;
+      int64_t align_i64_;
+      double align_f_;
+      void * align_ptr_;
+    };
+
+    static const size_t HEADER_SIZE = sizeof(ArenaChunkHeader);
+
+    inline size_t align_size(size_t size)
+    {
+      return (size + HEADER_SIZE - 1) & ~(HEADER_SIZE - 1);
+    }
+
+    //--------------------------------------------------------------------------
+    class ArenaBlocks
+    {
+    public:
+      explicit ArenaBlocks(size_t block_size)
+        : block_size_(align_size(block_size < 1024 ? 1024 : block_size))
+        , big_chunk_size_(block_size_ / 4)
+        , cur_(NULL)
+        , end_(NULL)
+        , refcount_(1)
+        , allocated_bytes_(0)
+      {}
+
+      ~ArenaBlocks()
+      {
+        std::vector<char *>::iterator block = blocks_.begin(),
+            end = blocks_.end();
+        for (; block != end; ++block)
+          ::free(*block);
+      }
+
+      // 'size' includes header and is aligned
+      void * Allocate(size_t size)
+      {
+        if (unlikely(size > big_chunk_size_))
+          return NULL;
+
+        if (unlikely(static_cast<size_t>(end_ - cur_) < size))
+        {
+          char * block = static_cast<char *>(::malloc(block_size_));
+          if (unlikely(!block))
+            throw std::bad_alloc();
+          blocks_.push_back(block);
+          cur_ = block;
+          end_ = block + block_size_;
+        }
+
+        void * result = cur_;
+        cur_ += size;
+        allocated_bytes_ += size;
+        atomic_add(&refcount_, uint64_t(1));
+        return result;
+      }
+
+      void Release()
+      {
+        if (atomic_sub(&refcount_, uint64_t(1)) == 0)
+          delete this;
+      }
+
+      size_t block_count() const { return blocks_.size(); }
+      size_t allocated_bytes() const { return allocated_bytes_; }
+
+    private:
+      const size_t block_size_;
+      const size_t big_chunk_size_;
+      std::vector<char *> blocks_;
+      char * cur_;
+      char * end_;
+      // Live chunks + 1 for DynamicArena object. Chunks of frozen values
+      // may be released by other threads while arena still allocates.
+      volatile uint64_t refcount_;
+      size_t allocated_bytes_;
+    };
+
+    static NKIT_THREAD_LOCAL ArenaBlocks * current_arena_ = NULL;
+  } // namespace detail
+
+  //----------------------------------------------------------------------------
+  DynamicArena::DynamicArena(size_t block_size)
+    : blocks_(new detail::ArenaBlocks(block_size))
+  {}
+
+  DynamicArena::~DynamicArena()
+  {
+    blocks_->Release();
+  }
+
+  size_t DynamicArena::block_count() const
+  {
+    return blocks_->block_count();
+  }
+
+  size_t DynamicArena::allocated_bytes() const
+  {
+    return blocks_->allocated_bytes();
+  }
+
+  void * DynamicArena::Allocate(size_t size)
+  {
+    size = detail::align_size(size + detail::HEADER_SIZE);
+    detail::ArenaBlocks * arena = detail::current_arena_;
+    void * chunk = arena ? arena->Allocate(size) : NULL;
+    if (!chunk)
+    {
+      arena = NULL;
+      chunk = ::malloc(size);
+      if (unlikely(!chunk))
+        throw std::bad_alloc();
+    }
+
+    static_cast<detail::ArenaChunkHeader *>(chunk)->arena_ = arena;
+    return static_cast<char *>(chunk) + detail::HEADER_SIZE;
+  }
+
+  void DynamicArena::Deallocate(void * ptr)
+  {
+    if (!ptr)
+      return;
+    detail::ArenaChunkHeader * header =
+        reinterpret_cast<detail::ArenaChunkHeader *>(
+            static_cast<char *>(ptr) - detail::HEADER_SIZE);
+    if (header->arena_)
+      header->arena_->Release();
+    else
+      ::free(header);
+  }
+
+  //----------------------------------------------------------------------------
+  DynamicArena::Scope::Scope(DynamicArena * arena)
+    : prev_(detail::current_arena_)
+  {
+    if (arena)
+      detail::current_arena_ = arena->blocks_;
+  }
+
+  DynamicArena::Scope::~Scope()
+  {
+    detail::current_arena_ = prev_;
+  }
+} // namespace nkit
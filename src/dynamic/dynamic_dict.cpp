@@ -0,0 +1,333 @@
+/*
+   Copyright 2010-2015 Boris T. Darchiev (boris.darchiev@gmail.com)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "nkit/dynamic.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+namespace nkit
+{
+  namespace detail
+  {
+    //--------------------------------------------------------------------------
+    struct EntryKeyLess
+    {
+      explicit EntryKeyLess(DictEntry * const * segments)
+        : segments_(segments)
+      {}
+
+      bool operator ()(uint32_t a, uint32_t b) const
+      {
+        return dict_entry(segments_, a).key() < dict_entry(segments_, b).key();
+      }
+
+      DictEntry * const * segments_;
+    };
+
+    template <typename T>
+    inline T * allocate_array(size_t count)
+    {
+      return static_cast<T *>(DynamicArena::Allocate(count * sizeof(T)));
+    }
+
+    inline size_t segment_size(size_t segment)
+    {
+      return segment ? size_t(2) << segment : 4;
+    }
+
+    //--------------------------------------------------------------------------
+    void DynamicDict::clear()
+    {
+      for (size_t pos = 0; pos < count_; ++pos)
+      {
+        DictEntry & entry = Entry(pos);
+        if (entry.key_)
+          DestroyEntry(entry);
+      }
+      for (size_t i = 0; i < segment_count_; ++i)
+        DynamicArena::Deallocate(segments_[i]);
+      DynamicArena::Deallocate(segments_);
+      DynamicArena::Deallocate(index_);
+      DynamicArena::Deallocate(order_);
+      segments_ = NULL;
+      index_ = NULL;
+      order_ = NULL;
+      segment_count_ = segments_capacity_ = count_ = size_ = index_mask_ = 0;
+    }
+
+    void DynamicDict::DestroyEntry(DictEntry & entry)
+    {
+      entry.value_.~Dynamic();
+      if (entry.key_ & DictEntry::OWNED_KEY)
+        delete &entry.key();
+      entry.key_ = 0;
+      entry.hash_ = 0;
+    }
+
+    void DynamicDict::AddSegment()
+    {
+      if (segment_count_ == segments_capacity_)
+      {
+        size_t capacity = segments_capacity_ ? segments_capacity_ * 2 : 4;
+        DictEntry ** segments = allocate_array<DictEntry *>(capacity);
+        if (segment_count_)
+          std::memcpy(segments, segments_,
+              segment_count_ * sizeof(DictEntry *));
+        DynamicArena::Deallocate(segments_);
+        segments_ = segments;
+        segments_capacity_ = capacity;
+      }
+
+      segments_[segment_count_] =
+          allocate_array<DictEntry>(segment_size(segment_count_));
+      ++segment_count_;
+
+      // big dict sorts its keys on demand
+      if (index_)
+        return;
+      uint32_t * order = allocate_array<uint32_t>(capacity());
+      if (order_ && size_)
+        std::memcpy(order, order_, size_ * sizeof(uint32_t));
+      DynamicArena::Deallocate(order_);
+      order_ = order;
+    }
+
+    void DynamicDict::BuildIndex(size_t capacity)
+    {
+      DynamicArena::Deallocate(index_);
+      index_ = allocate_array<uint32_t>(capacity);
+      std::memset(index_, 0, capacity * sizeof(uint32_t));
+      index_mask_ = capacity - 1;
+      for (size_t pos = 0; pos < count_; ++pos)
+      {
+        const DictEntry & entry = Entry(pos);
+        if (!entry.key_)
+          continue;
+        size_t slot = static_cast<size_t>(entry.hash_) & index_mask_;
+        while (index_[slot])
+          slot = (slot + 1) & index_mask_;
+        index_[slot] = static_cast<uint32_t>(pos + 1);
+      }
+    }
+
+    void DynamicDict::RemoveFromIndex(size_t pos)
+    {
+      size_t slot = static_cast<size_t>(Entry(pos).hash_) & index_mask_;
+      while (index_[slot] != pos + 1)
+        slot = (slot + 1) & index_mask_;
+
+      // backward shift deletion keeps probe sequences unbroken
+      size_t next = slot;
+      while (true)
+      {
+        next = (next + 1) & index_mask_;
+        if (!index_[next])
+          break;
+        size_t home = static_cast<size_t>(Entry(index_[next] - 1).hash_)
+            & index_mask_;
+        bool movable = slot <= next
+            ? (home <= slot || home > next)
+            : (home <= slot && home > next);
+        if (movable)
+        {
+          index_[slot] = index_[next];
+          slot = next;
+        }
+      }
+      index_[slot] = 0;
+    }
+
+    void DynamicDict::SortOrder(uint32_t * order) const
+    {
+      size_t size = 0;
+      for (size_t pos = 0; pos < count_; ++pos)
+        if (Entry(pos).key_)
+          order[size++] = static_cast<uint32_t>(pos);
+      std::sort(order, order + size_, EntryKeyLess(segments_));
+    }
+
+    // Several threads may sort the same const dict at a time, only one
+    // of them publishes its permutation
+    const uint32_t * DynamicDict::BuildOrder() const
+    {
+      uint32_t * order = allocate_array<uint32_t>(size_);
+      SortOrder(order);
+      if (!atomic_cas(&order_, static_cast<uint32_t *>(NULL), order))
+      {
+        DynamicArena::Deallocate(order);
+        return atomic_load(&order_);
+      }
+      return order;
+    }
+
+    void DynamicDict::InsertToOrder(size_t pos)
+    {
+      const std::string & key = Entry(pos).key();
+      size_t lo = 0, hi = size_ - 1;
+      while (lo < hi)
+      {
+        size_t mid = (lo + hi) / 2;
+        if (Entry(order_[mid]).key() < key)
+          lo = mid + 1;
+        else
+          hi = mid;
+      }
+      std::memmove(order_ + lo + 1, order_ + lo,
+          (size_ - 1 - lo) * sizeof(uint32_t));
+      order_[lo] = static_cast<uint32_t>(pos);
+    }
+
+    void DynamicDict::RemoveFromOrder(size_t pos)
+    {
+      uint32_t * it = std::find(order_, order_ + size_ + 1,
+          static_cast<uint32_t>(pos));
+      std::memmove(it, it + 1,
+          (order_ + size_ - it) * sizeof(uint32_t));
+    }
+
+    void DynamicDict::Compact()
+    {
+      DictEntry ** segments = segments_;
+      size_t segment_count = segment_count_;
+      size_t count = count_;
+      size_t size = size_;
+
+      DynamicArena::Deallocate(index_);
+      DynamicArena::Deallocate(order_);
+      segments_ = NULL;
+      index_ = NULL;
+      order_ = NULL;
+      segment_count_ = segments_capacity_ = count_ = size_ = index_mask_ = 0;
+
+      for (size_t pos = 0; pos < count; ++pos)
+      {
+        const DictEntry & entry = dict_entry(segments, pos);
+        if (!entry.key_)
+          continue;
+        if (count_ == capacity())
+          AddSegment();
+        std::memcpy(static_cast<void *>(&Entry(count_++)), &entry,
+            sizeof(DictEntry));
+      }
+      size_ = size;
+
+      for (size_t i = 0; i < segment_count; ++i)
+        DynamicArena::Deallocate(segments[i]);
+      DynamicArena::Deallocate(segments);
+
+      if (count_ > FLAT_MAX_SIZE)
+      {
+        BuildIndex(IndexCapacity(size_));
+        DynamicArena::Deallocate(order_);
+        order_ = NULL;
+      }
+      else
+      {
+        SortOrder(order_);
+      }
+    }
+
+    // 'interned' is key from KeyPool or NULL, then key is owned by entry
+    Dynamic & DynamicDict::Insert(const char * key, size_t size,
+        uint64_t hash, const std::string * interned)
+    {
+      uintptr_t key_ptr;
+      if (interned)
+        key_ptr = reinterpret_cast<uintptr_t>(interned);
+      else
+        key_ptr = reinterpret_cast<uintptr_t>(new std::string(key, size))
+            | DictEntry::OWNED_KEY;
+
+      if (count_ == capacity())
+        AddSegment();
+
+      size_t pos = count_++;
+      DictEntry & entry = Entry(pos);
+      entry.key_ = key_ptr;
+      entry.hash_ = hash;
+      new (&entry.value_) Dynamic();
+      ++size_;
+
+      if (!index_ && count_ <= FLAT_MAX_SIZE)
+      {
+        InsertToOrder(pos);
+      }
+      else
+      {
+        DynamicArena::Deallocate(order_);
+        order_ = NULL;
+        if (!index_ || size_ * 2 > index_mask_ + 1)
+        {
+          BuildIndex(IndexCapacity(size_));
+        }
+        else
+        {
+          size_t slot = static_cast<size_t>(hash) & index_mask_;
+          while (index_[slot])
+            slot = (slot + 1) & index_mask_;
+          index_[slot] = static_cast<uint32_t>(pos + 1);
+        }
+      }
+
+      return entry.value_;
+    }
+
+    size_t DynamicDict::IndexCapacity(size_t size)
+    {
+      size_t capacity = 64;
+      while (capacity < size * 4)
+        capacity *= 2;
+      return capacity;
+    }
+
+    bool DynamicDict::Erase(const std::string & key)
+    {
+      size_t pos = FindEntry(key.data(), key.size(),
+          hash_bytes(key.data(), key.size()));
+      if (pos == NPOS)
+        return false;
+
+      if (index_)
+        RemoveFromIndex(pos);
+      DestroyEntry(Entry(pos));
+      --size_;
+
+      if (size_ == 0)
+        clear();
+      else if (count_ - size_ > size_ + FLAT_MAX_SIZE)
+        Compact();
+      else if (order_)
+        RemoveFromOrder(pos);
+      return true;
+    }
+
+    DictConstIterator DynamicDict::find(const std::string & key) const
+    {
+      size_t pos = FindEntry(key.data(), key.size(),
+          hash_bytes(key.data(), key.size()));
+      if (pos == NPOS)
+        return end();
+
+      const uint32_t * order = GetOrder();
+      const uint32_t * it = std::lower_bound(order, order + size_,
+          static_cast<uint32_t>(pos), EntryKeyLess(segments_));
+      return DictConstIterator(segments_, order,
+          static_cast<size_t>(it - order));
+    }
+  } // namespace detail
+} // namespace nkit
@@ -178,24 +178,51 @@ namespace nkit
 
     Dynamic ParseNumber(const char * str, size_t size)
     {
+      bool is_float = false;
+      for (size_t i = 0; i < size; ++i)
+      {
+        char ch = str[i];
+        if (ch == '.' || ch == 'e' || ch == 'E')
+        {
+          is_float = true;
+          break;
+        }
+      }
+
+      if (is_float)
+      {
+        double tmp;
+        if (likely(chars_to_double(str, size, &tmp)))
+          return Dynamic(tmp);
+      }
+
+      bool negative = str[0] == '-';
+      size_t digits_count = negative ? size - 1 : size;
+
+      // up to 18 digits always fit into int64_t
+      if (!is_float && digits_count <= 18)
+      {
+        const char * p = negative ? str + 1 : str;
+        const char * end = str + size;
+        int64_t tmp = 0;
+        for (; p != end; ++p)
+          tmp = tmp * 10 + (*p - '0');
+        return Dynamic(negative ? -tmp : tmp);
+      }
+
       assert(size < NUMERIC_BUFFER_SIZE);
       memcpy((void*)numeric_buffer_, (void*)str, size);
       numeric_buffer_[size] = 0;
-      size_t digits_count = size;
-      const char * digits = numeric_buffer_;
+      const char * digits = negative ? numeric_buffer_ + 1 : numeric_buffer_;
       const char * INT_64_BOUNDERY = INT_64_MAX.c_str();
       size_t INT_64_BOUNDERY_LEN = INT_64_MAX_LEN;
-      if (str[0] == '-')
+      if (negative)
       {
         INT_64_BOUNDERY_LEN = INT_64_MIN_LEN;
         INT_64_BOUNDERY = INT_64_MIN.c_str();
-        --digits_count;
-        ++digits;
       }
 
-      bool has_dot = strchr(numeric_buffer_, '.') != NULL;
-
-      if (has_dot || digits_count > UINT64_T_MAX_LEN)
+      if (is_float || digits_count > UINT64_T_MAX_LEN)
       {
         return Dynamic(strtod(numeric_buffer_, NULL));
       }
@@ -209,6 +236,7 @@ namespace nkit
       else
       {
         char * endptr = NULL;
+        errno = 0;
         uint64_t ui64 = NKIT_STRTOULL(numeric_buffer_, &endptr, 10);
         if (unlikely((errno == ERANGE) || *endptr != '\0'))
           return Dynamic(strtod(numeric_buffer_, NULL));
@@ -264,7 +292,7 @@ namespace nkit
 
     bool OnMapKey(const char * str, size_t len)
     {
-      current_value_ = & (*current_container_)[std::string(str, len)];
+      current_value_ = & current_container_->GetInterned(str, len);
       return true;
     }
 
@@ -373,12 +401,15 @@ namespace nkit
     return result;
   }
 
-  Dynamic DynamicFromJson(const std::string & json, std::string * error)
+  Dynamic DynamicFromJson(const std::string & json, std::string * error,
+      DynamicArena * arena)
   {
+    DynamicArena::Scope scope(arena);
     return DynamicFromYajl(json, error);
   }
 
-  Dynamic DynamicFromJsonFile(const std::string & path, std::string * error)
+  Dynamic DynamicFromJsonFile(const std::string & path, std::string * error,
+      DynamicArena * arena)
   {
     std::string json;
     if (!path.empty() && !text_file_to_string(path, &json, error))
@@ -388,7 +419,7 @@ namespace nkit
     }
     if (json.empty())
       json = "{}";
-    return DynamicFromJson(json, error);
+    return DynamicFromJson(json, error, arena);
   }
 
   //--------------------------------------------------------------------------
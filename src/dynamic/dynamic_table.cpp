@@ -506,6 +506,26 @@ namespace nkit
       // XXX free storage memory here?
     }
 
+    //--------------------------------------------------------------------------
+    void SharedTable::FreezeAll()
+    {
+      if (frozen())
+        return;
+      Freeze();
+
+      size_t const col_size = columns_.size();
+      for (size_t row_num = 0; row_num != rows_; ++row_num)
+      {
+        Data * cache = storage_->get(row_num);
+        for (size_t col_num = 0; col_num < col_size; ++col_num)
+        {
+          const uint64_t type = columns_[col_num].type_;
+          if (is_ref_counted(type))
+            Operation<OP_FREEZE_DATA>::farray[type](cache[col_num]);
+        } // for
+      }
+    }
+
     //--------------------------------------------------------------------------
     StringVector SharedTable::column_names() const
     {
@@ -526,6 +546,16 @@ namespace nkit
       return ret;
     }
 
+    DynamicTypeVector SharedTable::column_type_ids() const
+    {
+      DynamicTypeVector ret;
+      ret.reserve(columns_.size());
+      Columns::const_iterator it = columns_.begin(), last = columns_.end();
+      for ( ;it != last; ++it)
+        ret.push_back(it->type_);
+      return ret;
+    }
+
     //--------------------------------------------------------------------------
     void SharedTable::SetColumnName(size_t pos, const std::string & name)
     {
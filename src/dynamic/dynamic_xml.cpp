@@ -17,14 +17,491 @@
 #include "nkit/xml2var.h"
 #include "nkit/dynamic/dynamic_builder.h"
 #include "nkit/dynamic_xml.h"
+#include "nkit/mutex.h"
+#include "nkit/threading/spin_lock.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+
+#if defined(NKIT_WINNT)
+#  include <io.h>
+#else
+#  include <unistd.h>
+#  include <pthread.h>
+#endif
 
 namespace nkit
 {
+  namespace detail
+  {
+    //--------------------------------------------------------------------------
+    // Lets kernel read ahead more aggressively
+    static void advise_sequential(int fd)
+    {
+#if defined(POSIX_FADV_SEQUENTIAL)
+      posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#else
+      (void)fd;
+#endif
+    }
+
+    //--------------------------------------------------------------------------
+    class FileReader
+    {
+    public:
+      FileReader() : file_(NULL), total_(0) {}
+
+      ~FileReader()
+      {
+        if (file_)
+          std::fclose(file_);
+      }
+
+      bool Open(const std::string & path, std::string * error)
+      {
+        if (path.empty())
+        {
+          *error = "Could not open file: ''";
+          return false;
+        }
+
+        file_ = std::fopen(path.c_str(), "rb");
+        if (!file_)
+        {
+          *error = "Could not open file: '" + path + "': " + strerror(errno);
+          return false;
+        }
+        advise_sequential(fileno(file_));
+        return true;
+      }
+
+      int64_t Read(char * buffer, size_t size, std::string * error)
+      {
+        size_t result = std::fread(buffer, 1, size, file_);
+        if (result == 0 && std::ferror(file_))
+        {
+          *error = strerror(errno);
+          return -1;
+        }
+        total_ += result;
+        return static_cast<int64_t>(result);
+      }
+
+      bool empty() const { return total_ == 0; }
+
+    private:
+      FileReader(const FileReader &);
+      FileReader & operator = (const FileReader &);
+
+    private:
+      FILE * file_;
+      uint64_t total_;
+    };
+
+    static int64_t read_file(char * buffer, size_t size, void * context,
+        std::string * error)
+    {
+      return static_cast<FileReader *>(context)->Read(buffer, size, error);
+    }
+
+    static int64_t read_fd(char * buffer, size_t size, void * context,
+        std::string * error)
+    {
+      int fd = *static_cast<int *>(context);
+      while (true)
+      {
+#if defined(NKIT_WINNT)
+        int result = _read(fd, buffer, static_cast<unsigned int>(size));
+#else
+        ssize_t result = ::read(fd, buffer, size);
+#endif
+        if (result >= 0)
+          return static_cast<int64_t>(result);
+        if (errno != EINTR)
+        {
+          *error = strerror(errno);
+          return -1;
+        }
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    template <typename Options>
+    Dynamic any_xml_from_stream(XmlReadFunction read, void * context,
+        const Options & options,
+        std::string * const root_name,
+        std::string * const error,
+        DynamicArena * arena)
+    {
+      DynamicArena::Scope scope(arena);
+      AnyXml2VarBuilder<DynamicBuilder>::Ptr builder = AnyXml2VarBuilder<
+          DynamicBuilder>::Create(options, error);
+      if(!builder)
+        return Dynamic();
+      if (!builder->FeedStream(read, context, error))
+        return Dynamic();
+      *root_name = builder->root_name();
+      return builder->var();
+    }
+
+    //--------------------------------------------------------------------------
+    // Idle builders of one mapping. Builder is taken for a document and
+    // returned cleared, so it keeps no references to results.
+    class XmlBuilderPool
+    {
+    public:
+      typedef StructXml2VarBuilder<DynamicBuilder> Builder;
+
+      XmlBuilderPool(const Options::Ptr & options, const Dynamic & mapping)
+        : options_(options)
+        , mapping_(mapping)
+      {
+        mapping_.Freeze();
+      }
+
+      Builder::Ptr Create(std::string * error) const
+      {
+        Builder::Ptr builder = Builder::Create(options_);
+        if (!builder->AddMapping(S_EMPTY_, mapping_, error))
+          return Builder::Ptr();
+        return builder;
+      }
+
+      Builder::Ptr Take(std::string * error)
+      {
+        {
+          LockGuard<SpinLock> lock(lock_);
+          if (!idle_.empty())
+          {
+            Builder::Ptr builder = idle_.back();
+            idle_.pop_back();
+            return builder;
+          }
+        }
+        return Create(error);
+      }
+
+      // Items of list mapping are independent of each other
+      bool list_mapping() const
+      {
+        return mapping_.IsList() && mapping_.size() == 2;
+      }
+
+      void Give(const Builder::Ptr & builder)
+      {
+        builder->Clear();
+        LockGuard<SpinLock> lock(lock_);
+        idle_.push_back(builder);
+      }
+
+    private:
+      const Options::Ptr options_;
+      Dynamic mapping_;
+      // only push_back()/pop_back() of idle_ are under it
+      SpinLock lock_;
+      std::vector<Builder::Ptr> idle_;
+    };
+
+    //--------------------------------------------------------------------------
+    // Returns builder to the pool on scope exit
+    class PooledBuilder
+    {
+    public:
+      PooledBuilder(XmlBuilderPool & pool, std::string * error)
+        : pool_(pool)
+        , builder_(pool.Take(error))
+      {}
+
+      ~PooledBuilder()
+      {
+        if (builder_)
+          pool_.Give(builder_);
+      }
+
+      XmlBuilderPool::Builder * operator -> () const
+      {
+        return builder_.get();
+      }
+
+      bool operator ! () const { return !builder_; }
+
+    private:
+      PooledBuilder(const PooledBuilder &);
+      PooledBuilder & operator = (const PooledBuilder &);
+
+    private:
+      XmlBuilderPool & pool_;
+      XmlBuilderPool::Builder::Ptr builder_;
+    };
+
+    //--------------------------------------------------------------------------
+    // Document of form '<root>child child ... child</root>' split into parts
+    // at boundaries of root's children
+    struct XmlSplit
+    {
+      size_t body_begin_;  // end of root start tag
+      size_t body_end_;    // beginning of root end tag
+      std::string root_name_;
+      std::vector<size_t> bounds_;  // beginnings of parts
+    };
+
+    static size_t find_str(const char * data, size_t size, size_t pos,
+        const char * str)
+    {
+      size_t len = strlen(str);
+      while (pos + len <= size)
+      {
+        const char * found = static_cast<const char *>(
+            std::memchr(data + pos, str[0], size - pos - len + 1));
+        if (!found)
+          return std::string::npos;
+        pos = static_cast<size_t>(found - data);
+        if (std::memcmp(found, str, len) == 0)
+          return pos;
+        ++pos;
+      }
+      return std::string::npos;
+    }
+
+    static bool starts_with_str(const char * data, size_t size, size_t pos,
+        const char * str)
+    {
+      size_t len = strlen(str);
+      return pos + len <= size && std::memcmp(data + pos, str, len) == 0;
+    }
+
+    // Returns position of '>' of tag, skipping quoted attribute values
+    static size_t find_tag_end(const char * data, size_t size, size_t pos)
+    {
+      char quote = 0;
+      for (; pos < size; ++pos)
+      {
+        char c = data[pos];
+        if (quote)
+        {
+          if (c == quote)
+            quote = 0;
+        }
+        else if (c == '"' || c == '\'')
+          quote = c;
+        else if (c == '>')
+          return pos;
+      }
+      return std::string::npos;
+    }
+
+    // Fast pre-scan: tracks only element depth, skipping text, comments,
+    // CDATA and processing instructions. Returns false if document can
+    // not be split (malformed, has internal DTD subset or no children).
+    static bool split_xml(const char * data, size_t size, size_t parts,
+        XmlSplit * split)
+    {
+      size_t depth = 0, pos = 0, step = 0, next_bound = 0;
+      split->bounds_.clear();
+      while (true)
+      {
+        const char * lt = static_cast<const char *>(
+            std::memchr(data + pos, '<', size - pos));
+        if (!lt)
+          return false;
+        pos = static_cast<size_t>(lt - data);
+
+        if (starts_with_str(data, size, pos, "<?"))
+        {
+          pos = find_str(data, size, pos + 2, "?>");
+          if (pos == std::string::npos)
+            return false;
+          pos += 2;
+          continue;
+        }
+
+        if (starts_with_str(data, size, pos, "<!--"))
+        {
+          pos = find_str(data, size, pos + 4, "-->");
+          if (pos == std::string::npos)
+            return false;
+          pos += 3;
+          continue;
+        }
+
+        if (starts_with_str(data, size, pos, "<![CDATA["))
+        {
+          pos = find_str(data, size, pos + 9, "]]>");
+          if (pos == std::string::npos)
+            return false;
+          pos += 3;
+          continue;
+        }
+
+        size_t gt = find_tag_end(data, size, pos);
+        if (gt == std::string::npos)
+          return false;
+
+        if (data[pos + 1] == '!')
+        {
+          // DOCTYPE: entities of internal subset are not seen by parts
+          if (std::memchr(data + pos, '[', gt - pos))
+            return false;
+        }
+        else if (data[pos + 1] == '/')
+        {
+          if (depth == 0)
+            return false;
+          if (--depth == 0)
+          {
+            split->body_end_ = pos;
+            return !split->bounds_.empty();
+          }
+        }
+        else if (depth == 0)
+        {
+          if (data[gt - 1] == '/')
+            return false;
+          size_t name_end = pos + 1;
+          while (name_end < gt && !isspace(
+              static_cast<unsigned char>(data[name_end])))
+            ++name_end;
+          split->root_name_.assign(data + pos + 1, name_end - pos - 1);
+          split->body_begin_ = gt + 1;
+          step = (size - split->body_begin_) / parts;
+          next_bound = split->body_begin_ + step;
+          depth = 1;
+        }
+        else
+        {
+          if (depth == 1 && pos >= next_bound
+              && split->bounds_.size() + 1 < parts)
+          {
+            split->bounds_.push_back(pos);
+            next_bound = pos + step;
+          }
+          if (data[gt - 1] != '/')
+            ++depth;
+        }
+        pos = gt + 1;
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    // Part of document is parsed as a document of its own:
+    // prolog and root start tag, part, root end tag
+    struct XmlPart
+    {
+      XmlBuilderPool * pool_;
+      const char * prefix_;
+      size_t prefix_size_;
+      const char * begin_;
+      size_t size_;
+      const std::string * suffix_;
+      Dynamic result_;
+      std::string error_;
+    };
+
+    static void parse_xml_part(XmlPart * part)
+    {
+      PooledBuilder builder(*part->pool_, &part->error_);
+      if (!builder)
+        return;
+      if (builder->Feed(part->prefix_, part->prefix_size_, false,
+              &part->error_)
+          && builder->Feed(part->begin_, part->size_, false, &part->error_)
+          && builder->Feed(part->suffix_->data(), part->suffix_->size(), true,
+              &part->error_))
+        part->result_ = builder->var(S_EMPTY_);
+    }
+
+#if defined(NKIT_WINNT)
+    static DWORD WINAPI parse_xml_part_thread(LPVOID arg)
+    {
+      parse_xml_part(static_cast<XmlPart *>(arg));
+      return 0;
+    }
+#else
+    static void * parse_xml_part_thread(void * arg)
+    {
+      parse_xml_part(static_cast<XmlPart *>(arg));
+      return NULL;
+    }
+#endif
+
+    static size_t cpu_count()
+    {
+#if defined(NKIT_WINNT)
+      SYSTEM_INFO info;
+      GetSystemInfo(&info);
+      return info.dwNumberOfProcessors;
+#else
+      long count = sysconf(_SC_NPROCESSORS_ONLN);
+      return count > 0 ? static_cast<size_t>(count) : 1;
+#endif
+    }
+
+    // Parses parts[1..] by threads of their own, parts[0] by calling thread
+    static void parse_xml_parts(std::vector<XmlPart> & parts)
+    {
+      size_t count = parts.size();
+#if defined(NKIT_WINNT)
+      std::vector<HANDLE> threads(count, HANDLE(NULL));
+      for (size_t i = 1; i < count; ++i)
+        threads[i] = CreateThread(NULL, 0, parse_xml_part_thread, &parts[i],
+            0, NULL);
+#else
+      std::vector<pthread_t> threads(count);
+      std::vector<bool> started(count, false);
+      for (size_t i = 1; i < count; ++i)
+        started[i] = pthread_create(&threads[i], NULL,
+            parse_xml_part_thread, &parts[i]) == 0;
+#endif
+
+      parse_xml_part(&parts[0]);
+
+      for (size_t i = 1; i < count; ++i)
+      {
+#if defined(NKIT_WINNT)
+        if (threads[i])
+        {
+          WaitForSingleObject(threads[i], INFINITE);
+          CloseHandle(threads[i]);
+        }
+        else
+          parse_xml_part(&parts[i]);
+#else
+        if (started[i])
+          pthread_join(threads[i], NULL);
+        else
+          parse_xml_part(&parts[i]);
+#endif
+      }
+    }
+
+    template <typename Options>
+    Dynamic any_xml_from_file(const std::string & path,
+        const Options & options,
+        std::string * const root_name,
+        std::string * const error,
+        DynamicArena * arena)
+    {
+      FileReader reader;
+      if (!reader.Open(path, error))
+        return Dynamic();
+
+      Dynamic result = any_xml_from_stream(read_file, &reader, options,
+          root_name, error, arena);
+      if (reader.empty())
+        *error = "Could not open file: '" + path + "'";
+      return result;
+    }
+  } // namespace detail
+
   Dynamic DynamicFromAnyXml(const std::string & xml,
       const std::string & options,
       std::string * const root_name,
-      std::string * const error)
+      std::string * const error,
+      DynamicArena * arena)
   {
+    DynamicArena::Scope scope(arena);
     AnyXml2VarBuilder<DynamicBuilder>::Ptr builder = AnyXml2VarBuilder<
         DynamicBuilder>::Create(options, error);
     if(!builder)
@@ -38,8 +515,10 @@ namespace nkit
   Dynamic DynamicFromAnyXml(const std::string & xml,
       const Dynamic & options,
       std::string * const root_name,
-      std::string * const error)
+      std::string * const error,
+      DynamicArena * arena)
   {
+    DynamicArena::Scope scope(arena);
     AnyXml2VarBuilder<DynamicBuilder>::Ptr builder = AnyXml2VarBuilder<
         DynamicBuilder>::Create(options, error);
     if(!builder)
@@ -53,44 +532,49 @@ namespace nkit
   Dynamic DynamicFromAnyXmlFile(const std::string & path,
       const std::string & options,
       std::string * const root_name,
-      std::string * const error)
+      std::string * const error,
+      DynamicArena * arena)
   {
-    std::string xml;
-    if (!path.empty() && !text_file_to_string(path, &xml, error))
-      return Dynamic();
-
-    if (xml.empty())
-    {
-      *error = "Could not open file: '" + path + "'";
-      return Dynamic();
-    }
-
-    return DynamicFromAnyXml(xml, options, root_name, error);
+    return detail::any_xml_from_file(path, options, root_name, error, arena);
   }
 
   Dynamic DynamicFromAnyXmlFile(const std::string & path,
       const Dynamic & options,
       std::string * const root_name,
-      std::string * const error)
+      std::string * const error,
+      DynamicArena * arena)
   {
-    std::string xml;
-    if (!path.empty() && !text_file_to_string(path, &xml, error))
-      return Dynamic();
+    return detail::any_xml_from_file(path, options, root_name, error, arena);
+  }
 
-    if (xml.empty())
-    {
-      *error = "Could not open file: '" + path + "'";
-      return Dynamic();
-    }
+  Dynamic DynamicFromAnyXmlStream(XmlReadFunction read, void * context,
+      const std::string & options,
+      std::string * const root_name,
+      std::string * const error,
+      DynamicArena * arena)
+  {
+    return detail::any_xml_from_stream(read, context, options, root_name,
+        error, arena);
+  }
 
-    return DynamicFromAnyXml(xml, options, root_name, error);
+  Dynamic DynamicFromAnyXmlFd(int fd,
+      const std::string & options,
+      std::string * const root_name,
+      std::string * const error,
+      DynamicArena * arena)
+  {
+    detail::advise_sequential(fd);
+    return detail::any_xml_from_stream(detail::read_fd, &fd, options,
+        root_name, error, arena);
   }
 
   Dynamic DynamicFromXml(const std::string & xml,
       const std::string & options,
       const std::string & mapping,
-      std::string * const error)
+      std::string * const error,
+      DynamicArena * arena)
   {
+    DynamicArena::Scope scope(arena);
     StructXml2VarBuilder<DynamicBuilder>::Ptr builder = StructXml2VarBuilder<
         DynamicBuilder>::Create(options, error);
     if(!builder)
@@ -104,23 +588,27 @@ namespace nkit
 
   Dynamic DynamicFromXml(const std::string & xml,
       const std::string & mapping,
-      std::string * const error)
+      std::string * const error,
+      DynamicArena * arena)
   {
-    return DynamicFromXml(xml, "{}", mapping, error);
+    return DynamicFromXml(xml, "{}", mapping, error, arena);
   }
 
   Dynamic DynamicFromXml(const std::string & xml,
       const Dynamic & mapping,
-      std::string * const error)
+      std::string * const error,
+      DynamicArena * arena)
   {
-    return DynamicFromXml(xml, D_NONE, mapping, error);
+    return DynamicFromXml(xml, D_NONE, mapping, error, arena);
   }
 
   Dynamic DynamicFromXml(const std::string & xml,
       const Dynamic & options,
       const Dynamic & mapping,
-      std::string * const error)
+      std::string * const error,
+      DynamicArena * arena)
   {
+    DynamicArena::Scope scope(arena);
     StructXml2VarBuilder<DynamicBuilder>::Ptr builder = StructXml2VarBuilder<
         DynamicBuilder>::Create(options, error);
     if(!builder)
@@ -135,18 +623,249 @@ namespace nkit
   Dynamic DynamicFromXmlFile(const std::string & path,
         const std::string & options,
         const std::string & mapping,
-        std::string * const error)
+        std::string * const error,
+        DynamicArena * arena)
   {
-    std::string xml;
-    if (!path.empty() && !text_file_to_string(path, &xml, error))
+    detail::FileReader reader;
+    if (!reader.Open(path, error))
       return Dynamic();
 
-    if (xml.empty())
-    {
+    Dynamic result = DynamicFromXmlStream(detail::read_file, &reader,
+        options, mapping, error, arena);
+    if (reader.empty())
+      *error = "Could not open file: '" + path + "'";
+    return result;
+  }
+
+  Dynamic DynamicFromXmlFile(const std::string & path,
+      const std::string & mapping,
+      std::string * const error,
+      DynamicArena * arena)
+  {
+    return DynamicFromXmlFile(path, "{}", mapping, error, arena);
+  }
+
+  Dynamic DynamicFromXmlStream(XmlReadFunction read, void * context,
+      const std::string & options,
+      const std::string & mapping,
+      std::string * const error,
+      DynamicArena * arena)
+  {
+    DynamicArena::Scope scope(arena);
+    StructXml2VarBuilder<DynamicBuilder>::Ptr builder = StructXml2VarBuilder<
+        DynamicBuilder>::Create(options, error);
+    if(!builder)
+      return Dynamic();
+    if (!builder->AddMapping(S_EMPTY_, mapping, error))
+      return Dynamic();
+    if (!builder->FeedStream(read, context, error))
+      return Dynamic();
+    return builder->var(S_EMPTY_);
+  }
+
+  Dynamic DynamicFromXmlFd(int fd,
+      const std::string & options,
+      const std::string & mapping,
+      std::string * const error,
+      DynamicArena * arena)
+  {
+    detail::advise_sequential(fd);
+    return DynamicFromXmlStream(detail::read_fd, &fd, options, mapping,
+        error, arena);
+  }
+
+  //----------------------------------------------------------------------------
+  DynamicXmlMapping::DynamicXmlMapping(detail::XmlBuilderPool * pool)
+    : pool_(pool)
+  {}
+
+  DynamicXmlMapping::~DynamicXmlMapping()
+  {
+    delete pool_;
+  }
+
+  DynamicXmlMapping::Ptr DynamicXmlMapping::Create(const std::string & options,
+      const std::string & mapping, std::string * const error)
+  {
+    detail::Options::Ptr o = detail::Options::Create(options, error);
+    if (!o)
+      return Ptr();
+    Dynamic m = DynamicFromJson(mapping, error);
+    if (!m)
+      return Ptr();
+    return Create(o, m, error);
+  }
+
+  DynamicXmlMapping::Ptr DynamicXmlMapping::Create(const Dynamic & options,
+      const Dynamic & mapping, std::string * const error)
+  {
+    detail::Options::Ptr o = detail::Options::Create(options, error);
+    if (!o)
+      return Ptr();
+    return Create(o, mapping, error);
+  }
+
+  DynamicXmlMapping::Ptr DynamicXmlMapping::Create(
+      const detail::Options::Ptr & options, const Dynamic & mapping,
+      std::string * const error)
+  {
+    detail::XmlBuilderPool * pool = new detail::XmlBuilderPool(options,
+        mapping);
+    Ptr result(new DynamicXmlMapping(pool));
+
+    // checks mapping, the first builder is kept for the first document
+    detail::XmlBuilderPool::Builder::Ptr builder = pool->Create(error);
+    if (!builder)
+      return Ptr();
+    pool->Give(builder);
+    return result;
+  }
+
+  Dynamic DynamicFromXml(const std::string & xml,
+      const DynamicXmlMapping & mapping,
+      std::string * const error,
+      DynamicArena * arena)
+  {
+    detail::PooledBuilder builder(mapping.pool(), error);
+    if (!builder)
+      return Dynamic();
+    DynamicArena::Scope scope(arena);
+    if (!builder->Feed(xml.c_str(), xml.length(), true, error))
+      return Dynamic();
+    return builder->var(S_EMPTY_);
+  }
+
+  Dynamic DynamicFromXmlStream(XmlReadFunction read, void * context,
+      const DynamicXmlMapping & mapping,
+      std::string * const error,
+      DynamicArena * arena)
+  {
+    detail::PooledBuilder builder(mapping.pool(), error);
+    if (!builder)
+      return Dynamic();
+    DynamicArena::Scope scope(arena);
+    if (!builder->FeedStream(read, context, error))
+      return Dynamic();
+    return builder->var(S_EMPTY_);
+  }
+
+  Dynamic DynamicFromXmlFile(const std::string & path,
+      const DynamicXmlMapping & mapping,
+      std::string * const error,
+      DynamicArena * arena)
+  {
+    detail::FileReader reader;
+    if (!reader.Open(path, error))
+      return Dynamic();
+
+    Dynamic result = DynamicFromXmlStream(detail::read_file, &reader,
+        mapping, error, arena);
+    if (reader.empty())
       *error = "Could not open file: '" + path + "'";
+    return result;
+  }
+
+  Dynamic DynamicFromXmlParallel(const std::string & xml,
+      const DynamicXmlMapping & mapping,
+      size_t threads,
+      std::string * const error)
+  {
+    detail::XmlBuilderPool & pool = mapping.pool();
+    if (!pool.list_mapping())
+    {
+      *error = "Parallel parsing requires list mapping";
       return Dynamic();
     }
 
-    return DynamicFromXml(xml, options, mapping, error);
+    if (threads == 0)
+      threads = detail::cpu_count();
+
+    detail::XmlSplit split;
+    if (threads < 2
+        || !detail::split_xml(xml.data(), xml.size(), threads, &split))
+      return DynamicFromXml(xml, mapping, error);
+
+    std::string suffix("</" + split.root_name_ + ">");
+    split.bounds_.insert(split.bounds_.begin(), split.body_begin_);
+    split.bounds_.push_back(split.body_end_);
+
+    std::vector<detail::XmlPart> parts(split.bounds_.size() - 1);
+    for (size_t i = 0; i < parts.size(); ++i)
+    {
+      detail::XmlPart & part = parts[i];
+      part.pool_ = &pool;
+      part.prefix_ = xml.data();
+      part.prefix_size_ = split.body_begin_;
+      part.begin_ = xml.data() + split.bounds_[i];
+      part.size_ = split.bounds_[i + 1] - split.bounds_[i];
+      part.suffix_ = &suffix;
+    }
+
+    detail::parse_xml_parts(parts);
+
+    Dynamic result = parts[0].result_;
+    for (size_t i = 0; i < parts.size(); ++i)
+    {
+      if (!parts[i].error_.empty() || !parts[i].result_.IsList())
+      {
+        *error = parts[i].error_;
+        return Dynamic();
+      }
+      if (i == 0)
+        continue;
+      Dynamic::ListConstIterator item = parts[i].result_.begin_l(),
+          end = parts[i].result_.end_l();
+      for (; item != end; ++item)
+        result.PushBack(*item);
+    }
+    return result;
+  }
+
+  Dynamic DynamicFromXmlFileParallel(const std::string & path,
+      const DynamicXmlMapping & mapping,
+      size_t threads,
+      std::string * const error)
+  {
+    std::string xml;
+    if (!text_file_to_string(path, &xml, error))
+      return Dynamic();
+    return DynamicFromXmlParallel(xml, mapping, threads, error);
+  }
+
+  //----------------------------------------------------------------------------
+  bool DynamicXmlStreamForEach(XmlReadFunction read, void * read_context,
+      const std::string & options,
+      const std::string & mapping,
+      DynamicRecordCallback callback,
+      void * context,
+      std::string * const error)
+  {
+    StructXml2VarBuilder<DynamicBuilder>::Ptr builder = StructXml2VarBuilder<
+        DynamicBuilder>::Create(options, error);
+    if(!builder)
+      return false;
+    if (!builder->AddMapping(S_EMPTY_, mapping, error))
+      return false;
+    if (!builder->SetRecordCallback(S_EMPTY_, callback, context, error))
+      return false;
+    return builder->FeedStream(read, read_context, error);
+  }
+
+  bool DynamicXmlFileForEach(const std::string & path,
+      const std::string & options,
+      const std::string & mapping,
+      DynamicRecordCallback callback,
+      void * context,
+      std::string * const error)
+  {
+    detail::FileReader reader;
+    if (!reader.Open(path, error))
+      return false;
+
+    bool result = DynamicXmlStreamForEach(detail::read_file, &reader,
+        options, mapping, callback, context, error);
+    if (reader.empty())
+      *error = "Could not open file: '" + path + "'";
+    return result;
   }
 } // namespace nkit
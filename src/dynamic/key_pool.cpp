@@ -0,0 +1,168 @@
+/*
+   Copyright 2010-2015 Boris T. Darchiev (boris.darchiev@gmail.com)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include "nkit/dynamic/key_pool.h"
+#include "nkit/mutex.h"
+#include "nkit/detail/atomic.h"
+
+namespace nkit
+{
+  namespace detail
+  {
+    //--------------------------------------------------------------------------
+    struct KeySlot
+    {
+      uint64_t hash_;
+      const std::string * key_;
+    };
+
+    inline bool key_equal(const KeySlot & slot, uint64_t hash,
+        const char * key, size_t size)
+    {
+      return slot.hash_ == hash && slot.key_ != NULL
+          && slot.key_->size() == size
+          && std::memcmp(slot.key_->data(), key, size) == 0;
+    }
+
+    //--------------------------------------------------------------------------
+    // Open addressing table with linear probing, grows at 1/2 load
+    class KeyTable
+    {
+    public:
+      KeyTable() : slots_(1024), count_(0) {}
+
+      const std::string * Find(uint64_t hash, const char * key,
+          size_t size) const
+      {
+        size_t i = FindSlot(hash, key, size);
+        return slots_[i].key_;
+      }
+
+      const std::string * Intern(uint64_t hash, const char * key, size_t size)
+      {
+        size_t i = FindSlot(hash, key, size);
+        if (slots_[i].key_ != NULL)
+          return slots_[i].key_;
+
+        if (count_ >= KeyPool::MAX_KEY_COUNT)
+          return NULL;
+
+        KeySlot & slot = slots_[i];
+        slot.hash_ = hash;
+        slot.key_ = new std::string(key, size);
+        ++count_;
+        const std::string * result = slot.key_;
+        if (count_ * 2 > slots_.size())
+          Grow();
+        return result;
+      }
+
+      size_t size() const { return count_; }
+      bool full() const { return count_ >= KeyPool::MAX_KEY_COUNT; }
+
+    private:
+      // Slot of the key or empty slot where it should be
+      size_t FindSlot(uint64_t hash, const char * key, size_t size) const
+      {
+        size_t mask = slots_.size() - 1;
+        size_t i = static_cast<size_t>(hash) & mask;
+        while (slots_[i].key_ != NULL && !key_equal(slots_[i], hash, key, size))
+          i = (i + 1) & mask;
+        return i;
+      }
+
+      void Grow()
+      {
+        std::vector<KeySlot> slots(slots_.size() * 2);
+        size_t mask = slots.size() - 1;
+        std::vector<KeySlot>::const_iterator it = slots_.begin(),
+            end = slots_.end();
+        for (; it != end; ++it)
+        {
+          if (it->key_ == NULL)
+            continue;
+          size_t i = static_cast<size_t>(it->hash_) & mask;
+          while (slots[i].key_ != NULL)
+            i = (i + 1) & mask;
+          slots[i] = *it;
+        }
+        slots_.swap(slots);
+      }
+
+    private:
+      std::vector<KeySlot> slots_;
+      size_t count_;
+    };
+
+    // Never destroyed: interned keys are referenced by dicts until exit
+    static KeyTable * key_table()
+    {
+      static KeyTable * table = new KeyTable;
+      return table;
+    }
+
+    static Mutex * key_table_mutex()
+    {
+      static Mutex * mutex = new Mutex;
+      return mutex;
+    }
+
+    // Full table is never changed again, so it is read without mutex
+    static volatile uint32_t key_table_full_ = 0;
+
+    static const size_t KEY_CACHE_SIZE = 256;
+    static NKIT_THREAD_LOCAL KeySlot key_cache_[KEY_CACHE_SIZE];
+
+    //--------------------------------------------------------------------------
+    const std::string * KeyPool::Intern(const char * key, size_t size,
+        uint64_t hash)
+    {
+      if (size > MAX_KEY_SIZE)
+        return NULL;
+
+      KeySlot & cached = key_cache_[hash & (KEY_CACHE_SIZE - 1)];
+      if (key_equal(cached, hash, key, size))
+        return cached.key_;
+
+      const std::string * result;
+      if (atomic_load(&key_table_full_))
+      {
+        result = key_table()->Find(hash, key, size);
+      }
+      else
+      {
+        LockGuard<Mutex> lock(*key_table_mutex());
+        KeyTable * table = key_table();
+        result = table->Intern(hash, key, size);
+        if (table->full())
+          atomic_store(&key_table_full_, uint32_t(1));
+      }
+
+      if (result)
+      {
+        cached.hash_ = hash;
+        cached.key_ = result;
+      }
+      return result;
+    }
+
+    size_t KeyPool::size()
+    {
+      LockGuard<Mutex> lock(*key_table_mutex());
+      return key_table()->size();
+    }
+  } // namespace detail
+} // namespace nkit
@@ -14,6 +14,12 @@
    limitations under the License.
 */
 
+#include <cstring>
+
+#if defined(__SSE2__)
+#  include <emmintrin.h>
+#endif
+
 #include "nkit/tools.h"
 #include "nkit/transcode.h"
 
@@ -64,6 +70,52 @@ namespace nkit
     return all_transcoders;
   }
 
+  //----------------------------------------------------------------------------
+  typedef std::map<std::string, const Transcoder *> TranscodersByName;
+  TranscodersByName & get_transcoders_by_name()
+  {
+    static TranscodersByName transcoders_by_name;
+    return transcoders_by_name;
+  }
+
+  //----------------------------------------------------------------------------
+  static std::string lower_ascii(const std::string & str)
+  {
+    std::string result(str);
+    for (size_t i = 0; i < result.size(); ++i)
+    {
+      if (result[i] >= 'A' && result[i] <= 'Z')
+        result[i] = static_cast<char>(result[i] - 'A' + 'a');
+    }
+    return result;
+  }
+
+  //----------------------------------------------------------------------------
+  // Length of leading run of ASCII characters
+  static size_t ascii_prefix(const uint8_t * src, size_t size)
+  {
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 16 <= size; i += 16)
+    {
+      __m128i block = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(src + i));
+      if (_mm_movemask_epi8(block) != 0)
+        break;
+    }
+#endif
+    for (; i + 8 <= size; i += 8)
+    {
+      uint64_t word;
+      std::memcpy(&word, src + i, sizeof(word));
+      if ((word & 0x8080808080808080ULL) != 0)
+        break;
+    }
+    while (i < size && src[i] < 0x80)
+      ++i;
+    return i;
+  }
+
   //----------------------------------------------------------------------------
   void Transcoder::Build()
   {
@@ -78,41 +130,62 @@ namespace nkit
       Transcoder transcoder(codepage.map);
       all_transcoders.insert(std::make_pair(codepage.codepage_id, transcoder));
     }
+
+    TranscodersByName & transcoders_by_name = get_transcoders_by_name();
+    const Lang * all_langs = get_langs();
+    for (size_t l = 0; all_langs[l].name != NULL; ++l)
+    {
+      Transcoders::const_iterator it =
+          all_transcoders.find(all_langs[l].codepage_id);
+      if (it != all_transcoders.end())
+        transcoders_by_name.insert(std::make_pair(
+            lower_ascii(all_langs[l].name), &it->second));
+    }
   }
 
   //----------------------------------------------------------------------------
   Transcoder::Transcoder(const uint16_t * char_to_single_utf16_map)
     : char_to_single_utf16_map_(char_to_single_utf16_map)
-    , single_utf16_to_char_hash_table_(ALL_CHARS_LEN)
+    , page_index_(CHARS_COUNT, static_cast<uint16_t>(NO_PAGE))
+    , ascii_as_is_(true)
   {
+    for (size_t i = 0; i < CHARS_COUNT; ++i)
+    {
+      uint16_t utf16[2] = { char_to_single_utf16_map_[i], 0 };
+      Utf8Char & utf8 = to_utf8_[i];
+      char bytes[6];
+      uint8_t size = 0;
+      if (utf16_to_utf8(bytes, utf16, &size) && size <= sizeof(utf8.bytes_))
+      {
+        utf8.size_ = size;
+        std::memcpy(utf8.bytes_, bytes, size);
+      }
+      else
+        utf8.size_ = 0;
+
+      if (i < 0x80 && char_to_single_utf16_map_[i] != i)
+        ascii_as_is_ = false;
+    }
 
-    for (size_t i = 0; i < ALL_CHARS_LEN; ++i)
-      AddMapping(char_to_single_utf16_map_[i], i);
+    for (size_t i = 0; i < CHARS_COUNT; ++i)
+      AddMapping(char_to_single_utf16_map_[i], static_cast<char>(i));
   }
 
   //----------------------------------------------------------------------------
   const Transcoder * Transcoder::Find(const std::string & name)
   {
-    const Lang * all_langs = get_langs();
-    for (size_t l = 0; all_langs[l].name != NULL; ++l)
-    {
-      if (NKIT_STRCASECMP(all_langs[l].name, name.c_str()) == 0)
-      {
-        const Transcoders & all_transcoders = get_all_transcoders();
-        Transcoders::const_iterator it =
-                  all_transcoders.find(all_langs[l].codepage_id);
-        if (it != all_transcoders.end())
-          return & it->second;
-      }
-    }
-
+    const TranscodersByName & transcoders_by_name = get_transcoders_by_name();
+    TranscodersByName::const_iterator it =
+        transcoders_by_name.find(lower_ascii(name));
+    if (it != transcoders_by_name.end())
+      return it->second;
     return NULL;
   }
 
   //----------------------------------------------------------------------------
   void Transcoder::FillExpatEncodingInfo(int * map) const
   {
-    for (size_t i = 0; i < ALL_CHARS_LEN; ++i)
+    for (size_t i = 0; i < CHARS_COUNT; ++i)
       map[i] = char_to_single_utf16_map_[i];
   }
 
@@ -134,15 +207,12 @@ namespace nkit
           const Transcoder & out_transcoder,
           std::string * out) const
   {
-    uint16_t utf16[2] = {0,0};
     std::string::const_iterator it = src.begin(), end = src.end();
     for (; it != end; ++it)
     {
       uint8_t ch = *it;
-      utf16[0] = char_to_single_utf16_map_[ch];
-      utf16[1] = 0;
       char c;
-      if (!out_transcoder.GetChar(utf16[0], &c))
+      if (!out_transcoder.GetChar(char_to_single_utf16_map_[ch], &c))
         return false;
       out->push_back(c);
     }
@@ -150,39 +220,132 @@ namespace nkit
   }
 
   //----------------------------------------------------------------------------
-  bool Transcoder::FromUtf8(const char ** src, size_t * bytes_left,
-          std::string * out) const
+  // Converts one UTF-8 sequence. Characters of single byte encodings are
+  // in Basic Multilingual Plane, so sequences are at most 3 bytes long.
+  bool Transcoder::FromUtf8(const uint8_t ** src, const uint8_t * end,
+      char * out) const
   {
-    size_t simbol_length = utf8_size(**src);
-    if (simbol_length > *bytes_left)
+    const uint8_t * p = *src;
+    uint16_t utf16;
+    if (*p < 0x80)
+    {
+      utf16 = *p;
+      ++p;
+    }
+    else if (*p < 0xC0)
+    {
       return false;
-    uint16_t utf16_char[2] = {0,0};
-    if (!utf8_to_utf16(utf16_char, *src))
+    }
+    else if (*p < 0xE0)
+    {
+      if (end - p < 2 || (p[1] & 0xC0) != 0x80)
+        return false;
+      utf16 = static_cast<uint16_t>(((p[0] & 0x1F) << 6) | (p[1] & 0x3F));
+      p += 2;
+    }
+    else if (*p < 0xF0)
+    {
+      if (end - p < 3 || (p[1] & 0xC0) != 0x80 || (p[2] & 0xC0) != 0x80)
+        return false;
+      utf16 = static_cast<uint16_t>(((p[0] & 0x0F) << 12) |
+          ((p[1] & 0x3F) << 6) | (p[2] & 0x3F));
+      p += 3;
+    }
+    else
       return false;
-    char c;
-    if (!GetChar(utf16_char[0], &c))
+
+    if (!GetChar(utf16, out))
       return false;
-    out->push_back(c);
-    *bytes_left -= simbol_length;
-    *src += simbol_length;
+    *src = p;
     return true;
   }
 
+  //----------------------------------------------------------------------------
+  bool Transcoder::FromUtf8(const char * src, size_t size, char * out,
+      size_t * written) const
+  {
+    const uint8_t * p = reinterpret_cast<const uint8_t *>(src),
+        * end = p + size;
+    char * o = out;
+    bool ok = true;
+    while (p != end)
+    {
+      if (ascii_as_is_)
+      {
+        size_t ascii = ascii_prefix(p, static_cast<size_t>(end - p));
+        std::memcpy(o, p, ascii);
+        o += ascii;
+        p += ascii;
+        if (p == end)
+          break;
+      }
+
+      if (unlikely(!FromUtf8(&p, end, o)))
+      {
+        ok = false;
+        break;
+      }
+      ++o;
+    }
+
+    *written = static_cast<size_t>(o - out);
+    return ok;
+  }
+
+  //----------------------------------------------------------------------------
+  bool Transcoder::ToUtf8(const char * src, size_t size, char * out,
+      size_t * written) const
+  {
+    const uint8_t * p = reinterpret_cast<const uint8_t *>(src),
+        * end = p + size;
+    char * o = out;
+    bool ok = true;
+    while (p != end)
+    {
+      if (ascii_as_is_)
+      {
+        size_t ascii = ascii_prefix(p, static_cast<size_t>(end - p));
+        std::memcpy(o, p, ascii);
+        o += ascii;
+        p += ascii;
+        if (p == end)
+          break;
+      }
+
+      const Utf8Char & utf8 = to_utf8_[*p];
+      if (unlikely(utf8.size_ == 0))
+      {
+        ok = false;
+        break;
+      }
+      // there is room for MAX_UTF8_CHAR_SIZE bytes for every character
+      std::memcpy(o, utf8.bytes_, MAX_UTF8_CHAR_SIZE);
+      o += utf8.size_;
+      ++p;
+    }
+
+    *written = static_cast<size_t>(o - out);
+    return ok;
+  }
+
   //----------------------------------------------------------------------------
   bool Transcoder::FromUtf8(const std::string & src, SPECIAL_CHAR_CALLBACK cb,
               std::string * out) const
   {
-    const char * p = src.data();
-    size_t bytes_left = src.size();
-    while (bytes_left > 0)
+    const uint8_t * p = reinterpret_cast<const uint8_t *>(src.data()),
+        * end = p + src.size();
+    while (p != end)
     {
-      if (unlikely(cb(*p, out)))
+      if (unlikely(cb(static_cast<char>(*p), out)))
       {
-        bytes_left--;
-        p++;
+        ++p;
+        continue;
       }
-      else if (!FromUtf8(&p, &bytes_left, out))
+
+      char ch;
+      if (!FromUtf8(&p, end, &ch))
         return false;
+      out->push_back(ch);
     }
     return true;
   }
@@ -190,55 +353,57 @@ namespace nkit
   //----------------------------------------------------------------------------
   bool Transcoder::FromUtf8(const std::string & src, std::string * out) const
   {
-    const char * p = src.data();
-    size_t bytes_left = src.size();
-    while (bytes_left > 0)
-    {
-      if (!FromUtf8(&p, &bytes_left, out))
-        return false;
-    }
-    return true;
+    return FromUtf8(src.data(), src.size(), out);
   }
 
   bool Transcoder::FromUtf8(const char * src, size_t size,
       std::string * out) const
   {
-    return FromUtf8(&src, &size, out);
+    size_t old_size = out->size(), written = 0;
+    out->resize(old_size + size);
+    bool ok = size == 0 || FromUtf8(src, size, &(*out)[old_size], &written);
+    out->resize(old_size + written);
+    return ok;
   }
 
+  //----------------------------------------------------------------------------
   bool Transcoder::ToUtf8(const std::string & src, std::string * out) const
   {
-    uint16_t utf16[2] = {0,0};
-    char utf8[6] = {0,0,0,0,0,0};
-    std::string::const_iterator c = src.begin(), end = src.end();
-    for (; c != end; ++c)
-    {
-      uint8_t ch = *c;
-      utf16[0] = char_to_single_utf16_map_[ch];
-      utf16[1] = 0;
-      uint8_t bytes_written = 0;
-      if (!utf16_to_utf8(utf8, utf16, &bytes_written))
-        return false;
-      out->append(utf8, bytes_written);
-    }
-    return true;
+    return ToUtf8(src.data(), src.size(), out);
+  }
+
+  bool Transcoder::ToUtf8(const char * src, size_t size,
+      std::string * out) const
+  {
+    size_t old_size = out->size(), written = 0;
+    out->resize(old_size + size * MAX_UTF8_CHAR_SIZE);
+    bool ok = size == 0 || ToUtf8(src, size, &(*out)[old_size], &written);
+    out->resize(old_size + written);
+    return ok;
   }
 
   //----------------------------------------------------------------------------
   void Transcoder::AddMapping(uint16_t single_utf16_c, char c)
   {
-    single_utf16_to_char_hash_table_[
-            single_utf16_c % ALL_CHARS_LEN][single_utf16_c] = c;
+    size_t high = single_utf16_c >> 8;
+    if (page_index_[high] == NO_PAGE)
+    {
+      page_index_[high] = static_cast<uint16_t>(pages_.size() / CHARS_COUNT);
+      pages_.resize(pages_.size() + CHARS_COUNT, -1);
+    }
+    pages_[page_index_[high] * CHARS_COUNT + (single_utf16_c & 0xFF)] =
+        static_cast<uint8_t>(c);
   }
 
   bool Transcoder::GetChar(uint16_t single_utf16_c, char * c) const
   {
-    const SingleUtf16ToCharMap & mapping =
-            single_utf16_to_char_hash_table_[single_utf16_c % ALL_CHARS_LEN];
-    SingleUtf16ToCharMap::const_iterator it = mapping.find(single_utf16_c);
-    if (unlikely(it == mapping.end()))
+    uint16_t page = page_index_[single_utf16_c >> 8];
+    if (unlikely(page == NO_PAGE))
+      return false;
+    int16_t ch = pages_[page * CHARS_COUNT + (single_utf16_c & 0xFF)];
+    if (unlikely(ch == -1))
       return false;
-    *c = it->second;
+    *c = static_cast<char>(ch);
     return true;
   }
 
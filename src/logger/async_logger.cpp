@@ -0,0 +1,337 @@
+/*
+   Copyright 2014 Boris T. Darchiev (boris.darchiev@gmail.com)
+                  Vasiliy Soshnikov (dedok.mad@gmail.com)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include <nkit/logger.h>
+#include <nkit/logger/async_logger.h>
+
+#include <nkit/detail/push_options.h>
+#include <nkit/tools.h>
+#include <nkit/threading/once.h>
+
+namespace nkit
+{
+  namespace detail
+  {
+    // Spins of waiting thread before it starts to sleep
+    static const size_t ASYNC_LOG_SPIN_COUNT = 256;
+
+    static NKIT_THREAD_LOCAL LogLineStream * async_log_stream_ = NULL;
+
+#if !defined(NKIT_WINNT)
+    // Streams are deleted on thread exit through key destructor.
+    // On Windows they live till process exit.
+    static pthread_key_t async_log_stream_key_;
+    static Once async_log_stream_once_ = NKIT_ONCE_INIT;
+
+    static void delete_async_log_stream(void * stream)
+    {
+      delete static_cast<LogLineStream *>(stream);
+    }
+
+    static void create_async_log_stream_key()
+    {
+      pthread_key_create(&async_log_stream_key_, delete_async_log_stream);
+    }
+#endif
+
+    LogLineStream & async_log_stream()
+    {
+      if (unlikely(!async_log_stream_))
+      {
+        async_log_stream_ = new LogLineStream;
+#if !defined(NKIT_WINNT)
+        CallOnce(&async_log_stream_once_, create_async_log_stream_key);
+        pthread_setspecific(async_log_stream_key_, async_log_stream_);
+#endif
+      }
+      return *async_log_stream_;
+    }
+
+    static void async_log_wait(size_t * spins)
+    {
+      if (++(*spins) < ASYNC_LOG_SPIN_COUNT)
+        cpu_relax();
+      else
+        nkit::sleep(1);
+    }
+  } // namespace detail
+
+  Logger::Ptr AsyncLogger::Create(const Logger::Ptr & target,
+      const Options & options, std::string * error)
+  {
+    if (!target)
+    {
+      if (error)
+        *error = "AsyncLogger: target logger is not set";
+      return Logger::Ptr();
+    }
+
+    AsyncLogger * logger = new AsyncLogger(target, options);
+    if (!logger->Start())
+    {
+      delete logger;
+      if (error)
+        *error = "AsyncLogger: could not start writer thread";
+      return Logger::Ptr();
+    }
+
+    return Logger::Ptr(logger);
+  }
+
+  AsyncLogger::AsyncLogger(const Logger::Ptr & target,
+      const Options & options)
+    : target_(target)
+    , capacity_(options.queue_size ? options.queue_size : DEFAULT_QUEUE_SIZE)
+    , batch_size_(options.batch_size ? options.batch_size
+        : DEFAULT_BATCH_SIZE)
+    , overflow_(options.overflow)
+    , head_(&stub_)
+    , tail_(&stub_)
+    , size_(0)
+    , pushed_(0)
+    , written_(0)
+    , dropped_(0)
+    , stop_(0)
+    , started_(false)
+  {
+    stub_.next_ = NULL;
+    async_ = true;
+  }
+
+  AsyncLogger::~AsyncLogger()
+  {
+    if (started_)
+    {
+      detail::atomic_store(&stop_, uint32_t(1));
+#if defined(NKIT_WINNT)
+      WaitForSingleObject(thread_, INFINITE);
+      CloseHandle(thread_);
+#else
+      pthread_join(thread_, NULL);
+#endif
+    }
+
+    while (WriteBatch())
+      ;
+  }
+
+  bool AsyncLogger::Start()
+  {
+#if defined(NKIT_WINNT)
+    thread_ = CreateThread(NULL, 0, ThreadProc, this, 0, NULL);
+    started_ = thread_ != NULL;
+#else
+    started_ = pthread_create(&thread_, NULL, ThreadProc, this) == 0;
+#endif
+    return started_;
+  }
+
+#if defined(NKIT_WINNT)
+  DWORD WINAPI AsyncLogger::ThreadProc(LPVOID arg)
+  {
+    static_cast<AsyncLogger *>(arg)->Run();
+    return 0;
+  }
+#else
+  void * AsyncLogger::ThreadProc(void * arg)
+  {
+    static_cast<AsyncLogger *>(arg)->Run();
+    return NULL;
+  }
+#endif
+
+  void AsyncLogger::Flush()
+  {
+    uint64_t pushed = detail::atomic_load(&pushed_);
+    size_t spins = 0;
+    while (detail::atomic_load(&written_) < pushed)
+      detail::async_log_wait(&spins);
+  }
+
+  // Used when AsyncLogger is target of other AsyncLogger
+  bool AsyncLogger::WriteLine(detail::LogLevel level, time_t now,
+      bool put_header)
+  {
+    if (!Reserve())
+      return false;
+
+    detail::AsyncLogRecord * record = new detail::AsyncLogRecord;
+    record->level_ = level;
+    record->now_ = now;
+    record->put_header_ = put_header;
+    record->binary_ = false;
+    record->text_ = stream().str();
+    detail::atomic_add(&pushed_, uint64_t(1));
+    Enqueue(record);
+    return true;
+  }
+
+  bool AsyncLogger::WriteRecord(detail::LogLevel level, time_t now,
+      bool put_header, const char * data, size_t size)
+  {
+    PushRecord(level, now, put_header, data, size);
+    return true;
+  }
+
+  void AsyncLogger::Push(detail::LogLevel level, time_t now, bool put_header,
+      detail::LogLineStream * stream)
+  {
+    if (Reserve())
+    {
+      detail::AsyncLogRecord * record = new detail::AsyncLogRecord;
+      record->level_ = level;
+      record->now_ = now;
+      record->put_header_ = put_header;
+      record->binary_ = false;
+      record->text_ = stream->str();
+      detail::atomic_add(&pushed_, uint64_t(1));
+      Enqueue(record);
+    }
+    stream->str("");
+  }
+
+  void AsyncLogger::PushRecord(detail::LogLevel level, time_t now,
+      bool put_header, const char * data, size_t size)
+  {
+    if (!Reserve())
+      return;
+
+    detail::AsyncLogRecord * record = new detail::AsyncLogRecord;
+    record->level_ = level;
+    record->now_ = now;
+    record->put_header_ = put_header;
+    record->binary_ = true;
+    record->text_.assign(data, size);
+    detail::atomic_add(&pushed_, uint64_t(1));
+    Enqueue(record);
+  }
+
+  // Takes place in queue. Returns false if line must be dropped
+  bool AsyncLogger::Reserve()
+  {
+    size_t spins = 0;
+    while (true)
+    {
+      uint64_t size = detail::atomic_load(&size_);
+      if (size < capacity_)
+      {
+        if (detail::atomic_cas(&size_, size, size + 1))
+          return true;
+        continue;
+      }
+
+      if (overflow_ == ASYNC_OVERFLOW_DROP)
+      {
+        detail::atomic_add(&dropped_, uint64_t(1));
+        return false;
+      }
+
+      detail::async_log_wait(&spins);
+    }
+  }
+
+  void AsyncLogger::Enqueue(detail::AsyncLogRecord * record)
+  {
+    record->next_ = NULL;
+    detail::AsyncLogRecord * prev = detail::atomic_exchange(&head_, record);
+    detail::atomic_store(&prev->next_, record);
+  }
+
+  // Called by writer thread only. Returns NULL if queue is empty or its
+  // last record is not linked by producer yet
+  detail::AsyncLogRecord * AsyncLogger::Dequeue()
+  {
+    detail::AsyncLogRecord * tail = tail_;
+    detail::AsyncLogRecord * next = detail::atomic_load(&tail->next_);
+    if (tail == &stub_)
+    {
+      if (!next)
+        return NULL;
+      tail_ = next;
+      tail = next;
+      next = detail::atomic_load(&next->next_);
+    }
+
+    if (next)
+    {
+      tail_ = next;
+      return tail;
+    }
+
+    if (tail != detail::atomic_load(&head_))
+      return NULL;
+
+    Enqueue(&stub_);
+
+    next = detail::atomic_load(&tail->next_);
+    if (next)
+    {
+      tail_ = next;
+      return tail;
+    }
+    return NULL;
+  }
+
+  size_t AsyncLogger::WriteBatch()
+  {
+    detail::AsyncLogRecord * record = Dequeue();
+    if (!record)
+      return 0;
+
+    size_t count = 0;
+    {
+      LockGuard<Mutex> guard(target_->mutex_);
+      do
+      {
+        if (record->binary_)
+          target_->WriteRecord(record->level_, record->now_,
+              record->put_header_, record->text_.data(),
+              record->text_.size());
+        else
+          target_->WriteFormatted(record->level_, record->now_,
+              record->put_header_, record->text_);
+        delete record;
+        ++count;
+      } while (count < batch_size_ && (record = Dequeue()) != NULL);
+      target_->Flush();
+    }
+
+    detail::atomic_sub(&size_, uint64_t(count));
+    detail::atomic_add(&written_, uint64_t(count));
+    return count;
+  }
+
+  void AsyncLogger::Run()
+  {
+    size_t spins = 0;
+    while (true)
+    {
+      // stop_ is read before queue, so lines queued before stop are written
+      bool stop = detail::atomic_load(&stop_) != 0;
+      if (WriteBatch())
+      {
+        spins = 0;
+        continue;
+      }
+
+      if (stop && detail::atomic_load(&size_) == 0)
+        break;
+
+      detail::async_log_wait(&spins);
+    }
+  }
+} // namespace nkit
@@ -0,0 +1,610 @@
+/*
+   Copyright 2014 Boris T. Darchiev (boris.darchiev@gmail.com)
+                  Vasiliy Soshnikov (dedok.mad@gmail.com)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include <nkit/logger.h>
+#include <nkit/logger/log_record.h>
+#include <nkit/dynamic_json.h>
+#include <nkit/threading/rw_lock.h>
+
+#include <nkit/detail/push_options.h>
+#include <nkit/tools.h>
+
+#include <cmath>
+#include <deque>
+#include <map>
+
+namespace nkit
+{
+  namespace detail
+  {
+    static const char LOG_RECORD_FILE_MAGIC[] = "NKLR0001";
+    static const size_t LOG_RECORD_FILE_MAGIC_SIZE =
+        sizeof(LOG_RECORD_FILE_MAGIC) - 1;
+
+    enum LogRecordFrameKind
+    {
+      LOG_FRAME_FORMAT = 1,
+      LOG_FRAME_RECORD = 2
+    };
+
+    //--------------------------------------------------------------------------
+    // Format registry. Strings are never removed and deque does not move
+    // them, so pointers returned by GetLogFormat() are valid till process
+    // exit. Formats are read by every formatted record and registered once
+    // per call site, so readers do not exclude each other.
+    class LogFormatRegistry
+    {
+    public:
+      uint32_t Register(const char * format)
+      {
+        LockGuard<RWLock> guard(lock_);
+        std::map<std::string, uint32_t>::const_iterator it =
+            ids_.find(format);
+        if (it != ids_.end())
+          return it->second;
+
+        formats_.push_back(format);
+        uint32_t id = static_cast<uint32_t>(formats_.size());
+        ids_[formats_.back()] = id;
+        return id;
+      }
+
+      const char * Get(uint32_t id)
+      {
+        ReadLockGuard<RWLock> guard(lock_);
+        if (id == 0 || id > formats_.size())
+          return NULL;
+        return formats_[id - 1].c_str();
+      }
+
+    private:
+      RWLock lock_;
+      std::map<std::string, uint32_t> ids_;
+      std::deque<std::string> formats_;
+    };
+
+    static LogFormatRegistry & log_format_registry()
+    {
+      static LogFormatRegistry * registry = new LogFormatRegistry;
+      return *registry;
+    }
+
+    //--------------------------------------------------------------------------
+    struct LogArg
+    {
+      LogArgType type_;
+      int64_t i_;
+      uint64_t u_;
+      double d_;
+      const char * str_;
+      size_t size_;
+    };
+
+    template <typename T>
+    static bool read_log_value(const char ** begin, const char * end, T * v)
+    {
+      if (static_cast<size_t>(end - *begin) < sizeof(T))
+        return false;
+      std::memcpy(v, *begin, sizeof(T));
+      *begin += sizeof(T);
+      return true;
+    }
+
+    // Reads arguments of record one by one
+    class LogArgReader
+    {
+    public:
+      LogArgReader(const char * begin, const char * end)
+        : pos_(begin)
+        , end_(end)
+        , error_(false)
+      {}
+
+      bool Next(LogArg * arg)
+      {
+        if (pos_ == end_)
+          return false;
+
+        uint8_t type = static_cast<uint8_t>(*pos_++);
+        arg->type_ = static_cast<LogArgType>(type);
+        bool ok;
+        switch (type)
+        {
+        case LOG_ARG_INT64:
+          ok = read_log_value(&pos_, end_, &arg->i_);
+          break;
+        case LOG_ARG_UINT64:
+          ok = read_log_value(&pos_, end_, &arg->u_);
+          break;
+        case LOG_ARG_DOUBLE:
+          ok = read_log_value(&pos_, end_, &arg->d_);
+          break;
+        case LOG_ARG_BOOL:
+        {
+          uint8_t b = 0;
+          ok = read_log_value(&pos_, end_, &b);
+          arg->u_ = b;
+          break;
+        }
+        case LOG_ARG_STRING:
+        case LOG_ARG_JSON:
+        {
+          uint32_t size = 0;
+          ok = read_log_value(&pos_, end_, &size) &&
+              size <= static_cast<size_t>(end_ - pos_);
+          if (ok)
+          {
+            arg->str_ = pos_;
+            arg->size_ = size;
+            pos_ += size;
+          }
+          break;
+        }
+        default:
+          ok = false;
+          break;
+        }
+
+        if (!ok)
+        {
+          error_ = true;
+          pos_ = end_;
+        }
+        return ok;
+      }
+
+      bool error() const { return error_; }
+
+    private:
+      const char * pos_;
+      const char * end_;
+      bool error_;
+    };
+
+    static void append_log_arg_text(const LogArg & arg, std::string * out)
+    {
+      char tmp[NUMBER_TO_CHARS_BUFFER_SIZE];
+      switch (arg.type_)
+      {
+      case LOG_ARG_INT64:
+        out->append(tmp, int64_to_chars(arg.i_, tmp));
+        break;
+      case LOG_ARG_UINT64:
+        out->append(tmp, uint64_to_chars(arg.u_, tmp));
+        break;
+      case LOG_ARG_DOUBLE:
+        out->append(tmp, double_to_chars(arg.d_, tmp));
+        break;
+      case LOG_ARG_BOOL:
+        out->append(arg.u_ ? "true" : "false");
+        break;
+      case LOG_ARG_STRING:
+      case LOG_ARG_JSON:
+        out->append(arg.str_, arg.size_);
+        break;
+      }
+    }
+
+    static void append_log_arg_json(const LogArg & arg, std::string * out)
+    {
+      switch (arg.type_)
+      {
+      case LOG_ARG_DOUBLE:
+        // JSON has no NaN and infinity
+        if (std::isnan(arg.d_) || std::isinf(arg.d_))
+          out->append("null");
+        else
+          append_log_arg_text(arg, out);
+        break;
+      case LOG_ARG_STRING:
+        write_json_string(std::string(arg.str_, arg.size_), out);
+        break;
+      default:
+        append_log_arg_text(arg, out);
+        break;
+      }
+    }
+
+    static Dynamic log_arg_to_dynamic(const LogArg & arg)
+    {
+      switch (arg.type_)
+      {
+      case LOG_ARG_INT64:
+        return Dynamic(arg.i_);
+      case LOG_ARG_UINT64:
+        return Dynamic(arg.u_);
+      case LOG_ARG_DOUBLE:
+        return Dynamic(arg.d_);
+      case LOG_ARG_BOOL:
+        return Dynamic(arg.u_ != 0);
+      case LOG_ARG_STRING:
+        return Dynamic(arg.str_, arg.size_);
+      case LOG_ARG_JSON:
+      {
+        std::string error;
+        return DynamicFromJson(std::string(arg.str_, arg.size_), &error);
+      }
+      }
+      return Dynamic();
+    }
+
+    // Each '{}' is replaced by next argument, rest of arguments
+    // are appended through space
+    static bool append_log_record_text(const char * format,
+        LogArgReader * reader, std::string * out)
+    {
+      LogArg arg;
+      const char * begin = format;
+      const char * placeholder;
+      while ((placeholder = std::strstr(begin, "{}")) != NULL)
+      {
+        out->append(begin, placeholder);
+        begin = placeholder + 2;
+        if (reader->Next(&arg))
+          append_log_arg_text(arg, out);
+        else
+          out->append("{}");
+      }
+      out->append(begin);
+
+      while (reader->Next(&arg))
+      {
+        out->push_back(' ');
+        append_log_arg_text(arg, out);
+      }
+      return !reader->error();
+    }
+
+    static bool read_log_format_id(const char ** begin, const char * end,
+        uint32_t * format_id)
+    {
+      return read_log_value(begin, end, format_id);
+    }
+
+    //--------------------------------------------------------------------------
+    bool format_log_record(const char * data, size_t size, std::string * out)
+    {
+      const char * end = data + size;
+      uint32_t format_id;
+      if (!read_log_format_id(&data, end, &format_id))
+        return false;
+
+      const char * format = GetLogFormat(format_id);
+      if (!format)
+        format = "{}";
+
+      LogArgReader reader(data, end);
+      return append_log_record_text(format, &reader, out);
+    }
+
+    void put_log_arg(const Dynamic & v, LogRecordBuffer * buffer)
+    {
+      switch (v.type())
+      {
+      case INTEGER:
+        LogArgTraits<int64_t>::Put(v.GetSignedInteger(), buffer);
+        break;
+      case UNSIGNED_INTEGER:
+        LogArgTraits<uint64_t>::Put(v.GetUnsignedInteger(), buffer);
+        break;
+      case FLOAT:
+        LogArgTraits<double>::Put(v.GetFloat(), buffer);
+        break;
+      case BOOL:
+        LogArgTraits<bool>::Put(v.GetBoolean(), buffer);
+        break;
+      case STRING:
+      {
+        const std::string & str = v.GetConstString();
+        put_log_arg_string(str.data(), str.size(), LOG_ARG_STRING, buffer);
+        break;
+      }
+      default:
+      {
+        std::string json;
+        DynamicToJson(v, &json);
+        put_log_arg_string(json.data(), json.size(), LOG_ARG_JSON, buffer);
+        break;
+      }
+      }
+    }
+
+    static const char * log_level_json_name(LogLevel level)
+    {
+      switch (level)
+      {
+      case LL_DEBUG:
+        return "debug";
+      case LL_INFO:
+        return "info";
+      case LL_WARN:
+        return "warning";
+      case LL_ERROR:
+        return "error";
+      default:
+        return "unknown";
+      }
+    }
+  } // namespace detail
+
+  //----------------------------------------------------------------------------
+  uint32_t RegisterLogFormat(const char * format)
+  {
+    return detail::log_format_registry().Register(format);
+  }
+
+  const char * GetLogFormat(uint32_t format_id)
+  {
+    return detail::log_format_registry().Get(format_id);
+  }
+
+  //----------------------------------------------------------------------------
+  Logger::Ptr LogRecordFileLogger::Create(const std::string & file_path,
+      LogRecordFileFormat format, std::string * error)
+  {
+    LogRecordFileLogger * logger = new LogRecordFileLogger(format);
+    std::ios_base::openmode mode = std::ios_base::out | std::ios_base::app;
+    if (format == LOG_RECORD_FILE_BINARY)
+      mode |= std::ios_base::binary;
+    logger->file_stream_.open(file_path.c_str(), mode);
+    if (!logger->file_stream_.is_open())
+    {
+      delete logger;
+      if (error)
+        *error = "Could not open log file '" + file_path + "'";
+      return Logger::Ptr();
+    }
+
+    if (format == LOG_RECORD_FILE_BINARY)
+    {
+      logger->file_stream_.seekp(0, std::ios_base::end);
+      if (logger->file_stream_.tellp() == std::streampos(0))
+        logger->file_stream_.write(detail::LOG_RECORD_FILE_MAGIC,
+            detail::LOG_RECORD_FILE_MAGIC_SIZE);
+    }
+
+    return Logger::Ptr(logger);
+  }
+
+  LogRecordFileLogger::LogRecordFileLogger(LogRecordFileFormat format)
+    : format_(format)
+    , text_format_id_(RegisterLogFormat("{}"))
+  {}
+
+  LogRecordFileLogger::~LogRecordFileLogger()
+  {
+    file_stream_.flush();
+  }
+
+  bool LogRecordFileLogger::WriteLine(detail::LogLevel level, time_t now,
+      bool put_header)
+  {
+    bool ok = WriteFormatted(level, now, put_header, stream().str());
+    file_stream_.flush();
+    return ok;
+  }
+
+  bool LogRecordFileLogger::WriteFormatted(detail::LogLevel level,
+      time_t now, bool put_header, const std::string & text)
+  {
+    text_record_.clear();
+    text_record_.append_value(text_format_id_);
+    detail::put_log_arg_string(text.data(), text.size(),
+        detail::LOG_ARG_STRING, &text_record_);
+    return WriteRecord(level, now, put_header, text_record_.data(),
+        text_record_.size());
+  }
+
+  bool LogRecordFileLogger::WriteRecord(detail::LogLevel level, time_t now,
+      bool, const char * data, size_t size)
+  {
+    if (format_ == LOG_RECORD_FILE_BINARY)
+      return WriteBinary(level, now, data, size);
+    return WriteJson(level, now, data, size);
+  }
+
+  bool LogRecordFileLogger::WriteRecordLine(detail::LogLevel level,
+      time_t now, bool put_header, const char * data, size_t size)
+  {
+    bool ok = WriteRecord(level, now, put_header, data, size);
+    file_stream_.flush();
+    return ok;
+  }
+
+  void LogRecordFileLogger::Flush()
+  {
+    file_stream_.flush();
+  }
+
+  bool LogRecordFileLogger::WriteJson(detail::LogLevel level, time_t now,
+      const char * data, size_t size)
+  {
+    const char * end = data + size;
+    uint32_t format_id;
+    if (!detail::read_log_format_id(&data, end, &format_id))
+      return false;
+    const char * format = GetLogFormat(format_id);
+    if (!format)
+      format = "{}";
+
+    char tmp[NUMBER_TO_CHARS_BUFFER_SIZE];
+    line_.assign("{\"time\": ");
+    line_.append(tmp, int64_to_chars(static_cast<int64_t>(now), tmp));
+    line_.append(", \"level\": \"");
+    line_.append(detail::log_level_json_name(level));
+    line_.append("\", \"format\": ");
+    detail::write_json_string(std::string(format), &line_);
+
+    std::string message;
+    detail::LogArgReader text_reader(data, end);
+    detail::append_log_record_text(format, &text_reader, &message);
+    line_.append(", \"message\": ");
+    detail::write_json_string(message, &line_);
+
+    line_.append(", \"args\": [");
+    detail::LogArgReader reader(data, end);
+    detail::LogArg arg;
+    bool first = true;
+    while (reader.Next(&arg))
+    {
+      if (!first)
+        line_.append(", ");
+      first = false;
+      detail::append_log_arg_json(arg, &line_);
+    }
+    line_.append("]}\n");
+
+    file_stream_.write(line_.data(),
+        static_cast<std::streamsize>(line_.size()));
+    return !reader.error() && file_stream_.good();
+  }
+
+  bool LogRecordFileLogger::WriteBinary(detail::LogLevel level, time_t now,
+      const char * data, size_t size)
+  {
+    uint32_t format_id;
+    const char * pos = data;
+    if (!detail::read_log_format_id(&pos, data + size, &format_id))
+      return false;
+
+    line_.clear();
+    if (written_formats_.insert(format_id).second)
+    {
+      const char * format = GetLogFormat(format_id);
+      if (!format)
+        format = "{}";
+      size_t format_size = std::strlen(format);
+      uint32_t frame_size = static_cast<uint32_t>(1 + sizeof(format_id) +
+          format_size);
+      line_.append(reinterpret_cast<const char *>(&frame_size),
+          sizeof(frame_size));
+      line_.push_back(static_cast<char>(detail::LOG_FRAME_FORMAT));
+      line_.append(reinterpret_cast<const char *>(&format_id),
+          sizeof(format_id));
+      line_.append(format, format_size);
+    }
+
+    int64_t time = static_cast<int64_t>(now);
+    uint32_t frame_size = static_cast<uint32_t>(2 + sizeof(time) + size);
+    line_.append(reinterpret_cast<const char *>(&frame_size),
+        sizeof(frame_size));
+    line_.push_back(static_cast<char>(detail::LOG_FRAME_RECORD));
+    line_.push_back(static_cast<char>(level));
+    line_.append(reinterpret_cast<const char *>(&time), sizeof(time));
+    line_.append(data, size);
+
+    file_stream_.write(line_.data(),
+        static_cast<std::streamsize>(line_.size()));
+    return file_stream_.good();
+  }
+
+  //----------------------------------------------------------------------------
+  bool ReadLogRecordFile(const std::string & file_path,
+      LogRecordCallback callback, void * context, std::string * error)
+  {
+    std::ifstream file(file_path.c_str(),
+        std::ios_base::in | std::ios_base::binary);
+    if (!file.is_open())
+    {
+      *error = "Could not open log file '" + file_path + "'";
+      return false;
+    }
+    std::ostringstream stream;
+    stream << file.rdbuf();
+    const std::string & content = stream.str();
+
+    if (content.size() < detail::LOG_RECORD_FILE_MAGIC_SIZE ||
+        content.compare(0, detail::LOG_RECORD_FILE_MAGIC_SIZE,
+        detail::LOG_RECORD_FILE_MAGIC) != 0)
+    {
+      *error = "'" + file_path + "' is not binary log record file";
+      return false;
+    }
+
+    std::map<uint32_t, std::string> formats;
+    std::string message;
+    const char * pos = content.data() + detail::LOG_RECORD_FILE_MAGIC_SIZE;
+    const char * end = content.data() + content.size();
+    while (pos < end)
+    {
+      uint32_t frame_size;
+      if (!detail::read_log_value(&pos, end, &frame_size) ||
+          frame_size == 0 || frame_size > static_cast<size_t>(end - pos))
+      {
+        *error = "Truncated log record file '" + file_path + "'";
+        return false;
+      }
+
+      const char * frame_end = pos + frame_size;
+      uint8_t kind = static_cast<uint8_t>(*pos++);
+      if (kind == detail::LOG_FRAME_FORMAT)
+      {
+        uint32_t format_id;
+        if (!detail::read_log_format_id(&pos, frame_end, &format_id))
+        {
+          *error = "Wrong format frame in '" + file_path + "'";
+          return false;
+        }
+        formats[format_id].assign(pos, frame_end);
+      }
+      else if (kind == detail::LOG_FRAME_RECORD)
+      {
+        uint8_t level;
+        int64_t time;
+        uint32_t format_id;
+        if (!detail::read_log_value(&pos, frame_end, &level) ||
+            !detail::read_log_value(&pos, frame_end, &time) ||
+            !detail::read_log_format_id(&pos, frame_end, &format_id))
+        {
+          *error = "Wrong record frame in '" + file_path + "'";
+          return false;
+        }
+
+        std::map<uint32_t, std::string>::const_iterator format =
+            formats.find(format_id);
+        const char * format_text = format != formats.end() ?
+            format->second.c_str() : "{}";
+
+        message.clear();
+        detail::LogArgReader text_reader(pos, frame_end);
+        bool ok = detail::append_log_record_text(format_text, &text_reader,
+            &message);
+
+        Dynamic args = Dynamic::List();
+        detail::LogArgReader reader(pos, frame_end);
+        detail::LogArg arg;
+        while (reader.Next(&arg))
+          args.PushBack(detail::log_arg_to_dynamic(arg));
+
+        if (!ok || reader.error())
+        {
+          *error = "Wrong record arguments in '" + file_path + "'";
+          return false;
+        }
+
+        if (!callback(static_cast<detail::LogLevel>(level),
+            static_cast<time_t>(time), message, args, context))
+          return true;
+      }
+      // frames of unknown kinds are skipped
+
+      pos = frame_end;
+    }
+
+    return true;
+  }
+} // namespace nkit
@@ -22,11 +22,16 @@
 #include <nkit/tools.h>
 #include <nkit/dynamic.h>
 
+#include <algorithm>
+#include <cerrno>
 #include <cstdio>
 #include <iostream>
 
 #if defined(NKIT_POSIX_PLATFORM)
 #  include <unistd.h>
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
 #  include <sys/types.h>
 #elif defined(NKIT_WINNT)
 #  pragma warning(disable : 4996)
@@ -37,6 +42,11 @@
 namespace nkit
 {
   Logger::Ptr Logger::logger_;
+#ifdef NKIT_DEBUG
+  volatile uint32_t Logger::min_level_ = detail::LL_DEBUG;
+#else
+  volatile uint32_t Logger::min_level_ = detail::LL_INFO;
+#endif
   ConsoleLogger::Ptr console_logger = ConsoleLogger::Create();
 
   namespace detail
@@ -80,39 +90,304 @@ namespace nkit
     }
   } // namespace
 
+  namespace detail
+  {
+#if !defined(NKIT_WINNT)
+    static size_t page_size()
+    {
+      static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+      return size;
+    }
+
+    // Size of file without zero tail of mapped window, which is left in
+    // file if process has not closed it (e.g. crashed)
+    static std::streamoff data_size(int fd, std::streamoff size)
+    {
+      char buffer[4096];
+      while (size > 0)
+      {
+        size_t part = static_cast<size_t>(
+            std::min(size, static_cast<std::streamoff>(sizeof(buffer))));
+        std::streamoff offset = size - static_cast<std::streamoff>(part);
+        if (::pread(fd, buffer, part, offset) != static_cast<ssize_t>(part))
+          break;
+        while (part && buffer[part - 1] == '\0')
+          --part;
+        if (part)
+          return offset + static_cast<std::streamoff>(part);
+        size = offset;
+      }
+      return size;
+    }
+#endif
+
+    //--------------------------------------------------------------------------
+    // Appends to file through memory mapped window, or by write() calls if
+    // window is disabled or could not be mapped (e.g. disk is full).
+    // Window is mapped on first write, so file opened in advance stays empty.
+    class LogFileSegment
+    {
+    public:
+      LogFileSegment()
+        : size_(0)
+#if !defined(NKIT_WINNT)
+        , fd_(-1)
+        , window_(NULL)
+        , window_offset_(0)
+        , window_size_(0)
+        , window_pos_(0)
+        , map_pending_(false)
+#endif
+      {}
+
+      ~LogFileSegment()
+      {
+        Close();
+      }
+
+      std::streamoff size() const { return size_; }
+
+#if defined(NKIT_WINNT)
+      bool Open(const std::string & path, size_t, std::string * error)
+      {
+        stream_.open(path.c_str(), std::fstream::app);
+        if (!stream_.is_open())
+        {
+          *error = "RotateLogger cannot open file : " + path;
+          return false;
+        }
+        stream_.seekp(0, std::ios_base::end);
+        size_ = stream_.tellp();
+        return true;
+      }
+
+      void Write(const char * data, size_t size)
+      {
+        stream_.write(data, static_cast<std::streamsize>(size));
+        size_ += size;
+      }
+
+      void Flush()
+      {
+        stream_.flush();
+      }
+
+      void Close()
+      {
+        if (stream_.is_open())
+          stream_.close();
+      }
+#else
+      bool Open(const std::string & path, size_t window_size,
+          std::string * error)
+      {
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0666);
+        struct stat st;
+        if (fd_ < 0 || ::fstat(fd_, &st) != 0)
+        {
+          *error = "RotateLogger cannot open file : " + path;
+          Close();
+          return false;
+        }
+        size_ = data_size(fd_, st.st_size);
+        if (size_ != st.st_size && ::ftruncate(fd_, size_) != 0)
+          std::cerr << "RotateLogger: could not truncate log file\n";
+
+        if (window_size)
+        {
+          window_size_ = (window_size + page_size() - 1) / page_size() *
+              page_size();
+          map_pending_ = true;
+        }
+        return true;
+      }
+
+      void Write(const char * data, size_t size)
+      {
+        if (unlikely(map_pending_))
+        {
+          map_pending_ = false;
+          Map(size_);
+        }
+
+        while (window_ && size)
+        {
+          if (window_pos_ == window_size_ &&
+              !Map(window_offset_ + static_cast<std::streamoff>(window_size_)))
+            break;
+          size_t part = std::min(size, window_size_ - window_pos_);
+          std::memcpy(window_ + window_pos_, data, part);
+          window_pos_ += part;
+          size_ += part;
+          data += part;
+          size -= part;
+        }
+
+        while (size)
+        {
+          ssize_t written = ::pwrite(fd_, data, size, size_);
+          if (written < 0)
+          {
+            if (errno == EINTR)
+              continue;
+            return;
+          }
+          size_ += written;
+          data += written;
+          size -= static_cast<size_t>(written);
+        }
+      }
+
+      // Written data is in page cache already
+      void Flush() {}
+
+      // Cuts zero tail of window
+      void Close()
+      {
+        if (fd_ < 0)
+          return;
+        Unmap();
+        if (::ftruncate(fd_, size_) != 0)
+          std::cerr << "RotateLogger: could not truncate log file\n";
+        ::close(fd_);
+        fd_ = -1;
+      }
+
+    private:
+      bool Map(std::streamoff offset)
+      {
+        Unmap();
+
+        std::streamoff window_offset = offset -
+            offset % static_cast<std::streamoff>(page_size());
+#if defined(__linux__)
+        // blocks are allocated now, so full disk is not SIGBUS on memcpy
+        if (::posix_fallocate(fd_, window_offset, window_size_) != 0)
+          return false;
+#else
+        if (::ftruncate(fd_, window_offset + window_size_) != 0)
+          return false;
+#endif
+        void * window = ::mmap(NULL, window_size_, PROT_READ | PROT_WRITE,
+            MAP_SHARED, fd_, window_offset);
+        if (window == MAP_FAILED)
+          return false;
+
+        window_ = static_cast<char *>(window);
+        window_offset_ = window_offset;
+        window_pos_ = static_cast<size_t>(offset - window_offset);
+        return true;
+      }
+
+      void Unmap()
+      {
+        if (window_)
+          ::munmap(window_, window_size_);
+        window_ = NULL;
+      }
+#endif
+
+    private:
+      LogFileSegment(const LogFileSegment &);
+      LogFileSegment & operator = (const LogFileSegment &);
+
+    private:
+      std::streamoff size_;
+#if defined(NKIT_WINNT)
+      std::ofstream stream_;
+#else
+      int fd_;
+      char * window_;
+      std::streamoff window_offset_;
+      size_t window_size_;
+      size_t window_pos_;
+      bool map_pending_;
+#endif
+    };
+  } // namespace detail
+
+  //----------------------------------------------------------------------------
   Logger::Ptr RotateLogger::Create(const std::string & file_path,
       RotateInterval rotate_interval, std::streamoff rotate_size,
       std::string * error)
   {
-    // check file can be opened
-    std::ofstream file_stream(file_path.c_str(), std::fstream::app);
-    if (!file_stream.is_open())
+    return Create(file_path, rotate_interval, rotate_size, RotateOptions(),
+        error);
+  }
+
+  Logger::Ptr RotateLogger::Create(const std::string & file_path,
+      RotateInterval rotate_interval, std::streamoff rotate_size,
+      const RotateOptions & options, std::string * error)
+  {
+    RotateLogger * logger = new RotateLogger(file_path, rotate_interval,
+        rotate_size, options);
+    std::string tmp;
+    if (!logger->Open(error ? error : &tmp))
     {
-      if (error)
-        *error = "RotateLogger cannot open file : " + file_path;
+      delete logger;
       return Logger::Ptr();
     }
-    file_stream.close();
 
-    return Logger::Ptr(new RotateLogger(file_path, rotate_interval,
-        rotate_size));
+    return Logger::Ptr(logger);
   }
 
   RotateLogger::RotateLogger(const std::string & file_path,
-      RotateInterval rotate_interval, std::streamoff rotate_size)
-    : file_stream_(file_path.c_str(), std::fstream::app)
-    , file_path_(file_path)
+      RotateInterval rotate_interval, std::streamoff rotate_size,
+      const RotateOptions & options)
+    : file_path_(file_path)
+    , next_path_(file_path + ".next")
     , rotate_size_(rotate_size)
     , rotate_interval_(rotate_interval)
+    , options_(options)
     , prev_rotate_time_(0)
     , next_rotate_time_(0)
     , rotate_by_size_counter_(-1)
+    , retry_rotate_time_(0)
+    , segment_(NULL)
+    , next_segment_(NULL)
+    , rotated_segment_(NULL)
+    , rotating_(0)
+    , rotation_started_(false)
   {
     UpdateRotateTimes();
   }
 
   RotateLogger::~RotateLogger()
   {
+    WaitRotation();
+    delete segment_;
+    if (next_segment_)
+    {
+      bool empty = next_segment_->size() == 0;
+      delete next_segment_;
+      if (empty)
+        std::remove(next_path_.c_str());
+    }
+  }
+
+  bool RotateLogger::Open(std::string * error)
+  {
+    segment_ = new detail::LogFileSegment;
+    if (!segment_->Open(file_path_, options_.segment_size, error))
+      return false;
+
+#if !defined(NKIT_WINNT)
+    // Windows can not rename file opened by ofstream, so rotation is
+    // done synchronously there
+    if (rotate_interval_ != ROTATE_INTERVAL_DISABLED ||
+        rotate_size_ != ROTATE_SIZE_DISABLED)
+    {
+      // without it rotation is done synchronously
+      std::string tmp;
+      next_segment_ = new detail::LogFileSegment;
+      if (!next_segment_->Open(next_path_, options_.segment_size, &tmp))
+      {
+        delete next_segment_;
+        next_segment_ = NULL;
+      }
+    }
+#endif
+    return true;
   }
 
   void print_time(time_t t)
@@ -146,64 +421,204 @@ namespace nkit
     next_rotate_time_ = prev_rotate_time_ + rotate_interval_;
   }
 
-  bool RotateLogger::WriteLine(detail::LogLevel level, time_t now, bool)
+  void RotateLogger::RotateIfNeeded(time_t now)
   {
     bool rotate_by_size = ((rotate_size_ != ROTATE_SIZE_DISABLED)
-        && ((std::streamoff)file_stream_.tellp()) >= rotate_size_);
+        && segment_->size() >= rotate_size_);
 
     bool rotate_by_time = (rotate_interval_ != ROTATE_INTERVAL_DISABLED)
         && now >= next_rotate_time_;
 
+    if (likely(!rotate_by_time && !rotate_by_size))
+      return;
+
+    // postponed till previous rotation is finished or till retry time
+    // after failed one
+    if (IsRotating() || now < retry_rotate_time_)
+      return;
+
+    bool rotated;
     if (rotate_by_time)
     {
-      Rotate(prev_rotate_time_, ++rotate_by_size_counter_);
-      UpdateRotateTimes();
-      rotate_by_size_counter_ = -1;
+      rotated = Rotate(prev_rotate_time_, rotate_by_size_counter_ + 1);
+      if (rotated)
+      {
+        UpdateRotateTimes();
+        rotate_by_size_counter_ = -1;
+      }
+    }
+    else if (rotate_interval_ == ROTATE_INTERVAL_DISABLED)
+    {
+      rotated = Rotate(now, 0);
     }
-    else if (rotate_by_size)
+    else
     {
-      if (rotate_interval_ == ROTATE_INTERVAL_DISABLED)
-        Rotate(now, 0);
-      else
-        Rotate(prev_rotate_time_, ++rotate_by_size_counter_);
+      rotated = Rotate(prev_rotate_time_, rotate_by_size_counter_ + 1);
+      if (rotated)
+        ++rotate_by_size_counter_;
     }
 
-    file_stream_ << GetHeader(level, now);
-    file_stream_ << stream().str();
-    file_stream_ << std::endl;
-    file_stream_.flush();
+    if (!rotated)
+      retry_rotate_time_ = now + ROTATE_RETRY_INTERVAL;
+  }
+
+  bool RotateLogger::WriteLine(detail::LogLevel level, time_t now, bool)
+  {
+    WriteFormatted(level, now, true, stream().str());
+    segment_->Flush();
+    return true;
+  }
+
+  // Line is assembled in reusable buffer and written by one call.
+  // Lines are not flushed one by one, Flush() is called after batch.
+  bool RotateLogger::WriteFormatted(detail::LogLevel level, time_t now, bool,
+      const std::string & text)
+  {
+    RotateIfNeeded(now);
+    line_.clear();
+    AppendHeader(level, now, &line_);
+    line_.append(text);
+    line_.push_back('\n');
+    segment_->Write(line_.data(), line_.size());
     return true;
   }
 
-  void RotateLogger::Rotate(time_t now, size_t suffix)
+  void RotateLogger::Flush()
+  {
+    segment_->Flush();
+  }
+
+  std::string RotateLogger::RotatedPath(time_t now, size_t suffix) const
   {
     char iso_time[128];
     struct tm ti;
     LOCALTIME_R(now, &ti);
 
-    file_stream_.close();
-
-    std::string error;
-    bool moved = false;
     if (unlikely(strftime(iso_time, sizeof(iso_time),
           "%Y-%m-%dT%H%M%S", &ti) == 0))
+      return file_path_ + "." + string_cast((uint64_t)now);
+
+    std::string ssuffix(suffix ? ("-" + string_cast(suffix)) : "");
+    return file_path_ + "." + iso_time + ssuffix;
+  }
+
+  bool RotateLogger::IsRotating() const
+  {
+    return detail::atomic_load(&rotating_) != 0;
+  }
+
+  // Joins finished rotation thread
+  void RotateLogger::WaitRotation()
+  {
+    if (!rotation_started_)
+      return;
+#if defined(NKIT_WINNT)
+    WaitForSingleObject(rotation_thread_, INFINITE);
+    CloseHandle(rotation_thread_);
+#else
+    pthread_join(rotation_thread_, NULL);
+#endif
+    rotation_started_ = false;
+  }
+
+  // Returns false if file could not be renamed, logger keeps writing to
+  // the same file then
+  bool RotateLogger::Rotate(time_t now, size_t suffix)
+  {
+    WaitRotation();
+    std::string rotated_path = RotatedPath(now, suffix);
+    std::string error;
+
+    if (unlikely(!next_segment_))
     {
-      moved = move_file(
-          file_path_, file_path_ + "." + string_cast((uint64_t)now), &error);
+      // next file could not be opened in advance (or it is Windows,
+      // where file is closed before it is renamed)
+      delete segment_;
+      segment_ = NULL;
+      bool moved = move_file(file_path_, rotated_path, &error);
+      std::string open_error;
+      segment_ = new detail::LogFileSegment;
+      if (!segment_->Open(file_path_, options_.segment_size, &open_error))
+        abort_with_core(open_error);
+      if (!moved)
+      {
+        std::cerr << "RotateLogger: could not rotate log file: " << error
+            << std::endl;
+        return false;
+      }
+      if (options_.on_rotated)
+        options_.on_rotated(rotated_path, options_.context);
+      return true;
     }
-    else
+
+    // Files are renamed while they are open, logger switches to next one
+    // after both renames are done
+    if (std::rename(file_path_.c_str(), rotated_path.c_str()) != 0)
     {
-      std::string ssuffix(suffix ? ("-" + string_cast(suffix)) : "");
-      moved = move_file(
-          file_path_, file_path_ + "." + iso_time + ssuffix, &error);
+      std::cerr << "RotateLogger: could not rotate log file: "
+          << strerror(errno) << std::endl;
+      return false;
+    }
+    if (std::rename(next_path_.c_str(), file_path_.c_str()) != 0)
+    {
+      std::cerr << "RotateLogger: could not rotate log file: "
+          << strerror(errno) << std::endl;
+      if (std::rename(rotated_path.c_str(), file_path_.c_str()) != 0)
+        std::cerr << "RotateLogger: could not rename log file back: "
+            << strerror(errno) << std::endl;
+      return false;
     }
 
-    if (!moved)
-      abort_with_core("Could not rotate log file: " + error);
+    rotated_path_ = rotated_path;
+    rotated_segment_ = segment_;
+    segment_ = next_segment_;
+    next_segment_ = NULL;
+    detail::atomic_store(&rotating_, uint32_t(1));
+#if defined(NKIT_WINNT)
+    rotation_thread_ = CreateThread(NULL, 0, RotationProc, this, 0, NULL);
+    rotation_started_ = rotation_thread_ != NULL;
+#else
+    rotation_started_ = pthread_create(&rotation_thread_, NULL,
+        RotationProc, this) == 0;
+#endif
+    if (!rotation_started_)
+      FinishRotation();
+    return true;
+  }
 
-    file_stream_.open(file_path_.c_str(), std::fstream::app);
-    if (unlikely(!file_stream_.is_open()))
-      abort_with_core("RotateLogger open file error : " + file_path_);
+#if defined(NKIT_WINNT)
+  DWORD WINAPI RotateLogger::RotationProc(LPVOID arg)
+  {
+    static_cast<RotateLogger *>(arg)->FinishRotation();
+    return 0;
   }
-} // namespace nkit
+#else
+  void * RotateLogger::RotationProc(void * arg)
+  {
+    static_cast<RotateLogger *>(arg)->FinishRotation();
+    return NULL;
+  }
+#endif
+
+  // Files are renamed already and logger writes to the new one. Old file
+  // is closed (and its zero tail is cut), new next file is opened.
+  void RotateLogger::FinishRotation()
+  {
+    delete rotated_segment_;
+    rotated_segment_ = NULL;
 
+    std::string error;
+    detail::LogFileSegment * next = new detail::LogFileSegment;
+    if (!next->Open(next_path_, options_.segment_size, &error))
+    {
+      delete next;
+      next = NULL;
+    }
+    next_segment_ = next;
+
+    if (options_.on_rotated)
+      options_.on_rotated(rotated_path_, options_.context);
+
+    detail::atomic_store(&rotating_, uint32_t(0));
+  }
+} // namespace nkit
@@ -35,6 +35,8 @@
 #include "nkit/logger.h"
 #include "nkit/logger/rsyslog_logger.h"
 
+#include <algorithm>
+
 namespace nkit
 {
   const char * get_level(detail::LogLevel level, int * prior)
@@ -90,8 +92,7 @@ namespace nkit
     int prior;
     const char * message_level = get_level(level, &prior);
 
-    std::string message = stream().str();
-    syslog(prior, "[%s] %s", message_level, message.c_str());
+    syslog(prior, "[%s] %s", message_level, stream().str().c_str());
 
     return true;
   }
@@ -109,13 +110,20 @@ namespace nkit
   static const int socket_type__ = ALL_TYPES;
 
   //-----------------------------------------------------------------------------
-  RSysLoggerBase::RSysLoggerBase(int facility, const std::string & ident)
+  RSysLoggerBase::RSysLoggerBase(int facility, const std::string & ident,
+      const RSysBatchOptions & batch)
     : pid_(get_process_id())
     , tag_(ident)
     , facility_(facility)
     , ident_(ident)
     , sockfd_(CLOSED_SOCKET)
     , fac_mask_(facility & LOG_FACMASK)
+    , socktype_(SOCK_DGRAM)
+    , batch_(batch)
+    , pending_first_(0)
+    , first_pending_time_(0)
+    , next_connect_time_(0)
+    , dropped_(0)
   {
     std::string login = get_username();
     if (login.empty())
@@ -137,6 +145,28 @@ namespace nkit
     }
     else
       tag_ = login + " " + tag_;
+
+    for (size_t i = 0; i <= detail::LL_MAX; ++i)
+    {
+      int prior;
+      detail::LogLevel level = static_cast<detail::LogLevel>(i);
+      const char * message_level = get_level(level, &prior);
+      if (level == detail::LL_DEBUG)
+        prior = LOG_INFO;
+      header_prefixes_[i] = "<" + string_cast(
+          static_cast<uint32_t>(prior & LOG_PRIMASK)) + ">";
+      header_suffixes_[i] = " " + tag_.substr(0, MAX_TAG_SIZE) + pid_ +
+          ": [" + message_level + "] ";
+    }
+  }
+
+  static size_t append_bounded(char * buf, size_t size, size_t capacity,
+      const char * data, size_t data_size)
+  {
+    if (data_size > capacity - size)
+      data_size = capacity - size;
+    memcpy(buf + size, data, data_size);
+    return size + data_size;
   }
 
   void RSysLoggerBase::CloseConnection(bool graceful)
@@ -156,77 +186,211 @@ namespace nkit
 
   bool RSysLoggerBase::WriteLine(detail::LogLevel level, time_t now, bool)
   {
+    // "<pri>Mmm dd hh:mm:ss tag[pid]: [level] message" from pre-rendered
+    // parts, without heap allocations
     char buf[MAX_HEADER_SIZE + MAX_MESSAGE_SIZE];
-    std::string msg = stream().str();
-    int prior;
-    const char * message_level = get_level(level, &prior);
-    if (level == detail::LL_DEBUG)
-      prior = LOG_INFO;
-    int syslog_pri = prior & LOG_PRIMASK;
-    /*
-    switch (level)
+    const size_t capacity = sizeof(buf) - 1;
+    size_t index = static_cast<size_t>(level) < detail::LL_MAX ?
+        static_cast<size_t>(level) : static_cast<size_t>(detail::LL_MAX);
+    const std::string & prefix = header_prefixes_[index];
+    const std::string & suffix = header_suffixes_[index];
+    const std::string & msg = stream().str();
+
+    size_t time_size;
+    const char * time = GetTime(now, &time_size);
+    if (time_size > SYSLOG_TIME_SIZE)
+      time_size = SYSLOG_TIME_SIZE;
+
+    size_t size = 0;
+    size = append_bounded(buf, size, capacity, prefix.data(), prefix.size());
+    size = append_bounded(buf, size, capacity, time, time_size);
+    size = append_bounded(buf, size, capacity, suffix.data(), suffix.size());
+    size = append_bounded(buf, size, capacity, msg.data(),
+        std::min(msg.size(), static_cast<size_t>(MAX_MESSAGE_SIZE)));
+    buf[size] = '\0';
+
+    if (pending_first_ == pending_ends_.size())
+      first_pending_time_ = now;
+    pending_.append(buf, size);
+    pending_ends_.push_back(pending_.size());
+    TrimBacklog();
+
+    size_t lines = pending_ends_.size() - pending_first_;
+    size_t bytes = pending_.size() - PendingBegin(pending_first_);
+    if (lines >= batch_.max_lines || bytes >= batch_.max_bytes
+        || level >= detail::LL_ERROR
+        || now - first_pending_time_ >= batch_.flush_interval)
+      SendPending(now);
+
+    return true;
+  }
+
+  void RSysLoggerBase::Flush()
+  {
+    SendPending(time(NULL));
+  }
+
+  // Returns false if some lines are left not sent
+  bool RSysLoggerBase::SendPending(time_t now)
+  {
+    if (pending_first_ == pending_ends_.size())
+      return true;
+
+    if (sockfd_ == CLOSED_SOCKET)
     {
-    case detail::LL_DEBUG:
-    case detail::LL_INFO:
-      syslog_pri = fac_mask_ | (LOG_INFO & LOG_PRIMASK);
-      break;
-    case detail::LL_WARN:
-      syslog_pri = fac_mask_ | (LOG_WARNING & LOG_PRIMASK);
-      break;
-    default:
-      syslog_pri = fac_mask_ | (LOG_ERR & LOG_PRIMASK);
-      break;
-    }
-    */
-    static const uint16_t CTIME_BUF_LEN = 32;
-    char ctime_buf[CTIME_BUF_LEN];
-    CTIME_R(now, ctime_buf, CTIME_BUF_LEN);
-    int len = NKIT_SNPRINTF(buf, sizeof(buf),
-        "<%d>%.15s %.200s%s: [%s] %.1992s",
-        syslog_pri, ctime_buf + 4, tag_.c_str(), pid_.c_str(), message_level,
-        msg.c_str());
-
-    if (unlikely(sockfd_ == -1))
-      if (!Connect())
+      if (now < next_connect_time_)
+        return false;
+      Connect();
+      if (sockfd_ == CLOSED_SOCKET)
+      {
+        next_connect_time_ = now + RECONNECT_INTERVAL;
         return false;
+      }
+    }
 
-    if (likely(sockfd_ != -1))
+    bool ok = (socktype_ == SOCK_STREAM) ? SendStream() : SendDatagrams();
+    if (!ok)
     {
-      int sent = 0;
-      while (sent < len)
+      CloseConnection(false);
+      next_connect_time_ = now + RECONNECT_INTERVAL;
+    }
+    Compact();
+    return ok;
+  }
+
+#if defined(__APPLE__)
+  static const int SEND_FLAGS = SO_NOSIGPIPE;
+#else
+  static const int SEND_FLAGS = MSG_NOSIGNAL;
+#endif
+
+  // One datagram per line
+  bool RSysLoggerBase::SendDatagrams()
+  {
+    while (pending_first_ < pending_ends_.size())
+    {
+#if defined(__linux__)
+      struct mmsghdr messages[MAX_DATAGRAMS_PER_CALL];
+      struct iovec iovecs[MAX_DATAGRAMS_PER_CALL];
+      size_t count = std::min(pending_ends_.size() - pending_first_,
+          static_cast<size_t>(MAX_DATAGRAMS_PER_CALL));
+      memset(messages, 0, sizeof(messages[0]) * count);
+      for (size_t i = 0; i < count; ++i)
       {
-#ifdef __APPLE__
-        sent = sent + send(sockfd_, buf + sent, len, SO_NOSIGPIPE);
+        size_t begin = PendingBegin(pending_first_ + i);
+        iovecs[i].iov_base = &pending_[begin];
+        iovecs[i].iov_len = pending_ends_[pending_first_ + i] - begin;
+        messages[i].msg_hdr.msg_iov = &iovecs[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+      }
+
+      int sent = sendmmsg(sockfd_, messages, static_cast<unsigned int>(count),
+          SEND_FLAGS);
 #else
-        sent = sent + send(sockfd_, buf + sent, len, MSG_NOSIGNAL);
+      size_t begin = PendingBegin(pending_first_);
+      int sent = send(sockfd_, pending_.data() + begin,
+          static_cast<int>(pending_ends_[pending_first_] - begin),
+          SEND_FLAGS) == SOCKET_ERROR ? -1 : 1;
 #endif
-        if (unlikely(sent == -1 && errno != 0))
-        {
-          fprintf(stderr, "%s\n", buf);
-          CloseConnection(true);
-        }
-        else if (sent == 0)
-          break;
-        len = len - sent;
+      if (sent < 0)
+      {
+        if (errno == EINTR)
+          continue;
+        errno = 0;
+        return false;
       }
+      pending_first_ += static_cast<size_t>(sent);
     }
-    else
+    return true;
+  }
+
+  // RFC 6587 octet counting: "MSG-LEN SP SYSLOG-MSG" frames by one write
+  bool RSysLoggerBase::SendStream()
+  {
+    frame_.clear();
+    for (size_t i = pending_first_; i < pending_ends_.size(); ++i)
     {
-      switch (level)
+      size_t begin = PendingBegin(i);
+      size_t size = pending_ends_[i] - begin;
+      char length[24];
+      int length_size = NKIT_SNPRINTF(length, sizeof(length), "%u ",
+          static_cast<uint32_t>(size));
+      frame_.append(length, static_cast<size_t>(length_size));
+      frame_.append(pending_, begin, size);
+    }
+
+    size_t sent = 0;
+    while (sent < frame_.size())
+    {
+      int ret = send(sockfd_, frame_.data() + sent,
+          static_cast<int>(frame_.size() - sent), SEND_FLAGS);
+      if (ret == SOCKET_ERROR || ret == 0)
       {
-      case detail::LL_DEBUG:
-      case detail::LL_INFO:
-        std::cout << buf << std::endl;
-        std::cout.flush();
-        break;
-      default:
-        std::cerr << buf << std::endl;
-        std::cerr.flush();
+        if (ret == SOCKET_ERROR && errno == EINTR)
+          continue;
+        errno = 0;
         break;
       }
+      sent += static_cast<size_t>(ret);
     }
 
-    return true;
+    if (sent == frame_.size())
+    {
+      pending_first_ = pending_ends_.size();
+      return true;
+    }
+
+    // lines sent completely are not sent again after reconnect
+    size_t framed = 0;
+    while (pending_first_ < pending_ends_.size())
+    {
+      size_t size = pending_ends_[pending_first_] -
+          PendingBegin(pending_first_);
+      framed += string_cast(static_cast<uint32_t>(size)).size() + 1 + size;
+      if (framed > sent)
+        break;
+      ++pending_first_;
+    }
+    return false;
+  }
+
+  // Drops oldest lines above max_backlog_bytes, last line is always kept
+  void RSysLoggerBase::TrimBacklog()
+  {
+    while (pending_ends_.size() - pending_first_ > 1
+        && pending_.size() - PendingBegin(pending_first_) >
+            batch_.max_backlog_bytes)
+    {
+      ++pending_first_;
+      ++dropped_;
+    }
+
+    if (pending_first_ >= MAX_DATAGRAMS_PER_CALL
+        && pending_first_ * 2 >= pending_ends_.size())
+      Compact();
+  }
+
+  // Removes sent and dropped lines from buffer
+  void RSysLoggerBase::Compact()
+  {
+    if (!pending_first_)
+      return;
+
+    if (pending_first_ == pending_ends_.size())
+    {
+      pending_.clear();
+      pending_ends_.clear();
+      pending_first_ = 0;
+      return;
+    }
+
+    size_t offset = PendingBegin(pending_first_);
+    pending_.erase(0, offset);
+    pending_ends_.erase(pending_ends_.begin(),
+        pending_ends_.begin() + static_cast<std::ptrdiff_t>(pending_first_));
+    for (size_t i = 0; i < pending_ends_.size(); ++i)
+      pending_ends_[i] -= offset;
+    pending_first_ = 0;
   }
 
 #if defined(NKIT_POSIX_PLATFORM)
@@ -235,7 +399,7 @@ namespace nkit
   //-----------------------------------------------------------------------------
   Logger::Ptr RSysUnixSocketLogger::Create(int facility,
       const std::string & ident, const std::string & unix_socket,
-      std::string * error)
+      std::string * error, const RSysBatchOptions & batch)
   {
     if (unix_socket.empty())
     {
@@ -251,7 +415,7 @@ namespace nkit
     }
 
     return Logger::Ptr(
-        new RSysUnixSocketLogger(facility, ident, unix_socket));
+        new RSysUnixSocketLogger(facility, ident, unix_socket, batch));
   }
 
   //----------------------------------------------------------------------------
@@ -280,6 +444,7 @@ namespace nkit
         continue;
       }
 
+      socktype_ = st;
       break;
     }
 
@@ -295,7 +460,8 @@ namespace nkit
   // RSysEndpointLogger
   //-----------------------------------------------------------------------------
   Logger::Ptr RSysEndpointLogger::Create(int facility, const std::string & ident,
-      const std::string & host, const std::string & port, std::string * error)
+      const std::string & host, const std::string & port, std::string * error,
+      const RSysBatchOptions & batch)
   {
     if (host.empty() || port.empty())
     {
@@ -303,7 +469,8 @@ namespace nkit
       return Logger::Ptr();
     }
 
-    return Logger::Ptr(new RSysEndpointLogger(facility, ident, host, port));
+    return Logger::Ptr(new RSysEndpointLogger(facility, ident, host, port,
+        batch));
   }
 
   //----------------------------------------------------------------------------
@@ -357,6 +524,7 @@ namespace nkit
           continue;
       }
 
+      socktype_ = hints.ai_socktype;
       freeaddrinfo(_addrinfo);
       break;
     }
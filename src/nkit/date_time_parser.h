@@ -0,0 +1,162 @@
+/*
+   Copyright 2014 Boris T. Darchiev (boris.darchiev@gmail.com)
+                  Vasiliy Soshnikov (dedok.mad@gmail.com)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef __NKIT__DATE__TIME__PARSER__H__
+#define __NKIT__DATE__TIME__PARSER__H__
+
+#include "nkit/dynamic.h"
+
+#include <string>
+#include <vector>
+
+namespace nkit
+{
+  //----------------------------------------------------------------------------
+  // Fields which are not set by format keep values of zeroed 'struct tm'
+  // as with strptime(): year 1900, January, day 0 (invalid date).
+  struct DateTimeFields
+  {
+    DateTimeFields()
+      : year(1900)
+      , month(1)
+      , day(0)
+      , hour(0)
+      , minute(0)
+      , second(0)
+      , microsec(0)
+    {}
+
+    // Seconds since epoch, fields are taken as UTC
+    int64_t utc_timestamp() const
+    {
+      return detail::days_from_civil(year, month, day) * 86400
+          + int64_t(hour) * 3600 + minute * 60 + second;
+    }
+
+    uint32_t year;
+    uint32_t month;
+    uint32_t day;
+    uint32_t hour;
+    uint32_t minute;
+    uint32_t second;
+    uint32_t microsec;
+  };
+
+  // Extended "YYYY-MM-DDThh:mm:ss" and basic "YYYYMMDDThhmmss" forms.
+  // Seconds may have up to 6 fraction digits and 'Z' may follow them.
+  bool parse_iso8601(const char * str, size_t size, DateTimeFields * out);
+
+  namespace detail
+  {
+    // parse_iso8601() with other separator of date and time
+    bool parse_date_time(const char * str, size_t size, char separator,
+        DateTimeFields * out);
+
+    // Default format of Dynamic: "YYYY-MM-DD hh:mm:ss" without fraction
+    // and 'Z'
+    bool parse_default_date_time(const char * str, size_t size,
+        DateTimeFields * out);
+  } // namespace detail
+
+  //----------------------------------------------------------------------------
+  // strptime() format compiled to list of steps once. Numbers, literals,
+  // white spaces, %Y %y %m %d %e %H %k %I %l %M %S %p %b %B %h %a %A %T %D
+  // %F %R %n %t %% are parsed by steps (names in "C" locale only), other
+  // formats are given to strptime().
+  class DateTimeParser
+  {
+    DateTimeParser(const DateTimeParser &);
+    DateTimeParser & operator = (const DateTimeParser &);
+
+    enum StepKind
+    {
+      STEP_LITERAL = 0,
+      STEP_SPACES,
+      STEP_NUMBER,       // number in [from_, to_] goes to field_
+      STEP_YEAR2,
+      STEP_HOUR12,
+      STEP_AM_PM,
+      STEP_MONTH_NAME,
+      STEP_WEEKDAY_NAME
+    };
+
+    struct Step
+    {
+      Step(StepKind kind, char literal = '\0')
+        : kind_(kind)
+        , literal_(literal)
+        , digits_(0)
+        , from_(0)
+        , to_(0)
+        , field_(NULL)
+      {}
+
+      Step(uint32_t DateTimeFields::* field, uint32_t from, uint32_t to,
+          uint32_t digits)
+        : kind_(STEP_NUMBER)
+        , literal_('\0')
+        , digits_(digits)
+        , from_(from)
+        , to_(to)
+        , field_(field)
+      {}
+
+      StepKind kind_;
+      char literal_;
+      uint32_t digits_;
+      uint32_t from_;
+      uint32_t to_;
+      uint32_t DateTimeFields::* field_;
+    };
+
+  public:
+    typedef detail::ref_count_ptr<DateTimeParser> Ptr;
+
+    static Ptr Create(const std::string & format);
+
+    // Parser of 'format' from process-wide cache, parsers are never deleted
+    static const DateTimeParser & Get(const char * format);
+
+    // Rest of 'str' after format is ignored, as by strptime()
+    bool Parse(const char * str, size_t size, DateTimeFields * out) const;
+
+    // Undef if 'str' does not match format or date is wrong
+    Dynamic Parse(const std::string & str) const;
+
+    const std::string & format() const { return format_; }
+
+    // false if strptime() is used
+    bool compiled() const { return !fallback_; }
+
+  private:
+    explicit DateTimeParser(const std::string & format);
+    void Compile();
+    void Add(StepKind kind, char literal = '\0');
+    void AddNumber(uint32_t DateTimeFields::* field, uint32_t from,
+        uint32_t to, uint32_t digits);
+    bool ParseFixed(const char * str, DateTimeFields * out) const;
+    bool Strptime(const char * str, size_t size, DateTimeFields * out) const;
+
+  private:
+    std::string format_;
+    std::vector<Step> steps_;
+    size_t fixed_size_; // input size if every number has all its digits
+    bool fallback_;
+  }; // class DateTimeParser
+} // namespace nkit
+
+#endif // __NKIT__DATE__TIME__PARSER__H__
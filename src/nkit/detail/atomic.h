@@ -0,0 +1,212 @@
+/*
+   Copyright 2010-2015 Boris T. Darchiev (boris.darchiev@gmail.com)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef __NKIT__DETAIL__ATOMIC__H__
+#define __NKIT__DETAIL__ATOMIC__H__
+
+#include <nkit/types.h>
+
+namespace nkit
+{
+  namespace detail
+  {
+    //--------------------------------------------------------------------------
+    // Minimal set of atomic operations on 32/64 bit integers and pointers.
+    // Loads have acquire semantics, stores have release semantics,
+    // read-modify-write operations are full barriers.
+    // atomic_add()/atomic_sub() return the new value.
+    // memory_barrier() is full fence.
+    //--------------------------------------------------------------------------
+#if defined(NKIT_WINNT)
+
+    inline uint32_t atomic_load(const volatile uint32_t * v)
+    {
+      uint32_t result = *v;
+      MemoryBarrier();
+      return result;
+    }
+
+    inline uint64_t atomic_load(const volatile uint64_t * v)
+    {
+      return static_cast<uint64_t>(InterlockedCompareExchange64(
+          reinterpret_cast<volatile LONGLONG *>(const_cast<uint64_t *>(v)),
+          0, 0));
+    }
+
+    inline void atomic_store(volatile uint32_t * v, uint32_t value)
+    {
+      MemoryBarrier();
+      *v = value;
+    }
+
+    inline void atomic_store(volatile uint64_t * v, uint64_t value)
+    {
+      InterlockedExchange64(reinterpret_cast<volatile LONGLONG *>(v),
+          static_cast<LONGLONG>(value));
+    }
+
+    inline uint32_t atomic_add(volatile uint32_t * v, uint32_t delta)
+    {
+      return static_cast<uint32_t>(InterlockedExchangeAdd(
+          reinterpret_cast<volatile LONG *>(v),
+          static_cast<LONG>(delta))) + delta;
+    }
+
+    inline uint64_t atomic_add(volatile uint64_t * v, uint64_t delta)
+    {
+      return static_cast<uint64_t>(InterlockedExchangeAdd64(
+          reinterpret_cast<volatile LONGLONG *>(v),
+          static_cast<LONGLONG>(delta))) + delta;
+    }
+
+    inline uint32_t atomic_sub(volatile uint32_t * v, uint32_t delta)
+    {
+      return atomic_add(v, static_cast<uint32_t>(0) - delta);
+    }
+
+    inline uint64_t atomic_sub(volatile uint64_t * v, uint64_t delta)
+    {
+      return atomic_add(v, static_cast<uint64_t>(0) - delta);
+    }
+
+    inline uint32_t atomic_exchange(volatile uint32_t * v, uint32_t value)
+    {
+      return static_cast<uint32_t>(InterlockedExchange(
+          reinterpret_cast<volatile LONG *>(v), static_cast<LONG>(value)));
+    }
+
+    inline uint64_t atomic_exchange(volatile uint64_t * v, uint64_t value)
+    {
+      return static_cast<uint64_t>(InterlockedExchange64(
+          reinterpret_cast<volatile LONGLONG *>(v),
+          static_cast<LONGLONG>(value)));
+    }
+
+    inline bool atomic_cas(volatile uint32_t * v, uint32_t expected,
+        uint32_t desired)
+    {
+      return static_cast<uint32_t>(InterlockedCompareExchange(
+          reinterpret_cast<volatile LONG *>(v), static_cast<LONG>(desired),
+          static_cast<LONG>(expected))) == expected;
+    }
+
+    inline bool atomic_cas(volatile uint64_t * v, uint64_t expected,
+        uint64_t desired)
+    {
+      return static_cast<uint64_t>(InterlockedCompareExchange64(
+          reinterpret_cast<volatile LONGLONG *>(v),
+          static_cast<LONGLONG>(desired),
+          static_cast<LONGLONG>(expected))) == expected;
+    }
+
+    template <typename T>
+    inline T * atomic_load(T * const volatile * v)
+    {
+      T * result = *v;
+      MemoryBarrier();
+      return result;
+    }
+
+    template <typename T>
+    inline void atomic_store(T * volatile * v, T * value)
+    {
+      MemoryBarrier();
+      *v = value;
+    }
+
+    template <typename T>
+    inline T * atomic_exchange(T * volatile * v, T * value)
+    {
+      return static_cast<T *>(InterlockedExchangePointer(
+          reinterpret_cast<PVOID volatile *>(v), value));
+    }
+
+    template <typename T>
+    inline bool atomic_cas(T * volatile * v, T * expected, T * desired)
+    {
+      return InterlockedCompareExchangePointer(
+          reinterpret_cast<PVOID volatile *>(v), desired, expected)
+          == expected;
+    }
+
+    inline void memory_barrier()
+    {
+      MemoryBarrier();
+    }
+
+    inline void cpu_relax()
+    {
+      YieldProcessor();
+    }
+
+#else // GCC and compatible compilers
+
+    template <typename T>
+    inline T atomic_load(const volatile T * v)
+    {
+      return __atomic_load_n(v, __ATOMIC_ACQUIRE);
+    }
+
+    template <typename T>
+    inline void atomic_store(volatile T * v, T value)
+    {
+      __atomic_store_n(v, value, __ATOMIC_RELEASE);
+    }
+
+    template <typename T>
+    inline T atomic_add(volatile T * v, T delta)
+    {
+      return __atomic_add_fetch(v, delta, __ATOMIC_SEQ_CST);
+    }
+
+    template <typename T>
+    inline T atomic_sub(volatile T * v, T delta)
+    {
+      return __atomic_sub_fetch(v, delta, __ATOMIC_SEQ_CST);
+    }
+
+    template <typename T>
+    inline T atomic_exchange(volatile T * v, T value)
+    {
+      return __atomic_exchange_n(v, value, __ATOMIC_SEQ_CST);
+    }
+
+    template <typename T>
+    inline bool atomic_cas(volatile T * v, T expected, T desired)
+    {
+      return __atomic_compare_exchange_n(v, &expected, desired, false,
+          __ATOMIC_SEQ_CST, __ATOMIC_ACQUIRE);
+    }
+
+    inline void memory_barrier()
+    {
+      __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    }
+
+    inline void cpu_relax()
+    {
+#  if defined(__i386__) || defined(__x86_64__)
+      __asm__ __volatile__("pause");
+#  elif defined(__aarch64__)
+      __asm__ __volatile__("yield");
+#  endif
+    }
+
+#endif // NKIT_WINNT
+  } // namespace detail
+} // namespace nkit
+
+#endif // __NKIT__DETAIL__ATOMIC__H__
@@ -18,11 +18,13 @@
 #define __NKIT__REF__COUNT__PTR__H__
 
 #include <nkit/types.h>
+#include <nkit/detail/atomic.h>
 
 namespace nkit
 {
   namespace detail
   {
+    // Counter is updated atomically, as in shared_ptr
     template<typename T>
     class ref_count_ptr
     {
@@ -58,10 +60,10 @@ namespace nkit
       {
         if (counter_ != NULL)
         {
-          if (--(*counter_) == 0)
+          if (atomic_sub(counter_, static_cast<uint64_t>(1)) == 0)
           {
             delete obj_;
-            delete counter_;
+            delete const_cast<uint64_t *>(counter_);
           }
           obj_ = NULL;
           counter_ = NULL;
@@ -114,12 +116,12 @@ namespace nkit
       void increment()
       {
         if (counter_ != NULL)
-          ++(*counter_);
+          atomic_add(counter_, static_cast<uint64_t>(1));
       }
 
     private:
       T * obj_;
-      uint64_t * counter_;
+      volatile uint64_t * counter_;
     };  // class ref_count_ptr
   }// namespace detail
 } // namespace nkit
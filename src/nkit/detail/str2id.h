@@ -3,112 +3,116 @@
 
 #include <string.h>
 
-#include <cstdlib>
 #include <string>
-#include <map>
+#include <vector>
 
 #include "nkit/constants.h"
 #include "nkit/tools.h"
+#include "nkit/dynamic/key_pool.h"
 
 namespace nkit
 {
   //---------------------------------------------------------------------------
+  // Interns element names to dense ids: 0 is '*', others start from 1.
+  // Names are kept in id order, so GetString() is an index operation, and
+  // looked up through open addressing table with precomputed hashes.
   class String2IdMap
   {
   public:
     static const size_t STAR_ID = 0;
 
   private:
-    struct CompareStrings
+    struct Slot
     {
-      bool operator ()(const char * s1, const char * s2) const
-      {
-        return strcmp(s1, s2) < 0;
-      }
+      Slot() : hash_(0), id_(EMPTY_SLOT) {}
+
+      uint64_t hash_;
+      size_t id_;
     };
 
-    typedef std::map<char *, size_t, CompareStrings> Name2Id;
+    static const size_t EMPTY_SLOT = static_cast<size_t>(-1);
+    static const size_t INITIAL_SLOT_COUNT = 64;
 
   public:
     String2IdMap()
-      : max_element_id_(1)
+      : slots_(INITIAL_SLOT_COUNT)
     {
-      name2id_[NKIT_STRDUP(S_STAR_.c_str())] = STAR_ID;
+      GetId(S_STAR_.data(), S_STAR_.size());
     }
 
-    String2IdMap(const String2IdMap & from)
+    size_t GetId(const char * str)
     {
-      Set(from);
+      return GetId(str, strlen(str));
     }
 
-    ~String2IdMap()
+    size_t GetId(const char * str, size_t size)
     {
-      Clear();
+      return GetId(str, size, detail::hash_bytes(str, size));
     }
 
-    String2IdMap & operator =(const String2IdMap & from)
+    size_t GetId(const char * str, size_t size, uint64_t hash)
     {
-      if (this != &from)
-        Set(from);
-
-      return *this;
-    }
+      size_t mask = slots_.size() - 1;
+      size_t i = static_cast<size_t>(hash) & mask;
+      while (slots_[i].id_ != EMPTY_SLOT)
+      {
+        const Slot & slot = slots_[i];
+        if (slot.hash_ == hash)
+        {
+          const std::string & name = names_[slot.id_];
+          if (name.size() == size && memcmp(name.data(), str, size) == 0)
+            return slot.id_;
+        }
+        i = (i + 1) & mask;
+      }
 
-    size_t GetId(const char * str)
-    {
-      Name2Id::const_iterator it = name2id_.find(const_cast<char *>(str)), end =
-          name2id_.end();
-      if (it != end)
-        return it->second;
-      size_t element_id = max_element_id_++;
-      name2id_.insert(std::make_pair(NKIT_STRDUP(str), element_id));
+      size_t element_id = names_.size();
+      names_.push_back(std::string(str, size));
+      slots_[i].hash_ = hash;
+      slots_[i].id_ = element_id;
+      if (names_.size() * 2 > slots_.size())
+        Grow();
       return element_id;
     }
 
-    std::string GetString(size_t id) const
+    const std::string & GetString(size_t id) const
     {
-      Name2Id::const_iterator it = name2id_.begin(), end = name2id_.end();
-      for (; it != end; ++it)
-        if (it->second == id)
-          return std::string(it->first);
-      return std::string("");
+      if (id < names_.size())
+        return names_[id];
+      return S_EMPTY_;
     }
 
+    size_t size() const { return names_.size(); }
+
     std::ostream & operator >> (std::ostream & str) const
     {
-      Name2Id::const_iterator it = name2id_.begin(), end = name2id_.end();
-      for (; it != end; ++it)
-      {
-          str << std::string(it->first) << std::string(": ") <<
-        		  string_cast(it->second) << '\n';
-      }
+      for (size_t id = 0; id < names_.size(); ++id)
+        str << names_[id] << std::string(": ") << string_cast(id) << '\n';
       return str;
     }
 
   private:
-    void Clear()
+    void Grow()
     {
-      max_element_id_ = 1;
-
-      Name2Id::const_iterator it = name2id_.begin(), end = name2id_.end();
+      std::vector<Slot> slots(slots_.size() * 2);
+      size_t mask = slots.size() - 1;
+      std::vector<Slot>::const_iterator it = slots_.begin(),
+          end = slots_.end();
       for (; it != end; ++it)
-        free(it->first);
-    }
-
-    void Set(const String2IdMap & from)
-    {
-      Clear();
-      max_element_id_ = from.max_element_id_;
-
-      Name2Id::const_iterator it = from.name2id_.begin(), end =
-          from.name2id_.end();
-      for (; it != end; ++it)
-        name2id_.insert(std::make_pair(NKIT_STRDUP(it->first), it->second));
+      {
+        if (it->id_ == EMPTY_SLOT)
+          continue;
+        size_t i = static_cast<size_t>(it->hash_) & mask;
+        while (slots[i].id_ != EMPTY_SLOT)
+          i = (i + 1) & mask;
+        slots[i] = *it;
+      }
+      slots_.swap(slots);
     }
 
   private:
-    Name2Id name2id_;
-    size_t max_element_id_;
+    std::vector<Slot> slots_;
+    std::vector<std::string> names_;
   };
 
   inline std::ostream & operator << (std::ostream & str, const String2IdMap & map)
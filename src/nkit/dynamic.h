@@ -22,6 +22,10 @@
 #include <nkit/constants.h>
 #include <nkit/dynamic/table_limits.h>
 #include <nkit/detail/ref_count_ptr.h>
+#include <nkit/detail/atomic.h>
+#include <nkit/dynamic/arena.h>
+#include <nkit/dynamic/key_pool.h>
+#include <nkit/dynamic/dict.h>
 
 #include <cassert>
 #include <cstring>
@@ -214,6 +218,11 @@ namespace nkit
   } // namespace detail
 
   //----------------------------------------------------------------------------
+  // Index is not synchronized. Lookups return Dynamic copies, which change
+  // reference counts, so several threads may read a table at a time only
+  // after Dynamic::Freeze() of it, with all indexes created before that.
+  // Table that is still being changed needs exclusive lock for readers as
+  // well, e.g. LockGuard<RWLock> (nkit/threading/rw_lock.h).
   class TableIndex
   {
   public:
@@ -389,7 +398,7 @@ namespace nkit
     struct NoneType { NoneType() {} };
     static NoneType NONE_MARKER;
     typedef DynamicVector::const_iterator ListConstIterator;
-    typedef StringDynamicMap::const_iterator DictConstIterator;
+    typedef detail::DictConstIterator DictConstIterator;
 
   public: // methods
     //--------------------------------------------------------------------------
@@ -500,6 +509,13 @@ namespace nkit
     Dynamic Clone() const;
     void Clear();
 
+    // Switches value and everything it holds to atomic reference counting,
+    // so that frozen value may be copied, read and released by several
+    // threads at a time. Frozen value must not be modified any more.
+    // Call it before value is published to other threads.
+    Dynamic & Freeze();
+    bool IsFrozen() const;
+
     int64_t type() const { return type_; }
     bool IsSameType(const Dynamic & v) const { return type_ == v.type_; }
     bool IsUndef() const { return type_ == detail::UNDEF; }
@@ -709,6 +725,11 @@ namespace nkit
     const Dynamic & operator[](const std::string & key) const;
     Dynamic & Get(const char * const key);
     Dynamic & Get(const std::string & key);
+    // Same as Get(), but new key is interned in process-wide key pool (see
+    // detail::KeyPool). Interned keys are never freed, so it is for keys
+    // which repeat in many dicts, as element names of parsed documents,
+    // not for keys taken from data (ids, timestamps).
+    Dynamic & GetInterned(const char * key, size_t size);
     const Dynamic & Get(const char * const key) const;
     const Dynamic & Get(const std::string & key) const;
     bool Get(const char * key, Dynamic ** const value);
@@ -786,6 +807,13 @@ namespace nkit
     size_t height() const; // 'size_t size()' equivalent
 
     Dynamic GetCellValue(const size_t row_num, const size_t col_num) const;
+
+    // Direct access to table storage for exporters: 'width()' cells of
+    // row 'row_num' without creating Dynamic for each of them. Cell types
+    // are in GetColumnTypeIds(). Pointer is valid until table is modified.
+    // Returns NULL if there is no such row.
+    const detail::Data * GetRowData(const size_t row_num) const;
+    detail::DynamicTypeVector GetColumnTypeIds() const;
     void JoinColumnCells(const size_t col, const std::string & delimiter,
         std::string * out) const;
     void SaveColumn(const size_t col, Dynamic * list) const;
@@ -0,0 +1,82 @@
+/*
+   Copyright 2010-2015 Boris T. Darchiev (boris.darchiev@gmail.com)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef __NKIT__DYNAMIC__ARENA__H__
+#define __NKIT__DYNAMIC__ARENA__H__
+
+#include <nkit/types.h>
+
+#include <cstddef>
+
+namespace nkit
+{
+  namespace detail
+  {
+    class ArenaBlocks;
+  } // namespace detail
+
+  //----------------------------------------------------------------------------
+  // Region allocator for Dynamic trees.
+  // While DynamicArena::Scope is alive, strings, lists, dicts and dict storage
+  // of Dynamic values created by the current thread are bump-allocated from
+  // the arena blocks. Destroying such node does not call free(): blocks are
+  // released all together when the arena and all of its nodes are gone,
+  // so values may safely outlive the DynamicArena object itself.
+  // Nodes of one arena may be released by several threads at a time once
+  // they are frozen (see Dynamic::Freeze()): block reference count is
+  // atomic. Allocation itself happens only in the thread of the Scope.
+  //----------------------------------------------------------------------------
+  class DynamicArena
+  {
+  public:
+    static const size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+    // Makes arena current for the calling thread, restores previous one
+    // on destruction. NULL arena leaves current one as is.
+    class Scope
+    {
+    public:
+      explicit Scope(DynamicArena * arena);
+      ~Scope();
+
+    private:
+      Scope(const Scope &);
+      Scope & operator = (const Scope &);
+
+    private:
+      detail::ArenaBlocks * prev_;
+    };
+
+    explicit DynamicArena(size_t block_size = DEFAULT_BLOCK_SIZE);
+    ~DynamicArena();
+
+    size_t block_count() const;
+    size_t allocated_bytes() const;
+
+    // Allocates from the current arena of the calling thread or from heap
+    static void * Allocate(size_t size);
+    static void Deallocate(void * ptr);
+
+  private:
+    DynamicArena(const DynamicArena &);
+    DynamicArena & operator = (const DynamicArena &);
+
+  private:
+    detail::ArenaBlocks * blocks_;
+  };
+} // namespace nkit
+
+#endif // __NKIT__DYNAMIC__ARENA__H__
@@ -0,0 +1,163 @@
+/*
+   Copyright 2010-2015 Boris T. Darchiev (boris.darchiev@gmail.com)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef __NKIT__DYNAMIC__DICT__H__
+#define __NKIT__DYNAMIC__DICT__H__
+
+#include <nkit/types.h>
+
+#include <iterator>
+
+namespace nkit
+{
+  class Dynamic;
+
+  namespace detail
+  {
+    struct DictEntry;
+    class DynamicDict;
+
+    //--------------------------------------------------------------------------
+    // std::pair-like view of DICT item
+    template <typename V>
+    struct DictItem
+    {
+      DictItem(const std::string & _first, V & _second)
+        : first(_first)
+        , second(_second)
+      {}
+
+      const std::string & first;
+      V & second;
+    };
+
+    //--------------------------------------------------------------------------
+    // DICT entries live in segments of 4, 4, 8, 16, 32 ... entries,
+    // so they never move when dict grows
+    inline size_t floor_log2(size_t v)
+    {
+#if defined(__GNUC__)
+      return sizeof(unsigned long long) * 8 - 1 -
+          static_cast<size_t>(
+              __builtin_clzll(static_cast<unsigned long long>(v)));
+#else
+      size_t result = 0;
+      while (v >>= 1)
+        ++result;
+      return result;
+#endif
+    }
+
+    template <typename Entry>
+    inline Entry & dict_entry(Entry * const * segments, size_t pos)
+    {
+      if (pos < 4)
+        return segments[0][pos];
+      size_t k = floor_log2(pos);
+      return segments[k - 1][pos - (size_t(1) << k)];
+    }
+
+    //--------------------------------------------------------------------------
+    // Iterates DICT items in key order. Dereferencing yields DictItem,
+    // so 'it->first' and 'it->second' work as with std::map iterators.
+    // Iterator is invalidated by any insertion to or removal from the dict,
+    // references to values are not.
+    //--------------------------------------------------------------------------
+    template <typename Entry, typename V>
+    class DictIterator
+    {
+      template <typename E2, typename V2> friend class DictIterator;
+
+    public:
+      typedef std::bidirectional_iterator_tag iterator_category;
+      typedef DictItem<V> value_type;
+      typedef DictItem<V> reference;
+      typedef ptrdiff_t difference_type;
+
+      class pointer
+      {
+      public:
+        explicit pointer(const DictItem<V> & item) : item_(item) {}
+        const DictItem<V> * operator->() const { return &item_; }
+
+      private:
+        DictItem<V> item_;
+      };
+
+      DictIterator() : segments_(NULL), order_(NULL), pos_(0) {}
+
+      DictIterator(Entry * const * segments, const uint32_t * order,
+          size_t pos)
+        : segments_(segments)
+        , order_(order)
+        , pos_(pos)
+      {}
+
+      // mutable -> const conversion
+      template <typename E2, typename V2>
+      DictIterator(const DictIterator<E2, V2> & from)
+        : segments_(from.segments_)
+        , order_(from.order_)
+        , pos_(from.pos_)
+      {}
+
+      reference operator*() const
+      {
+        Entry & entry = dict_entry(segments_, order_[pos_]);
+        return DictItem<V>(entry.key(), entry.value_);
+      }
+
+      pointer operator->() const { return pointer(**this); }
+
+      DictIterator & operator++() { ++pos_; return *this; }
+      DictIterator & operator--() { --pos_; return *this; }
+
+      DictIterator operator++(int)
+      {
+        DictIterator tmp(*this);
+        ++pos_;
+        return tmp;
+      }
+
+      DictIterator operator--(int)
+      {
+        DictIterator tmp(*this);
+        --pos_;
+        return tmp;
+      }
+
+      bool operator ==(const DictIterator & rv) const
+      {
+        return segments_ == rv.segments_ && pos_ == rv.pos_;
+      }
+
+      bool operator !=(const DictIterator & rv) const
+      {
+        return !operator ==(rv);
+      }
+
+    private:
+      Entry * const * segments_;
+      const uint32_t * order_;
+      size_t pos_;
+    };
+
+    typedef DictIterator<const DictEntry, const Dynamic> DictConstIterator;
+    typedef DictIterator<DictEntry, Dynamic> DictMutableIterator;
+  } // namespace detail
+} // namespace nkit
+
+#endif // __NKIT__DYNAMIC__DICT__H__
@@ -49,12 +49,28 @@ namespace nkit
       object_ = nkit::Dynamic();
     }
 
+    void Freeze()
+    {
+      object_.Freeze();
+    }
+
     void InitAsFloatFormat( std::string const & value, const char * format )
     {
       double d(0.0);
       if (!value.empty())
       {
-        if (NKIT_SSCANF(value.c_str(), format, &d) == 0)
+        bool done = false;
+        if (strcmp(format, NKIT_FORMAT_DOUBLE) == 0)
+        {
+          // fast path for plain decimal numbers, anything else
+          // (hex, inf, trailing garbage) goes to sscanf()
+          size_t pos = value.find_first_not_of(WHITE_SPACES);
+          size_t parsed = 0;
+          if (pos != value.npos)
+            done = chars_to_double(value.data() + pos, value.size() - pos,
+                &d, &parsed) && parsed == value.size() - pos;
+        }
+        if (!done && NKIT_SSCANF(value.c_str(), format, &d) == 0)
           d = 0.0;
       }
       object_ = nkit::Dynamic(d);
@@ -76,6 +92,39 @@ namespace nkit
       object_ = nkit::Dynamic::Dict();
     }
 
+    bool InitAsTable(const StringVector & table_def, std::string * error)
+    {
+      object_ = nkit::Dynamic::Table(table_def, error);
+      table_defaults_.clear();
+      if (!object_.IsTable())
+        return false;
+
+      StringVector column_types = object_.GetColumnTypes();
+      StringVector::const_iterator it = column_types.begin(),
+          end = column_types.end();
+      for (; it != end; ++it)
+        table_defaults_.push_back(nkit::Dynamic::GetDefault(
+            static_cast<int64_t>(detail::string_to_dynamic_type(*it)))
+            .Freeze());
+      return true;
+    }
+
+    void InitTableRow(DynamicVector * row) const
+    {
+      *row = table_defaults_;
+    }
+
+    // Cells of wrong type (e.g. unparsable date) are replaced by defaults
+    bool AppendToTable(DynamicVector & row)
+    {
+      for (size_t i = 0; i < row.size() && i < table_defaults_.size(); ++i)
+      {
+        if (!row[i].IsSameType(table_defaults_[i]))
+          row[i] = table_defaults_[i];
+      }
+      return object_.AppendRow(row);
+    }
+
     void ListCheck()
     {
       assert(object_.IsList());
@@ -109,9 +158,10 @@ namespace nkit
       }
     }
 
+    // keys are element and attribute names, so they are interned
     void SetDictKeyValue( std::string const & key, type const & var )
     {
-      object_[std::string(key)] = var;
+      object_.GetInterned(key.data(), key.size()) = var;
     }
 
     type const & get() const
@@ -127,6 +177,7 @@ namespace nkit
   private:
     type object_;
     const detail::Options & options_;
+    DynamicVector table_defaults_;
   };
 
   typedef VarBuilder<DynamicBuilderPolicy> DynamicBuilder;
@@ -158,12 +209,12 @@ namespace nkit
       return data.end_l();
     }
 
-    static std::string First(const DictConstIterator & it)
+    static const std::string & First(const DictConstIterator & it)
     {
       return it->first;
     }
 
-    static Dynamic Second(const DictConstIterator & it)
+    static const Dynamic & Second(const DictConstIterator & it)
     {
       return it->second;
     }
@@ -183,6 +234,36 @@ namespace nkit
       return data.IsDict();
     }
 
+    static bool IsTable(const Dynamic & data)
+    {
+      return data.IsTable();
+    }
+
+    static size_t GetHeight(const Dynamic & data)
+    {
+      return data.height();
+    }
+
+    static StringVector GetColumnNames(const Dynamic & data)
+    {
+      return data.GetColumnNames();
+    }
+
+    static detail::DynamicTypeVector GetColumnTypeIds(const Dynamic & data)
+    {
+      return data.GetColumnTypeIds();
+    }
+
+    static const detail::Data * GetRowData(const Dynamic & data, size_t row)
+    {
+      return data.GetRowData(row);
+    }
+
+    static Dynamic GetCellValue(const Dynamic & data, size_t row, size_t col)
+    {
+      return data.GetCellValue(row, col);
+    }
+
     static bool IsString(const Dynamic & data)
     {
       return data.IsString();
@@ -208,6 +289,11 @@ namespace nkit
       return data.GetString();
     }
 
+    static const std::string & GetConstString(const Dynamic & data)
+    {
+      return data.GetConstString();
+    }
+
     static std::string GetStringAsDateTime(const Dynamic & data,
             const std::string & format)
     {
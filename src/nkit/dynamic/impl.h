@@ -59,6 +59,7 @@ namespace nkit
       OP_GET_DEFAULT_DATA,
       OP_GET_MAX_DATA,
       OP_GET_MIN_DATA,
+      OP_FREEZE_DATA,
 
       /***********************************************************
        * !!! End marker. IT MUST BE LAST IN THIS ENUM !!!
@@ -363,6 +364,17 @@ namespace nkit
         return Impl<TypeCode>::OP_GET_MIN_DATA();
       }
     };
+
+    template <>
+    struct Operation<OP_FREEZE_DATA> :
+      UnaryOperation<OP_FREEZE_DATA, void (*)(Data &)>
+    {
+      template <uint64_t TypeCode>
+      static void Run(Data & v)
+      {
+        Impl<TypeCode>::OP_FREEZE_DATA(v);
+      }
+    };
     /***********************************************************
      * END operations
      **********************************************************/
@@ -493,6 +505,8 @@ namespace nkit
         result.i64_ = 0;
         return result;
       }
+
+      static void OP_FREEZE_DATA(Data & NKIT_UNUSED(v)) {}
     };
 
     //--------------------------------------------------------------------------
@@ -555,16 +569,49 @@ namespace nkit
     };
 
     //--------------------------------------------------------------------------
+    // Frozen objects (see Dynamic::Freeze()) are counted atomically,
+    // all others - with plain increments
     class RefCounted
     {
     public:
-      RefCounted() : refcount_(1) {}
+      RefCounted() : refcount_(1), frozen_(0) {}
       ~RefCounted() { assert(refcount_ == 0); } // non-virtual dtor
-      size_t IncRef() { assert(refcount_ > 0); ++refcount_; return refcount_; }
-      size_t DecRef() { assert(refcount_ > 0); --refcount_; return refcount_; }
+
+      // Frozen counter is checked by result of atomic operation only,
+      // plain read of it would race with other threads
+      size_t IncRef()
+      {
+        if (frozen_)
+        {
+          uint32_t count = atomic_add(&refcount_, 1u);
+          assert(count > 1);
+          return count;
+        }
+        assert(refcount_ > 0);
+        return ++refcount_;
+      }
+
+      size_t DecRef()
+      {
+        if (frozen_)
+        {
+          uint32_t count = atomic_sub(&refcount_, 1u);
+          assert(count != static_cast<uint32_t>(-1));
+          return count;
+        }
+        assert(refcount_ > 0);
+        return --refcount_;
+      }
+
       size_t ref_count() const { return refcount_; }
+
+      // Must be called before object becomes visible to other threads
+      void Freeze() { frozen_ = 1; }
+      bool frozen() const { return frozen_ != 0; }
+
     private:
-      size_t refcount_;
+      volatile uint32_t refcount_;
+      uint32_t frozen_;
     };
 
     //--------------------------------------------------------------------------
@@ -579,6 +626,18 @@ namespace nkit
       template<typename P1, typename P2>
       Shared(P1 p1, P2 p2) : value_(p1, p2) {}
       ~Shared() {} // non-virtual dtor
+
+      // see DynamicArena
+      static void * operator new(size_t size)
+      {
+        return DynamicArena::Allocate(size);
+      }
+
+      static void operator delete(void * ptr)
+      {
+        DynamicArena::Deallocate(ptr);
+      }
+
       const T * GetPtr() const { return &value_; }
       T * GetPtr() { return &value_; }
       const T & GetRef() const { return value_; }
@@ -23,6 +23,32 @@ namespace nkit
 {
   namespace detail
   {
+    // Days since 1970-01-01 of proleptic Gregorian date and back,
+    // without time zones and mktime()
+    inline int64_t days_from_civil(int64_t y, uint32_t m, uint32_t d)
+    {
+      y -= m <= 2;
+      int64_t era = (y >= 0 ? y : y - 399) / 400;
+      int64_t yoe = y - era * 400;                             // [0, 399]
+      int64_t doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+      int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;     // [0, 146096]
+      return era * 146097 + doe - 719468;
+    }
+
+    inline void civil_from_days(int64_t days, int64_t * y, uint32_t * m,
+        uint32_t * d)
+    {
+      days += 719468;
+      int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+      int64_t doe = days - era * 146097;
+      int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+      int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+      int64_t mp = (5 * doy + 2) / 153;
+      *d = static_cast<uint32_t>(doy - (153 * mp + 2) / 5 + 1);
+      *m = static_cast<uint32_t>(mp < 10 ? mp + 3 : mp - 9);
+      *y = yoe + era * 400 + (*m <= 2);
+    }
+
     template <>
     class Impl<detail::DATE_TIME> : public ImplDefault
     {
@@ -158,6 +184,19 @@ namespace nkit
       }
 
       static std::string OP_GET_STRING(const Data & v, const char * format)
+      {
+        const int BUFFER_SIZE(1024);
+        char buffer [BUFFER_SIZE];
+        size_t written = Format(v, format, buffer, BUFFER_SIZE);
+        if (written == 0)
+          return S_EMPTY_;
+        return std::string(buffer, written);
+      }
+
+      // Writes formatted date time into 'buffer', returns written size
+      // or 0 if 'size' is not enough
+      static size_t Format(const Data & v, const char * format,
+          char * buffer, size_t size)
       {
         struct tm timeinfo;
         memset(&timeinfo, 0, sizeof(timeinfo));
@@ -169,18 +208,24 @@ namespace nkit
         timeinfo.tm_min = minutes(v);
         timeinfo.tm_sec = seconds(v);
         timeinfo.tm_isdst = -1;
-        std::mktime(&timeinfo);
 
         if (*format == '\0')
           format = DATE_TIME_DEFAULT_FORMAT();
 
-        const int BUFFER_SIZE(1024);
-        char buffer [BUFFER_SIZE];
+        // only time zone needs mktime(), week day and year day are counted
+        if (strstr(format, "%Z") || strstr(format, "%z") ||
+            strstr(format, "%s"))
+          std::mktime(&timeinfo);
+        else
+        {
+          int64_t days = days_from_civil(year(v), month(v), day(v));
+          // 1970-01-01 is Thursday
+          timeinfo.tm_wday = static_cast<int>(((days % 7) + 11) % 7);
+          timeinfo.tm_yday = static_cast<int>(
+              days - days_from_civil(year(v), 1, 1));
+        }
 
-        size_t written = std::strftime(buffer, BUFFER_SIZE, format, &timeinfo);
-        if (written == 0)
-          return S_EMPTY_;
-        return std::string(buffer, written);
+        return std::strftime(buffer, size, format, &timeinfo);
       }
 
       static std::string OP_GET_STRING(const Dynamic & v, const char * format)
@@ -224,6 +269,7 @@ namespace nkit
             (v.ui64_ & MICROSEC_MASK) >> MICROSEC_SHIFT);
       }
 
+      // Local time, so DST rules of mktime() are needed here
       static int64_t GetTimestump(const Data & v)
       {
         struct tm timeinfo;
@@ -240,36 +286,25 @@ namespace nkit
 
       static void AddDays(Data & v, const int32_t days_count)
       {
-        struct tm timeinfo;
-        memset(&timeinfo, 0, sizeof(timeinfo));
-        timeinfo.tm_year = year(v) - 1900;
-        timeinfo.tm_mon = month(v) - 1;
-        timeinfo.tm_mday = day(v) + days_count;
-        timeinfo.tm_hour = hours(v);
-        timeinfo.tm_min = minutes(v);
-        timeinfo.tm_sec = seconds(v);
-        timeinfo.tm_isdst = -1;
-        std::mktime(&timeinfo);
-        uint64_t d(0);
-        Set(timeinfo, &d);
-        Reset(&v, d);
+        int64_t days = days_from_civil(year(v), month(v), day(v))
+            + days_count;
+        SetDaysAndSeconds(v, days,
+            hours(v) * 3600 + minutes(v) * 60 + seconds(v));
       }
 
       static void AddSeconds(Data & v, const int32_t ss)
       {
-        struct tm timeinfo;
-        memset(&timeinfo, 0, sizeof(timeinfo));
-        timeinfo.tm_year = year(v) - 1900;
-        timeinfo.tm_mon = month(v) - 1;
-        timeinfo.tm_mday = day(v);
-        timeinfo.tm_hour = hours(v);
-        timeinfo.tm_min = minutes(v);
-        timeinfo.tm_sec = seconds(v) + ss;
-        timeinfo.tm_isdst = -1;
-        std::mktime(&timeinfo);
-        uint64_t d(0);
-        Set(timeinfo, &d);
-        Reset(&v, d);
+        int64_t seconds_of_day = int64_t(hours(v)) * 3600
+            + minutes(v) * 60 + seconds(v) + ss;
+        int64_t days = days_from_civil(year(v), month(v), day(v))
+            + seconds_of_day / 86400;
+        seconds_of_day %= 86400;
+        if (seconds_of_day < 0)
+        {
+          seconds_of_day += 86400;
+          --days;
+        }
+        SetDaysAndSeconds(v, days, seconds_of_day);
       }
 
       static bool SetHour(Data & v, uint64_t h)
@@ -351,6 +386,21 @@ namespace nkit
       }
 
     private:
+      // Wall clock arithmetic, microseconds are dropped as by mktime()
+      // based version. Out of range result is 0.
+      static void SetDaysAndSeconds(Data & v, int64_t days,
+          int64_t seconds_of_day)
+      {
+        int64_t y;
+        uint32_t m, d;
+        civil_from_days(days, &y, &m, &d);
+        uint64_t result(0);
+        if (y >= 0)
+          Set(static_cast<uint64_t>(y), m, d, seconds_of_day / 3600,
+              seconds_of_day / 60 % 60, seconds_of_day % 60, 0, &result);
+        Reset(&v, result);
+      }
+
       static bool Set(const struct tm & timeinfo, uint64_t * const out)
       {
         return Set(timeinfo.tm_year + 1900, timeinfo.tm_mon + 1,
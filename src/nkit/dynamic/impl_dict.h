@@ -19,7 +19,200 @@ namespace nkit
   namespace detail
   {
     //--------------------------------------------------------------------------
-    class SharedMap : public Shared<StringDynamicMap>
+    struct DictEntry
+    {
+      static const uintptr_t OWNED_KEY = 1;
+
+      const std::string & key() const
+      {
+        return *reinterpret_cast<const std::string *>(key_ & ~OWNED_KEY);
+      }
+
+      uintptr_t key_; // interned key or owned one with OWNED_KEY bit set
+      uint64_t hash_;
+      Dynamic value_;
+    };
+
+    //--------------------------------------------------------------------------
+    // DICT storage.
+    // Entries are appended to segments of growing size and never move, so
+    // references to values stay valid while dict grows (as with std::map).
+    // Up to FLAT_MAX_SIZE entries are looked up by linear scan over cached
+    // key hashes, bigger dicts get open addressing hash index.
+    // Iteration goes in key order through permutation of entry positions:
+    // small dicts keep it sorted on insert, big ones drop it on insert and
+    // sort it again on first iteration. Such sort may happen in const
+    // method, so sorted permutation is built aside and published by atomic
+    // compare-and-swap: const dict may be iterated by several threads.
+    // Erased entries leave holes which are compacted away when they
+    // outnumber live ones; only compaction moves entries.
+    //--------------------------------------------------------------------------
+    class DynamicDict
+    {
+    public:
+      static const size_t FLAT_MAX_SIZE = 16;
+      static const size_t NPOS = size_t(-1);
+
+      DynamicDict()
+        : segments_(NULL)
+        , segment_count_(0)
+        , segments_capacity_(0)
+        , count_(0)
+        , size_(0)
+        , index_(NULL)
+        , index_mask_(0)
+        , order_(NULL)
+      {}
+
+      ~DynamicDict() { clear(); }
+
+      size_t size() const { return size_; }
+      bool empty() const { return size_ == 0; }
+      void clear();
+
+      Dynamic * Find(const char * key, size_t size) const
+      {
+        size_t pos = FindEntry(key, size, hash_bytes(key, size));
+        return pos == NPOS ? NULL : &Entry(pos).value_;
+      }
+
+      Dynamic * Find(const std::string & key) const
+      {
+        return Find(key.data(), key.size());
+      }
+
+      // Returns existing value or inserts new undefined one
+      Dynamic & Get(const char * key, size_t size)
+      {
+        uint64_t hash = hash_bytes(key, size);
+        size_t pos = FindEntry(key, size, hash);
+        if (pos != NPOS)
+          return Entry(pos).value_;
+        return Insert(key, size, hash, NULL);
+      }
+
+      Dynamic & Get(const std::string & key)
+      {
+        return Get(key.data(), key.size());
+      }
+
+      // Get() which stores new key from KeyPool if it can be interned
+      Dynamic & GetInterned(const char * key, size_t size)
+      {
+        uint64_t hash = hash_bytes(key, size);
+        size_t pos = FindEntry(key, size, hash);
+        if (pos != NPOS)
+          return Entry(pos).value_;
+        return Insert(key, size, hash, KeyPool::Intern(key, size, hash));
+      }
+
+      bool Erase(const std::string & key);
+
+      DictConstIterator begin() const
+      {
+        return DictConstIterator(segments_, GetOrder(), 0);
+      }
+
+      DictConstIterator end() const
+      {
+        return DictConstIterator(segments_, GetOrder(), size_);
+      }
+
+      DictMutableIterator begin()
+      {
+        return DictMutableIterator(segments_, GetOrder(), 0);
+      }
+
+      DictMutableIterator end()
+      {
+        return DictMutableIterator(segments_, GetOrder(), size_);
+      }
+
+      DictConstIterator find(const std::string & key) const;
+
+      // Sorts keys of big dict now rather than on first iteration
+      void PrepareOrder() const { GetOrder(); }
+
+    private:
+      DynamicDict(const DynamicDict &);
+      DynamicDict & operator =(const DynamicDict &);
+
+      static bool KeyEqual(const DictEntry & entry, uint64_t hash,
+          const char * key, size_t size)
+      {
+        if (entry.hash_ != hash || !entry.key_)
+          return false;
+        const std::string & entry_key = entry.key();
+        return entry_key.size() == size
+            && std::memcmp(entry_key.data(), key, size) == 0;
+      }
+
+      DictEntry & Entry(size_t pos) const
+      {
+        return dict_entry(segments_, pos);
+      }
+
+      size_t capacity() const
+      {
+        return segment_count_ ? size_t(2) << segment_count_ : 0;
+      }
+
+      size_t FindEntry(const char * key, size_t size, uint64_t hash) const
+      {
+        if (!index_)
+        {
+          for (size_t pos = 0; pos < count_; ++pos)
+            if (KeyEqual(Entry(pos), hash, key, size))
+              return pos;
+          return NPOS;
+        }
+
+        size_t slot = static_cast<size_t>(hash) & index_mask_;
+        while (index_[slot])
+        {
+          size_t pos = index_[slot] - 1;
+          if (KeyEqual(Entry(pos), hash, key, size))
+            return pos;
+          slot = (slot + 1) & index_mask_;
+        }
+        return NPOS;
+      }
+
+      const uint32_t * GetOrder() const
+      {
+        const uint32_t * order = atomic_load(&order_);
+        return order || !size_ ? order : BuildOrder();
+      }
+
+      Dynamic & Insert(const char * key, size_t size, uint64_t hash,
+          const std::string * interned);
+      void AddSegment();
+      void BuildIndex(size_t capacity);
+      void RemoveFromIndex(size_t pos);
+      const uint32_t * BuildOrder() const;
+      void SortOrder(uint32_t * order) const;
+      void InsertToOrder(size_t pos);
+      void RemoveFromOrder(size_t pos);
+      void Compact();
+      static size_t IndexCapacity(size_t size);
+      static void DestroyEntry(DictEntry & entry);
+
+    private:
+      DictEntry ** segments_;
+      size_t segment_count_;
+      size_t segments_capacity_;
+      size_t count_; // used entry positions, including erased ones
+      size_t size_;
+      uint32_t * index_; // entry position + 1, or 0 for empty slot
+      size_t index_mask_;
+      // Positions of live entries in key order. Small dict has it for
+      // capacity() entries, big one - for size_ entries or NULL if it is
+      // not sorted yet.
+      mutable uint32_t * volatile order_;
+    };
+
+    //--------------------------------------------------------------------------
+    class SharedMap : public Shared<DynamicDict>
     {
     public:
       static SharedMap * Get(const Data & data)
@@ -46,10 +239,11 @@ namespace nkit
       static Dynamic OP_CLONE(const Data & v)
       {
         Dynamic result(Dynamic::Dict());
-        const StringDynamicMap & map = GetMap(v);
-        StringDynamicMap::const_iterator it = map.begin(), end = map.end();
+        DynamicDict & to = GetMap(result.data_);
+        const DynamicDict & map = GetMap(v);
+        DictConstIterator it = map.begin(), end = map.end();
         for (; it != end; ++it)
-          result[it->first] = it->second.Clone();
+          to.Get(it->first) = it->second.Clone();
         return result;
       }
 
@@ -78,6 +272,20 @@ namespace nkit
         }
       }
 
+      static void OP_FREEZE_DATA(Data & data)
+      {
+        detail::SharedMap * shared = GetSharedPtr(data);
+        if (shared->frozen())
+          return;
+        shared->Freeze();
+        DynamicDict & map = shared->GetRef();
+        // frozen dict is iterated without allocations
+        map.PrepareOrder();
+        DictMutableIterator it = map.begin(), end = map.end();
+        for (; it != end; ++it)
+          it->second.Freeze();
+      }
+
       static bool OP_GET_BOOL(const Data & v)
       {
         return !OP_IS_EMPTY(v);
@@ -110,42 +318,61 @@ namespace nkit
       {
         if (!rv.IsDict())
           return false;
-        const StringDynamicMap & l = GetMap(lv.data_);
-        const StringDynamicMap & r = GetMap(rv.data_);
-        return (l.size() == r.size())
-            && std::equal(l.begin(), l.end(), r.begin());
+        const DynamicDict & l = GetMap(lv.data_);
+        const DynamicDict & r = GetMap(rv.data_);
+        if (l.size() != r.size())
+          return false;
+        DictConstIterator l_it = l.begin(), l_end = l.end(),
+            r_it = r.begin();
+        for (; l_it != l_end; ++l_it, ++r_it)
+        {
+          if (l_it->first != r_it->first || l_it->second != r_it->second)
+            return false;
+        }
+        return true;
       }
 
       static Dynamic & Set(Dynamic & v, const std::string & key,
           const Dynamic & item)
       {
-        detail::SharedMap * shared = GetSharedPtr(v.data_);
-
-        StringDynamicMap & map = shared->GetRef();
-        Dynamic & value = map[key];
+        Dynamic & value = GetMap(v.data_).Get(key);
         value = item;
         return value;
       }
 
       static Dynamic & Get(Dynamic & v, const std::string & key)
       {
-        StringDynamicMap & map = GetMap(v.data_);
-        return map[key];
+        return GetMap(v.data_).Get(key);
+      }
+
+      static Dynamic & Get(Dynamic & v, const char * key)
+      {
+        return GetMap(v.data_).Get(key, strlen(key));
+      }
+
+      static Dynamic & GetInterned(Dynamic & v, const char * key,
+          size_t size)
+      {
+        return GetMap(v.data_).GetInterned(key, size);
       }
 
       static const Dynamic & Get(const Dynamic & v, const std::string & key)
       {
-        Dynamic * result;
-        if (!Get(const_cast<Dynamic & >(v), key, &result))
-          return D_NONE;
-        return *result;
+        const Dynamic * result = GetMap(v.data_).Find(key);
+        return result ? *result : D_NONE;
+      }
+
+      static const Dynamic & Get(const Dynamic & v, const char * key)
+      {
+        const Dynamic * result = GetMap(v.data_).Find(key, strlen(key));
+        return result ? *result : D_NONE;
       }
 
       static bool Get(const Dynamic & v, const std::string & key,
           const Dynamic ** const value)
       {
-        Dynamic * result;
-        if (!Get(const_cast<Dynamic & >(v), key, &result))
+        const Dynamic * result = GetMap(v.data_).Find(key);
+        if (!result)
           return false;
         *value = result;
         return true;
@@ -154,35 +381,34 @@ namespace nkit
       static bool Get(Dynamic & v, const std::string & key,
           Dynamic ** const value)
       {
-        StringDynamicMap & map = GetMap(v.data_);
-        StringDynamicMap::iterator it = map.find(key);
-        if (it == map.end())
+        Dynamic * result = GetMap(v.data_).Find(key);
+        if (!result)
           return false;
-        *value = &(it->second);
+        *value = result;
         return true;
       }
 
-      static StringDynamicMap::const_iterator Begin(const Dynamic & v)
+      static DictConstIterator Begin(const Dynamic & v)
       {
         return GetMap(v.data_).begin();
       }
 
-      static StringDynamicMap::const_iterator End(const Dynamic & v)
+      static DictConstIterator End(const Dynamic & v)
       {
         return GetMap(v.data_).end();
       }
 
-      static StringDynamicMap::iterator Begin(Dynamic & v)
+      static DictMutableIterator Begin(Dynamic & v)
       {
         return GetMap(v.data_).begin();
       }
 
-      static StringDynamicMap::iterator End(Dynamic & v)
+      static DictMutableIterator End(Dynamic & v)
       {
         return GetMap(v.data_).end();
       }
 
-      static StringDynamicMap::const_iterator Find(const Dynamic & v,
+      static DictConstIterator Find(const Dynamic & v,
           const std::string & key)
       {
         return GetMap(v.data_).find(key);
@@ -191,32 +417,29 @@ namespace nkit
       static void GetKeys(const Dynamic & v, StringSet * keys)
       {
         keys->clear();
-        const StringDynamicMap & map = GetMap(v.data_);
-        StringDynamicMap::const_iterator it = map.begin(), end = map.end();
+        const DynamicDict & map = GetMap(v.data_);
+        DictConstIterator it = map.begin(), end = map.end();
         for (; it != end; ++it)
-          keys->insert(it->first);
+          keys->insert(keys->end(), it->first);
       }
 
       static void DeleteByKey(Dynamic & v, const std::string & key)
       {
-        StringDynamicMap & map = GetMap(v.data_);
-        StringDynamicMap::iterator it = map.find(key);
-        if (it != map.end())
-          map.erase(it);
+        GetMap(v.data_).Erase(key);
       }
 
       static void Update(Dynamic & v, const Dynamic & rv)
       {
         if (rv.IsDict())
         {
-          StringDynamicMap & to = GetMap(v.data_);
-          const StringDynamicMap & from = GetMap(rv.data_);
-          StringDynamicMap::const_iterator i = from.begin();
-          StringDynamicMap::const_iterator end = from.end();
+          DynamicDict & to = GetMap(v.data_);
+          const DynamicDict & from = GetMap(rv.data_);
+          DictConstIterator i = from.begin();
+          DictConstIterator end = from.end();
           for (; i != end; ++i)
           {
             const Dynamic & _from = i->second;
-            Dynamic & _to = to[i->first];
+            Dynamic & _to = to.Get(i->first);
             if (_to.IsDict() && _from.IsDict())
               Update(_to, _from);
             else
@@ -226,12 +449,12 @@ namespace nkit
       }
 
     private:
-      static const StringDynamicMap & GetMap(const Data & v)
+      static const DynamicDict & GetMap(const Data & v)
       {
         return GetSharedPtr(v)->GetRef();
       }
 
-      static StringDynamicMap & GetMap(Data & v)
+      static DynamicDict & GetMap(Data & v)
       {
         return GetSharedPtr(v)->GetRef();
       }
@@ -257,8 +480,8 @@ namespace nkit
     class ConstMapAdapter
     {
     public:
-      typedef StringDynamicMap::const_iterator iterator;
-      typedef StringDynamicMap::const_iterator const_iterator;
+      typedef DictConstIterator iterator;
+      typedef DictConstIterator const_iterator;
 
       ConstMapAdapter(const Dynamic & dict)
         : hash_(dict)
@@ -269,7 +492,7 @@ namespace nkit
         if (hash_.IsDict())
           return detail::Impl<detail::DICT>::Begin(hash_);
         else
-          return empty_map_.end();
+          return const_iterator();
       }
 
       const_iterator end() const
@@ -277,20 +500,19 @@ namespace nkit
         if (hash_.IsDict())
           return detail::Impl<detail::DICT>::End(hash_);
         else
-          return empty_map_.end();
+          return const_iterator();
       }
 
     private:
       const Dynamic & hash_;
-      static const StringDynamicMap empty_map_;
     };
 
     //--------------------------------------------------------------------------
     class MapAdapter
     {
     public:
-      typedef StringDynamicMap::iterator iterator;
-      typedef StringDynamicMap::const_iterator const_iterator;
+      typedef DictMutableIterator iterator;
+      typedef DictConstIterator const_iterator;
 
       MapAdapter(Dynamic & dict)
         : hash_(dict)
@@ -301,7 +523,7 @@ namespace nkit
         if (hash_.IsDict())
           return detail::Impl<detail::DICT>::Begin(hash_);
         else
-          return empty_map_.end();
+          return iterator();
       }
 
       iterator end() const
@@ -309,12 +531,11 @@ namespace nkit
         if (hash_.IsDict())
           return detail::Impl<detail::DICT>::End(hash_);
         else
-          return empty_map_.end();
+          return iterator();
       }
 
     private:
       Dynamic & hash_;
-      static StringDynamicMap empty_map_;
     };
 
     //--------------------------------------------------------------------------
@@ -71,12 +71,12 @@ namespace nkit
         if (*format != '\0')
         {
           NKIT_SNPRINTF(buf, 128, format, v.f_);
+          return buf;
         }
-        else
-        {
-          NKIT_SNPRINTF(buf, 128, "%f", v.f_);
-        }
-        return buf;
+
+        // shortest round-trip representation
+        size_t len = double_to_chars(v.f_, buf);
+        return std::string(buf, len);
       }
 
       static std::string OP_GET_STRING(const Dynamic & v,
@@ -80,6 +80,18 @@ namespace nkit
         }
       }
 
+      static void OP_FREEZE_DATA(Data & data)
+      {
+        detail::SharedVector * shared = GetSharedPtr(data);
+        if (shared->frozen())
+          return;
+        shared->Freeze();
+        DynamicVector & vector = shared->GetRef();
+        DynamicVector::iterator it = vector.begin(), end = vector.end();
+        for (; it != end; ++it)
+          it->Freeze();
+      }
+
       static DynamicVector::const_iterator Begin(const Dynamic & v)
       {
         return GetVector(v.data_).begin();
@@ -84,6 +84,11 @@ namespace nkit
         }
       }
 
+      static void OP_FREEZE_DATA(Data & data)
+      {
+        GetSharedPtr(data)->Freeze();
+      }
+
       static bool OP_GET_BOOL(const Data & v)
       {
         return !OP_IS_EMPTY(v);
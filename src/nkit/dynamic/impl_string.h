@@ -157,6 +157,11 @@ namespace nkit
         }
       }
 
+      static void OP_FREEZE_DATA(Data & data)
+      {
+        GetSharedPtr(data)->Freeze();
+      }
+
       static int64_t OP_GET_INT(const Data & v)
       {
         return NKIT_STRTOLL(OP_GET_CONST_STRING(v).c_str(), NULL, 10);
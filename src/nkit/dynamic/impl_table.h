@@ -286,9 +286,13 @@ namespace nkit
       ~SharedTable();
       void Clear();
 
+      // Freezes table and all its ref counted cells, see Dynamic::Freeze()
+      void FreezeAll();
+
       // properties
       StringVector column_names() const;
       StringVector column_types() const;
+      DynamicTypeVector column_type_ids() const;
       void SetColumnName(size_t pos, const std::string & name);
       size_t column_number(const std::string & column_name) const;
 
@@ -299,6 +303,11 @@ namespace nkit
       // Table management
       Dynamic GetCellValue(const size_t row_num,
         const size_t col_num) const;
+
+      const Data * row_data(const size_t row_num) const
+      {
+        return row_num < rows_ ? storage_->get(row_num) : NULL;
+      }
       bool AppendRow(const DynamicVector & args);
       bool SetCellValue(const size_t row_num,
         const size_t col_num, const Dynamic & v);
@@ -408,6 +417,11 @@ namespace nkit
         }
       }
 
+      static void OP_FREEZE_DATA(Data & data)
+      {
+        GetSharedPtr(data)->FreezeAll();
+      }
+
       static Dynamic OP_CLONE(const Data & v)
       {
         const SharedTable * table = GetSharedPtr(v);
@@ -499,6 +513,17 @@ namespace nkit
         return GetSharedPtr(table.data_)->GetCellValue(row_num, col_num);
       }
 
+      static const Data * GetRowData(const Dynamic & table,
+          const size_t row_num)
+      {
+        return GetSharedPtr(table.data_)->row_data(row_num);
+      }
+
+      static DynamicTypeVector GetColumnTypeIds(const Dynamic & v)
+      {
+        return GetSharedPtr(v.data_)->column_type_ids();
+      }
+
       static Dynamic::TableIterator begin_t(const Dynamic & table)
       {
         return Dynamic::TableIterator(GetSharedPtr(table.data_), 0);
@@ -0,0 +1,93 @@
+/*
+   Copyright 2010-2015 Boris T. Darchiev (boris.darchiev@gmail.com)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef __NKIT__DYNAMIC__KEY__POOL__H__
+#define __NKIT__DYNAMIC__KEY__POOL__H__
+
+#include <nkit/types.h>
+
+#include <cstring>
+
+namespace nkit
+{
+  namespace detail
+  {
+    //--------------------------------------------------------------------------
+    inline uint64_t hash_bytes(const char * data, size_t size)
+    {
+      static const uint64_t M = 0x9e3779b97f4a7c15ULL;
+      uint64_t h = size * M;
+      while (size >= 8)
+      {
+        uint64_t w;
+        std::memcpy(&w, data, 8);
+        h = (h ^ w) * M;
+        h ^= h >> 29;
+        data += 8;
+        size -= 8;
+      }
+
+      if (size)
+      {
+        uint64_t w = 0;
+        std::memcpy(&w, data, size);
+        h = (h ^ w) * M;
+      }
+
+      h ^= h >> 32;
+      h *= M;
+      h ^= h >> 29;
+      return h;
+    }
+
+    //--------------------------------------------------------------------------
+    // Process-wide table of interned dict keys.
+    // Documents of the same kind repeat the same keys over and over, so
+    // parsers look keys up here instead of building a new std::string for
+    // each of them (see Dynamic::GetInterned(), other dict inserts own
+    // their keys). Interned strings are immutable and never freed, so only
+    // keys up to MAX_KEY_SIZE bytes and up to MAX_KEY_COUNT of them are
+    // interned. Lookups first go to small per-thread cache and take the
+    // pool mutex only on cache miss; once pool is full it is not changed
+    // any more and is read without mutex.
+    //--------------------------------------------------------------------------
+    class KeyPool
+    {
+    public:
+      static const size_t MAX_KEY_SIZE = 64;
+      static const size_t MAX_KEY_COUNT = 64 * 1024;
+
+      // Returns interned copy of the key or NULL if it can not be interned
+      static const std::string * Intern(const char * key, size_t size)
+      {
+        return Intern(key, size, hash_bytes(key, size));
+      }
+
+      // The same with precomputed hash_bytes(key, size)
+      static const std::string * Intern(const char * key, size_t size,
+          uint64_t hash);
+
+      static const std::string * Intern(const std::string & key)
+      {
+        return Intern(key.data(), key.size());
+      }
+
+      static size_t size();
+    };
+  } // namespace detail
+} // namespace nkit
+
+#endif // __NKIT__DYNAMIC__KEY__POOL__H__
@@ -79,8 +79,15 @@ namespace nkit
     inline void write_number(const Dynamic & v, T * t,
         const DynamicToJsonOptions & NKIT_UNUSED(options))
     {
-      const std::string tmp(v.GetString());
-      JsonWriter<T>::write_json(tmp.c_str(), tmp.size(), t);
+      char tmp[NUMBER_TO_CHARS_BUFFER_SIZE];
+      size_t len;
+      if (v.IsFloat())
+        len = double_to_chars(v.GetFloat(), tmp);
+      else if (v.IsSignedInteger())
+        len = int64_to_chars(v.GetSignedInteger(), tmp);
+      else
+        len = uint64_to_chars(v.GetUnsignedInteger(), tmp);
+      JsonWriter<T>::write_json(tmp, len, t);
     }
 
     template<typename T>
@@ -94,11 +101,9 @@ namespace nkit
     }
 
     template<typename T>
-    void write_string_or_mongodb_oid(const Dynamic & v, T * t,
-        const DynamicToJsonOptions & NKIT_UNUSED(options))
+    void write_json_string(const std::string & str, T * t)
     {
-      std::string::const_iterator it = v.GetConstString().begin(), end =
-          v.GetConstString().end(), next;
+      std::string::const_iterator it = str.begin(), end = str.end(), next;
       __NKIT__WRITE__JSON__("\"", t);
       while (it != end)
       {
@@ -166,6 +171,13 @@ namespace nkit
       __NKIT__WRITE__JSON__("\"", t);
     }
 
+    template<typename T>
+    inline void write_string_or_mongodb_oid(const Dynamic & v, T * t,
+        const DynamicToJsonOptions & NKIT_UNUSED(options))
+    {
+      write_json_string(v.GetConstString(), t);
+    }
+
     template<typename T>
     bool write_dict_item(const std::string & key, const Dynamic & v, T * t,
         const DynamicToJsonOptions & options)
@@ -176,54 +188,100 @@ namespace nkit
       return DynamicToJson(v, t, options);
     }
 
+    // Scalar cells are written straight from table storage, other ones
+    // through Dynamic
     template<typename T>
-    bool write_table_row(const Dynamic & v, const size_t width,
-        const StringVector & column_names, const size_t row, T * t,
+    inline bool write_table_cell(const Dynamic & table, const size_t row,
+        const size_t col, const uint64_t type, const Data & cell, T * t,
         const DynamicToJsonOptions & options)
     {
-      __NKIT__WRITE__JSON__("{", t);
-      size_t last_col = width - 1;
-      for (size_t col = 0; col < last_col; ++col)
+      char tmp[NUMBER_TO_CHARS_BUFFER_SIZE];
+      switch (type)
       {
-        if (unlikely(
-            !write_dict_item(column_names[col], v.GetCellValue(row, col), t,
-                options)))
-          return false;
-        __NKIT__WRITE__JSON__(",", t);
+      case BOOL:
+        if (cell.i64_ == 0)
+        {
+          __NKIT__WRITE__JSON__("false", t);
+        }
+        else
+        {
+          __NKIT__WRITE__JSON__("true", t);
+        }
+        return true;
+      case INTEGER:
+        JsonWriter<T>::write_json(tmp, int64_to_chars(cell.i64_, tmp), t);
+        return true;
+      case UNSIGNED_INTEGER:
+        JsonWriter<T>::write_json(tmp, uint64_to_chars(cell.ui64_, tmp), t);
+        return true;
+      case FLOAT:
+        JsonWriter<T>::write_json(tmp, double_to_chars(cell.f_, tmp), t);
+        return true;
+      case STRING:
+        write_json_string(SharedString::Get(cell)->GetRef(), t);
+        return true;
+      case DATE_TIME:
+      {
+        const size_t BUFFER_SIZE = 1024;
+        char buffer[BUFFER_SIZE];
+        size_t size = Impl<DATE_TIME>::Format(cell,
+            options.date_time_format.c_str(), buffer, BUFFER_SIZE);
+        __NKIT__WRITE__JSON__("\"", t);
+        JsonWriter<T>::write_json(buffer, size, t);
+        __NKIT__WRITE__JSON__("\"", t);
+        return true;
+      }
+      default:
+        return DynamicToJson(table.GetCellValue(row, col), t, options);
       }
-
-      if (unlikely(
-          !write_dict_item(column_names[last_col], v.GetCellValue(row, last_col),
-              t, options)))
-        return false;
-
-      __NKIT__WRITE__JSON__("}", t);
-      return true;
     }
 
+    // Row is '{' + key fragment + cell + ',' + key fragment + cell ... + '}',
+    // fragments are escaped column names with quotes and colon, prepared
+    // once per table
     template<typename T>
     bool write_table(const Dynamic & v, T * t,
         const DynamicToJsonOptions & options)
     {
       __NKIT__WRITE__JSON__("[", t);
       size_t height = v.height();
-      if (likely(height > 0))
+      size_t width = v.width();
+      if (likely(height > 0 && width > 0))
       {
-        size_t last_row = height - 1;
         StringVector column_names = v.GetColumnNames();
-        size_t width = v.width();
-
-        for (size_t row = 0; row < last_row; ++row)
+        DynamicTypeVector types = v.GetColumnTypeIds();
+        StringVector fragments(width);
+        for (size_t col = 0; col < width; ++col)
         {
-          if (unlikely(!write_table_row(v, width, column_names, row, t,
-              options)))
-            return false;
-          __NKIT__WRITE__JSON__(",", t);
+          fragments[col] = col == 0 ? "{" : ",";
+          write_json_string(column_names[col], &fragments[col]);
+          fragments[col] += ':';
         }
 
-        if (unlikely(!write_table_row(v, width, column_names, last_row, t,
-            options)))
-          return false;
+        for (size_t row = 0; row < height; ++row)
+        {
+          if (row != 0)
+            __NKIT__WRITE__JSON__(",", t);
+          const Data * cells = v.GetRowData(row);
+          for (size_t col = 0; col < width; ++col)
+          {
+            JsonWriter<T>::write_json(fragments[col].data(),
+                fragments[col].size(), t);
+            if (unlikely(!write_table_cell(v, row, col, types[col],
+                cells[col], t, options)))
+              return false;
+          }
+          __NKIT__WRITE__JSON__("}", t);
+        }
+      }
+      else if (height > 0)
+      {
+        for (size_t row = 0; row < height; ++row)
+        {
+          if (row != 0)
+            __NKIT__WRITE__JSON__(",", t);
+          __NKIT__WRITE__JSON__("{}", t);
+        }
       }
 
       __NKIT__WRITE__JSON__("]", t);
@@ -419,9 +477,11 @@ namespace nkit
     return os;
   }
 
-  Dynamic DynamicFromJson(const std::string & json, std::string * const error);
+  // If 'arena' is set, the resulting tree is allocated from it
+  Dynamic DynamicFromJson(const std::string & json, std::string * const error,
+      DynamicArena * arena = NULL);
   Dynamic DynamicFromJsonFile(const std::string & path,
-      std::string * const error);
+      std::string * const error, DynamicArena * arena = NULL);
 
 } // namespace nkit
 
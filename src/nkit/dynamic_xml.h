@@ -18,45 +18,163 @@
 #define NKIT_DYNAMIC_XML_H
 
 #include "nkit/dynamic.h"
+#include "nkit/expat_parser.h"
 
 namespace nkit
 {
+  // If 'arena' is set, the resulting tree is allocated from it
   Dynamic DynamicFromAnyXml(const std::string & xml,
         const std::string & options,
         std::string * const root_name,
-        std::string * const error);
+        std::string * const error,
+        DynamicArena * arena = NULL);
   Dynamic DynamicFromAnyXml(const std::string & xml,
         const Dynamic & options,
         std::string * const root_name,
-        std::string * const error);
+        std::string * const error,
+        DynamicArena * arena = NULL);
   Dynamic DynamicFromAnyXmlFile(const std::string & path,
         const std::string & options,
         std::string * const root_name,
-        std::string * const error);
+        std::string * const error,
+        DynamicArena * arena = NULL);
   Dynamic DynamicFromAnyXmlFile(const std::string & path,
         const Dynamic & options,
         std::string * const root_name,
-        std::string * const error);
+        std::string * const error,
+        DynamicArena * arena = NULL);
+  // Stream variants read XML by XML_STREAM_CHUNK_SIZE chunks from 'read'
+  // callback or from file descriptor, so whole document is never held
+  // in memory. File variants read files the same way.
+  Dynamic DynamicFromAnyXmlStream(XmlReadFunction read, void * context,
+        const std::string & options,
+        std::string * const root_name,
+        std::string * const error,
+        DynamicArena * arena = NULL);
+  Dynamic DynamicFromAnyXmlFd(int fd,
+        const std::string & options,
+        std::string * const root_name,
+        std::string * const error,
+        DynamicArena * arena = NULL);
   Dynamic DynamicFromXml(const std::string & xml,
       const Dynamic & options,
       const Dynamic & mapping,
-      std::string * const error);
+      std::string * const error,
+      DynamicArena * arena = NULL);
   Dynamic DynamicFromXml(const std::string & xml,
       const Dynamic & mapping,
-      std::string * const error);
+      std::string * const error,
+      DynamicArena * arena = NULL);
   Dynamic DynamicFromXml(const std::string & xml,
       const std::string & options,
       const std::string & mapping,
-      std::string * const error);
+      std::string * const error,
+      DynamicArena * arena = NULL);
   Dynamic DynamicFromXml(const std::string & xml,
       const std::string & mapping,
-      std::string * const error);
+      std::string * const error,
+      DynamicArena * arena = NULL);
   Dynamic DynamicFromXmlFile(const std::string & path,
       const std::string & options,
       const std::string & mapping,
-      std::string * const error);
+      std::string * const error,
+      DynamicArena * arena = NULL);
+  Dynamic DynamicFromXmlFile(const std::string & path,
+      const std::string & mapping,
+      std::string * const error,
+      DynamicArena * arena = NULL);
+  Dynamic DynamicFromXmlStream(XmlReadFunction read, void * context,
+      const std::string & options,
+      const std::string & mapping,
+      std::string * const error,
+      DynamicArena * arena = NULL);
+  Dynamic DynamicFromXmlFd(int fd,
+      const std::string & options,
+      const std::string & mapping,
+      std::string * const error,
+      DynamicArena * arena = NULL);
+
+  namespace detail
+  {
+    struct Options;
+    class XmlBuilderPool;
+  } // namespace detail
+
+  // Options and mapping parsed once. Immutable and safe to share between
+  // threads. Keeps a pool of ready parsers, so documents parsed with it
+  // do not pay for options, mapping and expat parser setup.
+  class DynamicXmlMapping
+  {
+  public:
+    typedef NKIT_SHARED_PTR(DynamicXmlMapping) Ptr;
+
+    static Ptr Create(const std::string & options,
+        const std::string & mapping, std::string * const error);
+    static Ptr Create(const Dynamic & options,
+        const Dynamic & mapping, std::string * const error);
+
+    ~DynamicXmlMapping();
+
+    detail::XmlBuilderPool & pool() const { return *pool_; }
+
+  private:
+    static Ptr Create(const NKIT_SHARED_PTR(detail::Options) & options,
+        const Dynamic & mapping, std::string * const error);
+
+    explicit DynamicXmlMapping(detail::XmlBuilderPool * pool);
+    DynamicXmlMapping(const DynamicXmlMapping &);
+    DynamicXmlMapping & operator = (const DynamicXmlMapping &);
+
+  private:
+    detail::XmlBuilderPool * pool_;
+  };
+
+  Dynamic DynamicFromXml(const std::string & xml,
+      const DynamicXmlMapping & mapping,
+      std::string * const error,
+      DynamicArena * arena = NULL);
   Dynamic DynamicFromXmlFile(const std::string & path,
+      const DynamicXmlMapping & mapping,
+      std::string * const error,
+      DynamicArena * arena = NULL);
+  Dynamic DynamicFromXmlStream(XmlReadFunction read, void * context,
+      const DynamicXmlMapping & mapping,
+      std::string * const error,
+      DynamicArena * arena = NULL);
+
+  // Parallel mode for documents of form '<root>record ... record</root>'.
+  // Document is split at boundaries of root's children by fast pre-scan,
+  // parts are parsed by 'threads' threads (0 - one per CPU) and lists of
+  // their items are concatenated in document order. 'mapping' must be
+  // a list mapping. Documents with internal DTD subset are parsed
+  // sequentially.
+  Dynamic DynamicFromXmlParallel(const std::string & xml,
+      const DynamicXmlMapping & mapping,
+      size_t threads,
+      std::string * const error);
+  Dynamic DynamicFromXmlFileParallel(const std::string & path,
+      const DynamicXmlMapping & mapping,
+      size_t threads,
+      std::string * const error);
+
+  // Record-at-a-time mode: 'mapping' must be a list mapping, its items are
+  // passed to 'callback' one by one as soon as they are parsed and are not
+  // accumulated. Returns false on error, including when callback returns
+  // false to stop parsing.
+  typedef bool (*DynamicRecordCallback)(const Dynamic & record,
+      void * context);
+
+  bool DynamicXmlStreamForEach(XmlReadFunction read, void * read_context,
+      const std::string & options,
+      const std::string & mapping,
+      DynamicRecordCallback callback,
+      void * context,
+      std::string * const error);
+  bool DynamicXmlFileForEach(const std::string & path,
+      const std::string & options,
       const std::string & mapping,
+      DynamicRecordCallback callback,
+      void * context,
       std::string * const error);
 } // namespace nkit
 
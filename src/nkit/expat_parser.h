@@ -8,6 +8,14 @@
 
 namespace nkit
 {
+  //----------------------------------------------------------------------------
+  // Reads up to 'size' bytes of XML into 'buffer'. Returns number of bytes
+  // read, 0 at the end of stream, or -1 on failure (with 'error' set)
+  typedef int64_t (*XmlReadFunction)(char * buffer, size_t size,
+      void * context, std::string * error);
+
+  static const size_t XML_STREAM_CHUNK_SIZE = 64 * 1024;
+
   //----------------------------------------------------------------------------
   template<typename T>
   class ExpatParser
@@ -24,26 +32,56 @@ namespace nkit
       bool result = true;
       if (!XML_Parse(parser_, chunk, len, last))
       {
-        XML_Error code = XML_GetErrorCode(parser_);
-        if (code == XML_ERROR_ABORTED)
-          static_cast<T*>(this)->GetCustomError(error);
-        else
-          *error = "Parse error at (line:"
-              + nkit::string_cast(
-                  static_cast<uint64_t>(XML_GetCurrentLineNumber(parser_)))
-              + ", column:"
-              + nkit::string_cast(
-                  static_cast<uint64_t>(XML_GetCurrentColumnNumber(parser_)))
-              + ") " + XML_ErrorString(code);
-
+        GetParseError(error);
         result = false;
       }
 
-      if (last)
+      // parser is not usable after error, so it is rewound as well
+      if (last || !result)
         Reset();
       return result;
     }
 
+    // Feeds the whole stream: 'read' fills expat's own buffer chunk by
+    // chunk, so memory usage does not depend on document size
+    bool FeedStream(XmlReadFunction read, void * context,
+        std::string * error, size_t chunk_size = XML_STREAM_CHUNK_SIZE)
+    {
+      bool result = true;
+      while (true)
+      {
+        void * buffer = XML_GetBuffer(parser_, static_cast<int>(chunk_size));
+        if (!buffer)
+        {
+          *error = "Could not allocate parser buffer";
+          result = false;
+          break;
+        }
+
+        int64_t size = read(static_cast<char *>(buffer), chunk_size,
+            context, error);
+        if (size < 0)
+        {
+          result = false;
+          break;
+        }
+
+        bool last = size == 0;
+        if (!XML_ParseBuffer(parser_, static_cast<int>(size), last))
+        {
+          GetParseError(error);
+          result = false;
+          break;
+        }
+
+        if (last)
+          break;
+      }
+
+      Reset();
+      return result;
+    }
+
   protected:
     // dtor is non-virtual because it is protected and will not be
     // used explicitly
@@ -64,6 +102,21 @@ namespace nkit
     }
 
   private:
+    void GetParseError(std::string * error)
+    {
+      XML_Error code = XML_GetErrorCode(parser_);
+      if (code == XML_ERROR_ABORTED)
+        static_cast<T*>(this)->GetCustomError(error);
+      else
+        *error = "Parse error at (line:"
+            + nkit::string_cast(
+                static_cast<uint64_t>(XML_GetCurrentLineNumber(parser_)))
+            + ", column:"
+            + nkit::string_cast(
+                static_cast<uint64_t>(XML_GetCurrentColumnNumber(parser_)))
+            + ") " + XML_ErrorString(code);
+    }
+
     void AbortParsing()
     {
       XML_StopParser(parser_, 0);
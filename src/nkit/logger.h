@@ -18,10 +18,13 @@
 #define __NKIT__LOGGER__H__
 
 #include <ctime>
+#include <cstring>
+#include <ostream>
 #include <sstream>
 
 #include <nkit/tools.h>
 #include <nkit/mutex.h>
+#include <nkit/detail/atomic.h>
 
 namespace nkit
 {
@@ -40,14 +43,65 @@ namespace nkit
     //--------------------------------------------------------------------------
     const std::string & get_log_level_name(detail::LogLevel level);
 
+    // Appends text of binary log record (see nkit/logger/log_record.h)
+    bool format_log_record(const char * data, size_t size, std::string * out);
+
+    //--------------------------------------------------------------------------
+    // Stream buffer which keeps line in std::string, so line can be read
+    // without copying and its memory is reused by next lines
+    class LogLineBuf : public std::streambuf
+    {
+    public:
+      const std::string & line() const { return line_; }
+      void assign(const std::string & text) { line_.assign(text); }
+
+    protected:
+      virtual int_type overflow(int_type ch)
+      {
+        if (!traits_type::eq_int_type(ch, traits_type::eof()))
+          line_.push_back(traits_type::to_char_type(ch));
+        return traits_type::not_eof(ch);
+      }
+
+      virtual std::streamsize xsputn(const char * data, std::streamsize size)
+      {
+        line_.append(data, static_cast<size_t>(size));
+        return size;
+      }
+
+    private:
+      std::string line_;
+    };
+
+    //--------------------------------------------------------------------------
+    // Has str() methods of std::ostringstream, but str() does not copy
+    class LogLineStream : public std::ostream
+    {
+    public:
+      LogLineStream()
+        : std::ostream(NULL)
+      {
+        rdbuf(&buf_);
+      }
+
+      const std::string & str() const { return buf_.line(); }
+      void str(const std::string & text) { buf_.assign(text); }
+
+    private:
+      LogLineBuf buf_;
+    };
   } // namespace detail
 
   //----------------------------------------------------------------------------
   class LoggerAccessor;
+  class LogRecordAccessor;
+  class AsyncLogger;
 
   class Logger
   {
     friend class LoggerAccessor;
+    friend class LogRecordAccessor;
+    friend class AsyncLogger;
 
     Logger(const Logger &);
     Logger & operator=(const Logger &);
@@ -74,26 +128,108 @@ namespace nkit
       return logger_.get();
     }
 
+    // Process wide minimum level, lines below it are not formatted at all.
+    // Default is LL_DEBUG in debug builds and LL_INFO otherwise.
+    static void SetLevel(detail::LogLevel level)
+    {
+      detail::atomic_store(&min_level_, static_cast<uint32_t>(level));
+    }
+
+    static detail::LogLevel level()
+    {
+      return static_cast<detail::LogLevel>(detail::atomic_load(&min_level_));
+    }
+
+    static bool IsEnabled(detail::LogLevel level)
+    {
+      return static_cast<uint32_t>(level) >= detail::atomic_load(&min_level_);
+    }
+
   protected:
     virtual bool WriteLine(detail::LogLevel level, time_t now,
         bool put_header) = 0;
-    const std::ostringstream & stream() const { return stream_; }
+    const detail::LogLineStream & stream() const { return stream_; }
+
+    // Writes line formatted elsewhere (by AsyncLogger). Called under
+    // mutex_. Loggers which can batch output should override it together
+    // with Flush(), which is called after each batch.
+    virtual bool WriteFormatted(detail::LogLevel level, time_t now,
+        bool put_header, const std::string & text)
+    {
+      stream_.str(text);
+      bool ret = WriteLine(level, now, put_header);
+      stream_.str("");
+      return ret;
+    }
+
+    // Writes binary log record. Called under mutex_, by writer thread of
+    // AsyncLogger when logger is its target. Default implementation
+    // formats record to text.
+    virtual bool WriteRecord(detail::LogLevel level, time_t now,
+        bool put_header, const char * data, size_t size)
+    {
+      std::string text;
+      detail::format_log_record(data, size, &text);
+      return WriteFormatted(level, now, put_header, text);
+    }
+
+    // Writes binary log record from calling thread, as WriteLine() does
+    // for text lines, so logger flushes it as its lines. Called under
+    // mutex_. Default implementation formats record to text.
+    virtual bool WriteRecordLine(detail::LogLevel level, time_t now,
+        bool put_header, const char * data, size_t size)
+    {
+      std::string text;
+      detail::format_log_record(data, size, &text);
+      stream_.str(text);
+      bool ret = WriteLine(level, now, put_header);
+      stream_.str("");
+      return ret;
+    }
+
+    virtual void Flush() {}
+
+    // Time as "Mmm dd hh:mm:ss yyyy", rendered once per second.
+    // Called under mutex_.
+    const char * GetTime(time_t now, size_t * size) const
+    {
+      if (now != time_cache_)
+      {
+        char buf[128];
+        if (CTIME_R(now, buf, sizeof(buf)))
+        {
+          // skip week day, trim '\n'
+          size_t length = strlen(buf);
+          time_cache_size_ = length > 5 ? length - 5 : 0;
+          memcpy(time_cache_buf_, buf + 4, time_cache_size_);
+        }
+        else
+          time_cache_size_ = 0;
+        time_cache_buf_[time_cache_size_] = '\0';
+        time_cache_ = now;
+      }
+      *size = time_cache_size_;
+      return time_cache_buf_;
+    }
+
+    // Appends "day-time host user[pid]: level\t " to 'out'.
+    // Called under mutex_.
+    void AppendHeader(detail::LogLevel level, time_t now,
+        std::string * out) const
+    {
+      size_t size;
+      const char * time = GetTime(now, &size);
+      out->append(time, size);
+      if (likely(static_cast<size_t>(level) < detail::LL_MAX))
+        out->append(header_tails_[level]);
+      else
+        out->append(RenderHeaderTail(level));
+    }
+
     std::string GetHeader(detail::LogLevel level, time_t now) const
     {
-      char tp_[128];
-      CTIME_R(now, tp_, sizeof(tp_));
-      const char * tp = (tp_ + 0) + 4;
-      // Head : "day-time host user[pid]: level\t"
       std::string header;
-      header.assign(tp, strlen(tp) - 1); // trim '\n'
-      header.append(" ");
-      header.append(host_);
-      header.append(" ");
-      header.append(user_);
-      header.append(process_id_);
-      header.append(": ");
-      header.append(detail::get_log_level_name(level));
-      header.append("\t ");
+      AppendHeader(level, now, &header);
       return header;
     }
 
@@ -101,21 +237,50 @@ namespace nkit
       : process_id_(get_process_id())
       , host_(get_hostname())
       , user_(get_username())
-    {}
+      , async_(false)
+      , time_cache_(static_cast<time_t>(-1))
+      , time_cache_size_(0)
+    {
+      time_cache_buf_[0] = '\0';
+      for (size_t level = 0; level < detail::LL_MAX; ++level)
+        header_tails_[level] =
+            RenderHeaderTail(static_cast<detail::LogLevel>(level));
+    }
+
+  private:
+    std::string RenderHeaderTail(detail::LogLevel level) const
+    {
+      std::string tail(" ");
+      tail.append(host_);
+      tail.append(" ");
+      tail.append(user_);
+      tail.append(process_id_);
+      tail.append(": ");
+      tail.append(detail::get_log_level_name(level));
+      tail.append("\t ");
+      return tail;
+    }
 
   private :
     static Logger::Ptr logger_;
+    static volatile uint32_t min_level_;
     std::string const process_id_;
     std::string const host_;
     std::string const user_;
-    std::ostringstream stream_;
+    detail::LogLineStream stream_;
     Mutex mutex_;
+    bool async_;
+    std::string header_tails_[detail::LL_MAX];
+    mutable time_t time_cache_;
+    mutable size_t time_cache_size_;
+    mutable char time_cache_buf_[64];
   }; // class Logger
 } // namespace nkit
 
 #include <nkit/logger/console_logger.h>
 #include <nkit/logger/rotate_logger.h>
 #include <nkit/logger/rsyslog_logger.h>
+#include <nkit/logger/async_logger.h>
 
 namespace nkit
 {
@@ -128,6 +293,7 @@ namespace nkit
       , now_(0)
       , put_header_(false)
       , logger_(NULL)
+      , stream_(NULL)
     {
       ::std::time(&now_);
     }
@@ -176,7 +342,7 @@ namespace nkit
         BeginLine();
       }
 
-      logger_->stream_ << v;
+      *stream_ << v;
 
       return *this;
     }
@@ -186,11 +352,24 @@ namespace nkit
 
     void BeginLine()
     {
+      if (logger_->async_)
+      {
+        // formatted without any lock, AsyncLogger's thread writes it
+        stream_ = &detail::async_log_stream();
+        return;
+      }
       logger_->mutex_.Lock();
+      stream_ = &logger_->stream_;
     }
 
     void EndLine()
     {
+      if (logger_->async_)
+      {
+        static_cast<AsyncLogger *>(logger_)->Push(level_, now_, put_header_,
+            stream_);
+        return;
+      }
       logger_->WriteLine(level_, now_, put_header_);
       logger_->stream_.str("");
       logger_->mutex_.Unlock();
@@ -201,26 +380,26 @@ namespace nkit
     time_t now_;
     bool put_header_;
     Logger * logger_;
+    detail::LogLineStream * stream_;
   };
 
 } // namespace nkit
 
 //------------------------------------------------------------------------------
-#define NKIT_LOG__(v, level)          \
-    do                                \
-    {                                 \
-      nkit::LoggerAccessor a(level);  \
-      a << v;                         \
-    } while (0)                       \
+// Level is checked before time() call, locking and formatting of 'v'
+#define NKIT_LOG__(v, level)                \
+    do                                      \
+    {                                       \
+      if (nkit::Logger::IsEnabled(level))   \
+      {                                     \
+        nkit::LoggerAccessor a(level);      \
+        a << v;                             \
+      }                                     \
+    } while (0)                             \
 
 #define NKIT_LOG_INFO(v)    NKIT_LOG__(v, nkit::detail::LL_INFO)
 #define NKIT_LOG_WARNING(v) NKIT_LOG__(v, nkit::detail::LL_WARN)
 #define NKIT_LOG_ERROR(v)   NKIT_LOG__(v, nkit::detail::LL_ERROR)
-
-#ifdef NKIT_DEBUG
 #define NKIT_LOG_DEBUG(v)   NKIT_LOG__(v, nkit::detail::LL_DEBUG)
-#else
-#define NKIT_LOG_DEBUG(v)
-#endif
 
 #endif
@@ -0,0 +1,153 @@
+/*
+   Copyright 2014 Boris T. Darchiev (boris.darchiev@gmail.com)
+                  Vasiliy Soshnikov (dedok.mad@gmail.com)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef __NKIT__ASYNC__LOGGER__H__
+#define __NKIT__ASYNC__LOGGER__H__
+
+#include <nkit/types.h>
+#include <nkit/detail/atomic.h>
+
+#include <sstream>
+#include <string>
+
+#if defined(NKIT_WINNT)
+#  include <windows.h>
+#else
+#  include <pthread.h>
+#endif
+
+namespace nkit
+{
+  enum AsyncOverflowPolicy
+  {
+    ASYNC_OVERFLOW_BLOCK = 0, // producer waits for free place in queue
+    ASYNC_OVERFLOW_DROP       // line is dropped and counted
+  };
+
+  namespace detail
+  {
+    // Stream of calling thread, lines for AsyncLogger are formatted in it
+    LogLineStream & async_log_stream();
+
+    struct AsyncLogRecord
+    {
+      AsyncLogRecord * volatile next_;
+      LogLevel level_;
+      time_t now_;
+      bool put_header_;
+      bool binary_; // text_ is binary log record
+      std::string text_;
+    };
+  } // namespace detail
+
+  //----------------------------------------------------------------------------
+  // Front end for other logger. Lines are formatted by calling threads in
+  // their own buffers without any lock, put to lock-free MPSC queue and
+  // written to target logger by background thread in batches, one target
+  // lock and flush per batch. Binary log records are queued as is and
+  // formatted by background thread.
+  class AsyncLogger : public Logger
+  {
+    friend class LoggerAccessor;
+    friend class LogRecordAccessor;
+
+  public:
+    static const size_t DEFAULT_QUEUE_SIZE = 64 * 1024;
+    static const size_t DEFAULT_BATCH_SIZE = 256;
+
+    struct Options
+    {
+      Options()
+        : queue_size(DEFAULT_QUEUE_SIZE)
+        , batch_size(DEFAULT_BATCH_SIZE)
+        , overflow(ASYNC_OVERFLOW_BLOCK)
+      {}
+
+      size_t queue_size; // max count of lines waiting for writing
+      size_t batch_size; // max count of lines written under one target lock
+      AsyncOverflowPolicy overflow;
+    };
+
+    static Logger::Ptr Create(const Logger::Ptr & target,
+        const Options & options = Options(),
+        std::string * error = NULL);
+
+    // Writes all queued lines and stops writer thread
+    ~AsyncLogger();
+
+    // Returns when all lines queued before call are written and flushed
+    // by target
+    virtual void Flush();
+
+    // Count of lines dropped by ASYNC_OVERFLOW_DROP policy
+    uint64_t dropped() const
+    {
+      return detail::atomic_load(&dropped_);
+    }
+
+  private:
+    AsyncLogger(const Logger::Ptr & target, const Options & options);
+    bool Start();
+
+    virtual bool WriteLine(detail::LogLevel level, time_t now,
+        bool put_header);
+    virtual bool WriteRecord(detail::LogLevel level, time_t now,
+        bool put_header, const char * data, size_t size);
+    void Push(detail::LogLevel level, time_t now, bool put_header,
+        detail::LogLineStream * stream);
+    void PushRecord(detail::LogLevel level, time_t now, bool put_header,
+        const char * data, size_t size);
+    bool Reserve();
+    void Enqueue(detail::AsyncLogRecord * record);
+    detail::AsyncLogRecord * Dequeue();
+    size_t WriteBatch();
+    void Run();
+
+#if defined(NKIT_WINNT)
+    static DWORD WINAPI ThreadProc(LPVOID arg);
+#else
+    static void * ThreadProc(void * arg);
+#endif
+
+  private:
+    Logger::Ptr target_;
+    size_t capacity_;
+    size_t batch_size_;
+    AsyncOverflowPolicy overflow_;
+
+    // Vyukov's intrusive MPSC queue: producers exchange head_,
+    // writer thread owns tail_
+    detail::AsyncLogRecord * volatile head_;
+    detail::AsyncLogRecord * tail_;
+    detail::AsyncLogRecord stub_;
+
+    volatile uint64_t size_;
+    volatile uint64_t pushed_;
+    volatile uint64_t written_;
+    volatile uint64_t dropped_;
+    volatile uint32_t stop_;
+
+#if defined(NKIT_WINNT)
+    HANDLE thread_;
+#else
+    pthread_t thread_;
+#endif
+    bool started_;
+  }; // class AsyncLogger
+} // namespace nkit
+
+#endif
@@ -38,29 +38,35 @@ namespace nkit
   private:
     virtual bool WriteLine(detail::LogLevel level, time_t now, bool put_header)
     {
-      std::string header(put_header ? GetHeader(level, now) : "");
+      line_.clear();
+      if (put_header)
+        AppendHeader(level, now, &line_);
+      line_.append(stream().str());
+      line_.push_back('\n');
 
+      std::ostream * out;
       switch (level)
       {
       case detail::LL_INFO:
       case detail::LL_DEBUG:
-        std::cout << header;
-        std::cout << stream().str() << std::endl;
-        std::cout.flush();
+        out = &std::cout;
         break;
       case detail::LL_ERROR:
       case detail::LL_WARN:
       default:
-        std::cerr << header;
-        std::cerr << stream().str() << std::endl;
-        std::cerr.flush();
+        out = &std::cerr;
         break;
       }
+      out->write(line_.data(), static_cast<std::streamsize>(line_.size()));
+      out->flush();
       return true;
     }
 
     ConsoleLogger()
     {}
+
+  private:
+    std::string line_;
   }; // class ConsoleLogger
 
   extern ConsoleLogger::Ptr console_logger;
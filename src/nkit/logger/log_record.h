@@ -0,0 +1,406 @@
+/*
+   Copyright 2014 Boris T. Darchiev (boris.darchiev@gmail.com)
+                  Vasiliy Soshnikov (dedok.mad@gmail.com)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef __NKIT__LOG__RECORD__H__
+#define __NKIT__LOG__RECORD__H__
+
+#include <nkit/logger.h>
+#include <nkit/dynamic.h>
+
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <string>
+
+// Structured log records.
+//
+// Record is not formatted by calling thread. It is captured as binary
+// record: id of format string registered once per call site and typed
+// arguments. Text is made from it later by logger (by writer thread in case
+// of AsyncLogger), or never, if logger writes records as is
+// (LogRecordFileLogger).
+//
+//   NKIT_SLOG_INFO("user {} logged in from {}", name << address);
+//   NKIT_SLOG_ERROR("{} requests failed", logger << failed);
+//
+// Each '{}' in format is replaced by next argument, arguments without
+// placeholder are appended to text through space.
+//
+// Record layout (numbers are in host byte order):
+//   u32 format_id, then for each argument: u8 LogArgType and its value:
+//   int64, uint64, double, u8 bool or u32 size and bytes of string or JSON.
+
+namespace nkit
+{
+  namespace detail
+  {
+    enum LogArgType
+    {
+      LOG_ARG_INT64 = 1,
+      LOG_ARG_UINT64,
+      LOG_ARG_DOUBLE,
+      LOG_ARG_BOOL,
+      LOG_ARG_STRING,
+      LOG_ARG_JSON    // list, dict and other not scalar Dynamic values
+    };
+
+    //--------------------------------------------------------------------------
+    // Buffer of record, does not allocate memory for small records
+    class LogRecordBuffer
+    {
+    public:
+      static const size_t INLINE_SIZE = 256;
+
+      LogRecordBuffer()
+        : data_(inline_)
+        , size_(0)
+        , capacity_(INLINE_SIZE)
+      {}
+
+      ~LogRecordBuffer()
+      {
+        if (data_ != inline_)
+          delete [] data_;
+      }
+
+      void append(const char * data, size_t size)
+      {
+        if (unlikely(size > capacity_ - size_))
+          Grow(size);
+        std::memcpy(data_ + size_, data, size);
+        size_ += size;
+      }
+
+      void push_back(char ch)
+      {
+        if (unlikely(size_ == capacity_))
+          Grow(1);
+        data_[size_++] = ch;
+      }
+
+      template <typename T>
+      void append_value(T v)
+      {
+        append(reinterpret_cast<const char *>(&v), sizeof(v));
+      }
+
+      const char * data() const { return data_; }
+      size_t size() const { return size_; }
+      void clear() { size_ = 0; }
+
+    private:
+      LogRecordBuffer(const LogRecordBuffer &);
+      LogRecordBuffer & operator = (const LogRecordBuffer &);
+
+      void Grow(size_t size)
+      {
+        size_t capacity = capacity_ * 2;
+        while (capacity - size_ < size)
+          capacity *= 2;
+        char * data = new char[capacity];
+        std::memcpy(data, data_, size_);
+        if (data_ != inline_)
+          delete [] data_;
+        data_ = data;
+        capacity_ = capacity;
+      }
+
+    private:
+      char inline_[INLINE_SIZE];
+      char * data_;
+      size_t size_;
+      size_t capacity_;
+    };
+
+    //--------------------------------------------------------------------------
+    inline void put_log_arg_string(const char * data, size_t size,
+        LogArgType type, LogRecordBuffer * buffer)
+    {
+      buffer->push_back(static_cast<char>(type));
+      buffer->append_value(static_cast<uint32_t>(size));
+      buffer->append(data, size);
+    }
+
+    // Scalars are put as is, containers as JSON
+    void put_log_arg(const Dynamic & v, LogRecordBuffer * buffer);
+
+    //--------------------------------------------------------------------------
+    // Types without specialization are formatted by operator << at once
+    template <typename T>
+    struct LogArgTraits
+    {
+      static void Put(const T & v, LogRecordBuffer * buffer)
+      {
+        std::ostringstream stream;
+        stream << v;
+        const std::string & str = stream.str();
+        put_log_arg_string(str.data(), str.size(), LOG_ARG_STRING, buffer);
+      }
+    };
+
+#define NKIT_LOG_ARG_NUMBER(type, arg_type, value_type)                       \
+    template <>                                                               \
+    struct LogArgTraits<type>                                                 \
+    {                                                                         \
+      static void Put(const type & v, LogRecordBuffer * buffer)               \
+      {                                                                       \
+        buffer->push_back(static_cast<char>(arg_type));                       \
+        buffer->append_value(static_cast<value_type>(v));                     \
+      }                                                                       \
+    };
+
+    NKIT_LOG_ARG_NUMBER(signed char, LOG_ARG_INT64, int64_t)
+    NKIT_LOG_ARG_NUMBER(short, LOG_ARG_INT64, int64_t)
+    NKIT_LOG_ARG_NUMBER(int, LOG_ARG_INT64, int64_t)
+    NKIT_LOG_ARG_NUMBER(long, LOG_ARG_INT64, int64_t)
+    NKIT_LOG_ARG_NUMBER(long long, LOG_ARG_INT64, int64_t)
+    NKIT_LOG_ARG_NUMBER(unsigned char, LOG_ARG_UINT64, uint64_t)
+    NKIT_LOG_ARG_NUMBER(unsigned short, LOG_ARG_UINT64, uint64_t)
+    NKIT_LOG_ARG_NUMBER(unsigned int, LOG_ARG_UINT64, uint64_t)
+    NKIT_LOG_ARG_NUMBER(unsigned long, LOG_ARG_UINT64, uint64_t)
+    NKIT_LOG_ARG_NUMBER(unsigned long long, LOG_ARG_UINT64, uint64_t)
+    NKIT_LOG_ARG_NUMBER(float, LOG_ARG_DOUBLE, double)
+    NKIT_LOG_ARG_NUMBER(double, LOG_ARG_DOUBLE, double)
+    NKIT_LOG_ARG_NUMBER(long double, LOG_ARG_DOUBLE, double)
+    NKIT_LOG_ARG_NUMBER(bool, LOG_ARG_BOOL, uint8_t)
+
+#undef NKIT_LOG_ARG_NUMBER
+
+    template <>
+    struct LogArgTraits<char>
+    {
+      static void Put(const char & v, LogRecordBuffer * buffer)
+      {
+        put_log_arg_string(&v, 1, LOG_ARG_STRING, buffer);
+      }
+    };
+
+    template <>
+    struct LogArgTraits<const char *>
+    {
+      static void Put(const char * v, LogRecordBuffer * buffer)
+      {
+        if (!v)
+          v = "(null)";
+        put_log_arg_string(v, std::strlen(v), LOG_ARG_STRING, buffer);
+      }
+    };
+
+    template <>
+    struct LogArgTraits<char *>
+    {
+      static void Put(const char * v, LogRecordBuffer * buffer)
+      {
+        LogArgTraits<const char *>::Put(v, buffer);
+      }
+    };
+
+    template <>
+    struct LogArgTraits<std::string>
+    {
+      static void Put(const std::string & v, LogRecordBuffer * buffer)
+      {
+        put_log_arg_string(v.data(), v.size(), LOG_ARG_STRING, buffer);
+      }
+    };
+
+    template <>
+    struct LogArgTraits<Dynamic>
+    {
+      static void Put(const Dynamic & v, LogRecordBuffer * buffer)
+      {
+        put_log_arg(v, buffer);
+      }
+    };
+  } // namespace detail
+
+  //----------------------------------------------------------------------------
+  // Registers format string and returns its id. Same strings get same id.
+  // Formats are never unregistered.
+  uint32_t RegisterLogFormat(const char * format);
+
+  // Returns NULL for unknown id
+  const char * GetLogFormat(uint32_t format_id);
+
+  //----------------------------------------------------------------------------
+  class LogRecordAccessor
+  {
+  public:
+    LogRecordAccessor(detail::LogLevel level, uint32_t format_id)
+      : level_(level)
+      , now_(0)
+      , put_header_(false)
+      , logger_(NULL)
+    {
+      ::std::time(&now_);
+      buffer_.append_value(format_id);
+    }
+
+    ~LogRecordAccessor()
+    {
+      if (!logger_)
+      {
+        logger_ = Logger::Instance();
+        if (!logger_)
+        {
+          logger_ = console_logger.get();
+          put_header_ = true;
+        }
+      }
+
+      if (logger_->async_)
+      {
+        static_cast<AsyncLogger *>(logger_)->PushRecord(level_, now_,
+            put_header_, buffer_.data(), buffer_.size());
+        return;
+      }
+
+      LockGuard<Mutex> guard(logger_->mutex_);
+      logger_->WriteRecordLine(level_, now_, put_header_, buffer_.data(),
+          buffer_.size());
+    }
+
+    // Logger may be set by any argument, record is written to last one
+    LogRecordAccessor & operator << (Logger & logger)
+    {
+      logger_ = &logger;
+      put_header_ = (logger_ != console_logger.get());
+      return *this;
+    }
+
+    LogRecordAccessor & operator << (Logger::Ptr logger)
+    {
+      return operator << (*logger);
+    }
+
+    LogRecordAccessor & operator << (Logger * logger)
+    {
+      return operator << (*logger);
+    }
+
+    template <typename T>
+    LogRecordAccessor & operator << (const T & v)
+    {
+      detail::LogArgTraits<T>::Put(v, &buffer_);
+      return *this;
+    }
+
+    template <size_t N>
+    LogRecordAccessor & operator << (const char (&v)[N])
+    {
+      detail::LogArgTraits<const char *>::Put(v, &buffer_);
+      return *this;
+    }
+
+  private:
+    LogRecordAccessor(const LogRecordAccessor &);
+    LogRecordAccessor & operator = (const LogRecordAccessor &);
+
+  private:
+    detail::LogLevel level_;
+    time_t now_;
+    bool put_header_;
+    Logger * logger_;
+    detail::LogRecordBuffer buffer_;
+  };
+
+  //----------------------------------------------------------------------------
+  enum LogRecordFileFormat
+  {
+    LOG_RECORD_FILE_JSON = 0, // one JSON object per line
+    LOG_RECORD_FILE_BINARY    // records as is, see ReadLogRecordFile()
+  };
+
+  // Writes records without formatting them to text. Plain text lines
+  // (NKIT_LOG_*) are written as records of "{}" format with one argument.
+  //
+  // JSON line:
+  //   {"time": 1400000000, "level": "info", "format": "user {} from {}",
+  //    "message": "user bob from 10.0.0.1", "args": ["bob", "10.0.0.1"]}
+  //
+  // Binary file is "NKLR0001" followed by frames: u32 size of rest of frame,
+  // u8 kind and its data. Kind 1 - format: u32 id, text; it precedes first
+  // record of that format written by logger. Kind 2 - record: u8 level,
+  // i64 time and record itself.
+  class LogRecordFileLogger : public Logger
+  {
+  public:
+    static Logger::Ptr Create(const std::string & file_path,
+        LogRecordFileFormat format = LOG_RECORD_FILE_JSON,
+        std::string * error = NULL);
+    ~LogRecordFileLogger();
+
+  private:
+    virtual bool WriteLine(detail::LogLevel level, time_t now, bool);
+    virtual bool WriteFormatted(detail::LogLevel level, time_t now, bool,
+        const std::string & text);
+    virtual bool WriteRecord(detail::LogLevel level, time_t now, bool,
+        const char * data, size_t size);
+    virtual bool WriteRecordLine(detail::LogLevel level, time_t now, bool,
+        const char * data, size_t size);
+    virtual void Flush();
+    bool WriteJson(detail::LogLevel level, time_t now, const char * data,
+        size_t size);
+    bool WriteBinary(detail::LogLevel level, time_t now, const char * data,
+        size_t size);
+
+    LogRecordFileLogger(LogRecordFileFormat format);
+
+  private:
+    std::ofstream file_stream_;
+    LogRecordFileFormat format_;
+    uint32_t text_format_id_;
+    std::set<uint32_t> written_formats_;
+    std::string line_;
+    detail::LogRecordBuffer text_record_;
+  }; // class LogRecordFileLogger
+
+  //----------------------------------------------------------------------------
+  // Called for each record of binary file. 'args' is list of arguments.
+  // Returns false to stop reading.
+  typedef bool (*LogRecordCallback)(detail::LogLevel level, time_t time,
+      const std::string & message, const Dynamic & args, void * context);
+
+  bool ReadLogRecordFile(const std::string & file_path,
+      LogRecordCallback callback, void * context, std::string * error);
+} // namespace nkit
+
+//------------------------------------------------------------------------------
+// Format is registered once per call site, arguments are not formatted
+#define NKIT_SLOG__(format, v, level)                                   \
+    do                                                                  \
+    {                                                                   \
+      if (nkit::Logger::IsEnabled(level))                               \
+      {                                                                 \
+        static const uint32_t nkit_log_format_id_ =                     \
+            nkit::RegisterLogFormat(format);                            \
+        nkit::LogRecordAccessor a(level, nkit_log_format_id_);          \
+        a << v;                                                         \
+      }                                                                 \
+    } while (0)                                                         \
+
+#define NKIT_SLOG_INFO(format, v) \
+    NKIT_SLOG__(format, v, nkit::detail::LL_INFO)
+#define NKIT_SLOG_WARNING(format, v) \
+    NKIT_SLOG__(format, v, nkit::detail::LL_WARN)
+#define NKIT_SLOG_ERROR(format, v) \
+    NKIT_SLOG__(format, v, nkit::detail::LL_ERROR)
+#define NKIT_SLOG_DEBUG(format, v) \
+    NKIT_SLOG__(format, v, nkit::detail::LL_DEBUG)
+
+#endif
@@ -23,6 +23,12 @@
 #include <cstring>
 #include <fstream>
 
+#if defined(NKIT_WINNT)
+#  include <windows.h>
+#else
+#  include <pthread.h>
+#endif
+
 namespace nkit
 {
   enum RotateInterval
@@ -44,33 +50,114 @@ namespace nkit
     ROTATE_SIZE_1G = ROTATE_SIZE_1K * ROTATE_SIZE_1M
   };
 
+  // Called by background thread with path of rotated file,
+  // e.g. to compress it
+  typedef void (*RotatedLogCallback)(const std::string & path,
+      void * context);
+
+  struct RotateOptions
+  {
+    static const size_t DEFAULT_SEGMENT_SIZE = 4 * 1024 * 1024;
+
+    RotateOptions()
+      : segment_size(DEFAULT_SEGMENT_SIZE)
+      , on_rotated(NULL)
+      , context(NULL)
+    {}
+
+    // Size of memory mapped window of file. 0 - lines are written by
+    // write() calls. Not used on Windows.
+    size_t segment_size;
+    RotatedLogCallback on_rotated;
+    void * context;
+  };
+
+  namespace detail
+  {
+    class LogFileSegment;
+  } // namespace detail
+
+  // Lines are copied to memory mapped window of file, size of file is
+  // tracked without system calls. While logger works, file has zero tail
+  // up to end of window, it is cut on rotation and in destructor. If file
+  // was not closed (e.g. process crashed), zero tail is cut on open.
+  //
+  // When rotation is enabled, next file is opened in advance as
+  // 'file_path.next'. Rotation renames both files and switches logger to
+  // the next one; closing of old file, opening of new next file and
+  // 'on_rotated' call are done by background thread. If previous rotation
+  // is not finished yet, rotation is postponed. On Windows open file can
+  // not be renamed, so rotation is done synchronously there.
+  //
+  // If file can not be renamed, error is printed to stderr, logger keeps
+  // writing to the same file and tries again in ROTATE_RETRY_INTERVAL.
   class RotateLogger : public Logger
   {
     static const std::streamoff ROTATE_SIZE_DISABLED = -1;
+    static const time_t ROTATE_RETRY_INTERVAL = 10; // seconds
 
   public:
     static Logger::Ptr Create(const std::string & file_path,
         RotateInterval rotate_interval = ROTATE_INTERVAL_DISABLED,
         std::streamoff rotate_size = ROTATE_SIZE_DISABLED,
         std::string * error = NULL);
+    static Logger::Ptr Create(const std::string & file_path,
+        RotateInterval rotate_interval,
+        std::streamoff rotate_size,
+        const RotateOptions & options,
+        std::string * error = NULL);
     ~RotateLogger();
 
   private:
     virtual bool WriteLine(detail::LogLevel level, time_t now, bool);
+    virtual bool WriteFormatted(detail::LogLevel level, time_t now, bool,
+        const std::string & text);
+    virtual void Flush();
+    void RotateIfNeeded(time_t now);
     void UpdateRotateTimes();
 
-    explicit RotateLogger(const std::string & file_path,
-        RotateInterval rotate_interval, std::streamoff rotate_size);
-    void Rotate(time_t now, size_t suffix);
+    RotateLogger(const std::string & file_path,
+        RotateInterval rotate_interval, std::streamoff rotate_size,
+        const RotateOptions & options);
+    bool Open(std::string * error);
+    bool Rotate(time_t now, size_t suffix);
+    std::string RotatedPath(time_t now, size_t suffix) const;
+    bool IsRotating() const;
+    void WaitRotation();
+    void FinishRotation();
+
+#if defined(NKIT_WINNT)
+    static DWORD WINAPI RotationProc(LPVOID arg);
+#else
+    static void * RotationProc(void * arg);
+#endif
 
   private:
-    std::ofstream file_stream_;
     std::string file_path_;
+    std::string next_path_;
     std::streamoff rotate_size_;
     RotateInterval rotate_interval_;
+    RotateOptions options_;
     time_t prev_rotate_time_;
     time_t next_rotate_time_;
     size_t rotate_by_size_counter_;
+    time_t retry_rotate_time_;
+    std::string line_;
+
+    detail::LogFileSegment * segment_;
+    // Opened in advance, owned by rotation thread while it works
+    detail::LogFileSegment * next_segment_;
+    // Closed, renamed and deleted by rotation thread
+    detail::LogFileSegment * rotated_segment_;
+    std::string rotated_path_;
+
+    volatile uint32_t rotating_;
+#if defined(NKIT_WINNT)
+    HANDLE rotation_thread_;
+#else
+    pthread_t rotation_thread_;
+#endif
+    bool rotation_started_;
   }; // class RotateLogger
 } // namespace nkit
 
@@ -48,11 +48,40 @@
 
 #endif
 #include <sstream>
+#include <vector>
 #include <nkit/tools.h>
 #include <nkit/logger.h>
 
 namespace nkit
 {
+  //----------------------------------------------------------------------------
+  // Lines are collected and sent by batches: one sendmmsg() (one datagram
+  // per line) for datagram sockets, one write of RFC 6587 octet counted
+  // frames for stream sockets. Batch is sent when it reaches 'max_lines'
+  // or 'max_bytes', when its first line is 'flush_interval' seconds old
+  // (checked on next line), on error lines, on Flush() and on destruction.
+  // While syslog is unreachable lines are kept, oldest of them are dropped
+  // above 'max_backlog_bytes', connection is retried once per second.
+  //
+  // By default every line is sent at once. Since age of batch is checked
+  // only when next line comes, larger batches are meant for loggers behind
+  // AsyncLogger (or other owner calling Flush() regularly), otherwise last
+  // lines of quiet process may wait for next line for ever.
+  struct RSysBatchOptions
+  {
+    RSysBatchOptions()
+      : max_lines(1)
+      , max_bytes(64 * 1024)
+      , flush_interval(0)
+      , max_backlog_bytes(4 * 1024 * 1024)
+    {}
+
+    size_t max_lines;
+    size_t max_bytes;
+    time_t flush_interval; // 0 - every line is sent at once
+    size_t max_backlog_bytes;
+  };
+
   //----------------------------------------------------------------------------
   class RSysLoggerDefault : public Logger
   {
@@ -87,18 +116,41 @@ namespace nkit
   {
   protected:
     enum { MAX_HEADER_SIZE = 235 };
+    enum { MAX_TAG_SIZE = 200 };
+    enum { SYSLOG_TIME_SIZE = 15 };
     enum { CLOSED_SOCKET = -1 };
 
   public:
     enum { MAX_MESSAGE_SIZE = 2227 - MAX_HEADER_SIZE };
 
+    // Count of lines dropped from backlog
+    uint64_t dropped() const { return dropped_; }
+
   protected:
-    RSysLoggerBase(int facility, const std::string & ident);
+    RSysLoggerBase(int facility, const std::string & ident,
+        const RSysBatchOptions & batch);
 
     virtual ~RSysLoggerBase() { CloseConnection(true); }
+    // Sets sockfd_ and socktype_, sockfd_ stays CLOSED_SOCKET on failure
     virtual bool Connect() = 0;
     void CloseConnection(bool graceful);
     virtual bool WriteLine(detail::LogLevel level, time_t, bool put_header);
+    virtual void Flush();
+
+  private:
+    enum { RECONNECT_INTERVAL = 1 };
+    enum { MAX_DATAGRAMS_PER_CALL = 64 };
+
+    size_t PendingBegin(size_t index) const
+    {
+      return index ? pending_ends_[index - 1] : 0;
+    }
+
+    bool SendPending(time_t now);
+    bool SendDatagrams();
+    bool SendStream();
+    void TrimBacklog();
+    void Compact();
 
   protected:
     std::string pid_;
@@ -107,6 +159,22 @@ namespace nkit
     std::string ident_;
     int sockfd_;
     int fac_mask_;
+    // "<pri>" and " tag[pid]: [level] " for each level and for unknown one
+    std::string header_prefixes_[detail::LL_MAX + 1];
+    std::string header_suffixes_[detail::LL_MAX + 1];
+    int socktype_;
+
+  private:
+    RSysBatchOptions batch_;
+    // Not sent lines one after another, pending_ends_ are their end offsets,
+    // lines before pending_first_ are sent already
+    std::string pending_;
+    std::vector<size_t> pending_ends_;
+    size_t pending_first_;
+    time_t first_pending_time_;
+    time_t next_connect_time_;
+    std::string frame_;
+    uint64_t dropped_;
   };
 
   //----------------------------------------------------------------------------
@@ -114,12 +182,15 @@ namespace nkit
   {
   public:
     static Logger::Ptr Create(int facility, const std::string & ident,
-        const std::string & unix_socket, std::string * error);
+        const std::string & unix_socket, std::string * error,
+        const RSysBatchOptions & batch = RSysBatchOptions());
+
+    ~RSysUnixSocketLogger() { Flush(); }
 
   private:
     RSysUnixSocketLogger(int facility, const std::string & ident,
-        const std::string & unix_socket)
-      : RSysLoggerBase(facility, ident)
+        const std::string & unix_socket, const RSysBatchOptions & batch)
+      : RSysLoggerBase(facility, ident, batch)
       , unix_socket_(unix_socket)
     {}
 
@@ -134,12 +205,16 @@ namespace nkit
   {
   public:
     static Logger::Ptr Create(int facility, const std::string & ident,
-        const std::string & host, const std::string & port, std::string * error);
+        const std::string & host, const std::string & port, std::string * error,
+        const RSysBatchOptions & batch = RSysBatchOptions());
+
+    ~RSysEndpointLogger() { Flush(); }
 
   private:
     RSysEndpointLogger(int facility, const std::string & ident,
-        const std::string & host, const std::string & port)
-      : RSysLoggerBase(facility, ident)
+        const std::string & host, const std::string & port,
+        const RSysBatchOptions & batch)
+      : RSysLoggerBase(facility, ident, batch)
       , host_(host)
       , port_(port)
     {}
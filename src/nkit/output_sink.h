@@ -0,0 +1,227 @@
+/*
+   Copyright 2010-2014 Boris T. Darchiev (boris.darchiev@gmail.com)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef NKIT_OUTPUT_SINK_H
+#define NKIT_OUTPUT_SINK_H
+
+#include <cerrno>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#if defined(NKIT_WINNT)
+#  include <io.h>
+#else
+#  include <unistd.h>
+#endif
+
+#include "nkit/tools.h"
+
+namespace nkit
+{
+  // Returns false on error
+  typedef bool (*OutputWriteFunction)(const char * data, size_t size,
+      void * context);
+
+  //----------------------------------------------------------------------------
+  // Bounded output buffer, flushed to string, file descriptor, stream
+  // or callback when full. Has 'write' method, so it can be used as
+  // target of DynamicToJson() as well.
+  class OutputSink
+  {
+  public:
+    static const size_t DEFAULT_BUFFER_SIZE = 64 * 1024;
+
+    OutputSink(OutputWriteFunction write, void * context,
+        size_t buffer_size = DEFAULT_BUFFER_SIZE)
+      : write_(write)
+      , context_(context)
+      , fd_(-1)
+    {
+      Init(buffer_size);
+    }
+
+    explicit OutputSink(std::string * out,
+        size_t buffer_size = DEFAULT_BUFFER_SIZE)
+      : write_(WriteToString)
+      , context_(out)
+      , fd_(-1)
+    {
+      Init(buffer_size);
+    }
+
+    explicit OutputSink(std::ostream * out,
+        size_t buffer_size = DEFAULT_BUFFER_SIZE)
+      : write_(WriteToStream)
+      , context_(out)
+      , fd_(-1)
+    {
+      Init(buffer_size);
+    }
+
+    // 'fd' is not closed by sink
+    explicit OutputSink(int fd, size_t buffer_size = DEFAULT_BUFFER_SIZE)
+      : write_(WriteToFd)
+      , fd_(fd)
+    {
+      context_ = &fd_;
+      Init(buffer_size);
+    }
+
+    ~OutputSink()
+    {
+      Flush();
+    }
+
+    void append(const char * data, size_t size)
+    {
+      if (likely(size <= capacity_ - size_))
+      {
+        std::memcpy(&buffer_[size_], data, size);
+        size_ += size;
+      }
+      else
+        AppendSlow(data, size);
+    }
+
+    void append(const std::string & str)
+    {
+      append(str.data(), str.size());
+    }
+
+    void append(const char * str)
+    {
+      append(str, std::strlen(str));
+    }
+
+    void push_back(char ch)
+    {
+      if (unlikely(size_ == capacity_))
+        Flush();
+      buffer_[size_++] = ch;
+    }
+
+    // For DynamicToJson()
+    void write(const char * data, size_t size)
+    {
+      append(data, size);
+    }
+
+    bool Flush()
+    {
+      if (size_)
+        Write(&buffer_[0], size_);
+      size_ = 0;
+      return ok_;
+    }
+
+    bool ok() const { return ok_; }
+    const std::string & error() const { return error_; }
+
+  private:
+    OutputSink(const OutputSink &);
+    OutputSink & operator = (const OutputSink &);
+
+    void Init(size_t buffer_size)
+    {
+      capacity_ = buffer_size ? buffer_size : DEFAULT_BUFFER_SIZE;
+      buffer_.resize(capacity_);
+      size_ = 0;
+      ok_ = true;
+    }
+
+    void AppendSlow(const char * data, size_t size)
+    {
+      Flush();
+      if (size >= capacity_)
+      {
+        Write(data, size);
+      }
+      else
+      {
+        std::memcpy(&buffer_[0], data, size);
+        size_ = size;
+      }
+    }
+
+    // First error is kept. errno is meaningful for descriptor only, other
+    // targets do not report their reason.
+    void Write(const char * data, size_t size)
+    {
+      if (!ok_)
+        return;
+      ok_ = write_(data, size, context_);
+      if (ok_)
+        return;
+
+      if (write_ == WriteToFd)
+        error_ = "Could not write output to file descriptor: " +
+            std::string(strerror(errno));
+      else if (write_ == WriteToStream)
+        error_ = "Could not write output to stream";
+      else
+        error_ = "Output write function has failed";
+    }
+
+    static bool WriteToString(const char * data, size_t size, void * context)
+    {
+      static_cast<std::string *>(context)->append(data, size);
+      return true;
+    }
+
+    static bool WriteToStream(const char * data, size_t size, void * context)
+    {
+      std::ostream * out = static_cast<std::ostream *>(context);
+      out->write(data, static_cast<std::streamsize>(size));
+      return out->good();
+    }
+
+    static bool WriteToFd(const char * data, size_t size, void * context)
+    {
+      int fd = *static_cast<int *>(context);
+      while (size)
+      {
+#if defined(NKIT_WINNT)
+        int written = ::_write(fd, data, static_cast<unsigned int>(size));
+#else
+        ssize_t written = ::write(fd, data, size);
+#endif
+        if (written < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+      }
+      return true;
+    }
+
+  private:
+    OutputWriteFunction write_;
+    void * context_;
+    int fd_;
+    std::vector<char> buffer_;
+    size_t capacity_;
+    size_t size_;
+    bool ok_;
+    std::string error_;
+  };
+} // namespace nkit
+
+#endif // NKIT_OUTPUT_SINK_H
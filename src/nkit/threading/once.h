@@ -0,0 +1,91 @@
+/*
+   Copyright 2014 Boris T. Darchiev (boris.darchiev@gmail.com)
+                  Vasiliy Soshnikov (dedok.mad@gmail.com)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef __NKIT__THREADING__ONCE__H__
+#define __NKIT__THREADING__ONCE__H__
+
+#include <nkit/tools.h>
+#include <nkit/threading/spin_lock.h>
+
+namespace nkit
+{
+  //----------------------------------------------------------------------------
+  // Flag of CallOnce(). Has no constructor, so static flags are ready before
+  // any dynamic initialization:
+  //
+  //   static nkit::Once init_once = NKIT_ONCE_INIT;
+  //   nkit::CallOnce(&init_once, init);
+  struct Once
+  {
+    volatile uint32_t state_;
+  };
+
+#define NKIT_ONCE_INIT {0}
+
+  namespace detail
+  {
+    enum OnceState
+    {
+      ONCE_NOT_CALLED = 0,
+      ONCE_RUNNING,
+      ONCE_DONE
+    };
+
+    inline bool once_begin(Once * once)
+    {
+      if (likely(atomic_load(&once->state_) == ONCE_DONE))
+        return false;
+
+      if (atomic_cas(&once->state_, uint32_t(ONCE_NOT_CALLED),
+          uint32_t(ONCE_RUNNING)))
+        return true;
+
+      // other thread calls function, result must be visible on return
+      uint32_t step = 0;
+      while (atomic_load(&once->state_) != ONCE_DONE)
+        spin_backoff(&step);
+      return false;
+    }
+
+    inline void once_end(Once * once)
+    {
+      atomic_store(&once->state_, uint32_t(ONCE_DONE));
+    }
+  } // namespace detail
+
+  // Calls 'func' only once for 'once' flag. Concurrent callers return after
+  // it is finished.
+  inline void CallOnce(Once * once, void (*func)())
+  {
+    if (detail::once_begin(once))
+    {
+      func();
+      detail::once_end(once);
+    }
+  }
+
+  inline void CallOnce(Once * once, void (*func)(void *), void * context)
+  {
+    if (detail::once_begin(once))
+    {
+      func(context);
+      detail::once_end(once);
+    }
+  }
+} // namespace nkit
+
+#endif // __NKIT__THREADING__ONCE__H__
@@ -0,0 +1,133 @@
+/*
+   Copyright 2014 Boris T. Darchiev (boris.darchiev@gmail.com)
+                  Vasiliy Soshnikov (dedok.mad@gmail.com)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef __NKIT__THREADING__RW__LOCK__H__
+#define __NKIT__THREADING__RW__LOCK__H__
+
+#include <nkit/tools.h>
+#include <nkit/mutex.h>
+
+#if defined(NKIT_WINNT)
+#  include <windows.h>
+#else
+#  include <errno.h>
+#  include <string.h>
+#  include <pthread.h>
+#endif
+
+namespace nkit
+{
+  //----------------------------------------------------------------------------
+  // Readers do not exclude each other. Lock()/Unlock() take it exclusively,
+  // so LockGuard<RWLock> is writer's guard, ReadLockGuard<RWLock> is
+  // reader's one. Waiting writer blocks new readers, so readers can not
+  // starve it.
+  class RWLock
+  {
+    RWLock(const RWLock &);
+    RWLock & operator = (const RWLock &);
+
+  public:
+#if defined(NKIT_WINNT)
+    RWLock()
+    {
+      InitializeSRWLock(&lock_);
+    }
+
+    ~RWLock() {}
+
+    void Lock() { AcquireSRWLockExclusive(&lock_); }
+    void Unlock() { ReleaseSRWLockExclusive(&lock_); }
+    void ReadLock() { AcquireSRWLockShared(&lock_); }
+    void ReadUnlock() { ReleaseSRWLockShared(&lock_); }
+
+  private:
+    SRWLOCK lock_;
+#else
+    RWLock()
+    {
+      pthread_rwlockattr_t attr;
+      pthread_rwlockattr_init(&attr);
+#  if defined(__GLIBC__)
+      // glibc prefers readers by default
+      pthread_rwlockattr_setkind_np(&attr,
+          PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+#  endif
+      int rc = pthread_rwlock_init(&lock_, &attr);
+      pthread_rwlockattr_destroy(&attr);
+      if (unlikely(rc != 0))
+        ::nkit::abort_with_core("pthread_rwlock_init "
+            + std::string(strerror(rc)));
+    }
+
+    ~RWLock()
+    {
+      pthread_rwlock_destroy(&lock_);
+    }
+
+    void Lock()
+    {
+      int rc = pthread_rwlock_wrlock(&lock_);
+      if (unlikely(rc != 0))
+        ::nkit::abort_with_core("pthread_rwlock_wrlock "
+            + std::string(strerror(rc)));
+    }
+
+    void Unlock()
+    {
+      pthread_rwlock_unlock(&lock_);
+    }
+
+    void ReadLock()
+    {
+      int rc = pthread_rwlock_rdlock(&lock_);
+      if (unlikely(rc != 0))
+        ::nkit::abort_with_core("pthread_rwlock_rdlock "
+            + std::string(strerror(rc)));
+    }
+
+    void ReadUnlock()
+    {
+      pthread_rwlock_unlock(&lock_);
+    }
+
+  private:
+    pthread_rwlock_t lock_;
+#endif
+  }; // class RWLock
+
+  template <typename T>
+  class ReadLockGuard
+  {
+  public:
+    explicit ReadLockGuard(T & m)
+      : mutex(m)
+    {
+      mutex.ReadLock();
+    }
+
+    ~ReadLockGuard()
+    {
+      mutex.ReadUnlock();
+    }
+
+  private:
+    T & mutex;
+  }; // class ReadLockGuard
+} // namespace nkit
+
+#endif // __NKIT__THREADING__RW__LOCK__H__
@@ -0,0 +1,82 @@
+/*
+   Copyright 2014 Boris T. Darchiev (boris.darchiev@gmail.com)
+                  Vasiliy Soshnikov (dedok.mad@gmail.com)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef __NKIT__THREADING__SEQ__LOCK__H__
+#define __NKIT__THREADING__SEQ__LOCK__H__
+
+#include <nkit/threading/spin_lock.h>
+
+namespace nkit
+{
+  //----------------------------------------------------------------------------
+  // Sequence lock for small data which is read much more often than
+  // written. Readers never write shared memory and never block writer,
+  // they repeat reading if writer was active:
+  //
+  //   uint32_t seq;
+  //   do
+  //   {
+  //     seq = lock.ReadBegin();
+  //     copy = data;
+  //   } while (lock.ReadRetry(seq));
+  //
+  // Data must be copied by reader as is (no pointers to follow), because
+  // it can be torn while writer changes it. Writers are serialized by
+  // Lock()/Unlock(), so LockGuard<SeqLock> can be used.
+  class SeqLock
+  {
+    SeqLock(const SeqLock &);
+    SeqLock & operator = (const SeqLock &);
+
+  public:
+    SeqLock() : sequence_(0) {}
+
+    void Lock()
+    {
+      writer_.Lock();
+      // odd value - write is in progress
+      detail::atomic_add(&sequence_, uint32_t(1));
+    }
+
+    void Unlock()
+    {
+      detail::atomic_add(&sequence_, uint32_t(1));
+      writer_.Unlock();
+    }
+
+    uint32_t ReadBegin() const
+    {
+      uint32_t step = 0;
+      uint32_t sequence;
+      while ((sequence = detail::atomic_load(&sequence_)) & 1)
+        detail::spin_backoff(&step);
+      return sequence;
+    }
+
+    bool ReadRetry(uint32_t sequence) const
+    {
+      detail::memory_barrier();
+      return detail::atomic_load(&sequence_) != sequence;
+    }
+
+  private:
+    volatile uint32_t sequence_;
+    SpinLock writer_;
+  }; // class SeqLock
+} // namespace nkit
+
+#endif // __NKIT__THREADING__SEQ__LOCK__H__
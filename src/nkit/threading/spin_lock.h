@@ -0,0 +1,100 @@
+/*
+   Copyright 2014 Boris T. Darchiev (boris.darchiev@gmail.com)
+                  Vasiliy Soshnikov (dedok.mad@gmail.com)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef __NKIT__THREADING__SPIN__LOCK__H__
+#define __NKIT__THREADING__SPIN__LOCK__H__
+
+#include <nkit/types.h>
+#include <nkit/mutex.h>
+#include <nkit/detail/atomic.h>
+
+#if defined(NKIT_WINNT)
+#  include <windows.h>
+#else
+#  include <sched.h>
+#endif
+
+namespace nkit
+{
+  namespace detail
+  {
+    // Count of cpu_relax() doublings before thread starts to yield CPU
+    static const uint32_t SPIN_BACKOFF_LIMIT = 6;
+
+    inline void thread_yield()
+    {
+#if defined(NKIT_WINNT)
+      SwitchToThread();
+#else
+      sched_yield();
+#endif
+    }
+
+    // Exponential backoff of waiting thread: 1, 2, 4 ... 64 pauses,
+    // then yielding. 'step' must be 0 before first wait.
+    inline void spin_backoff(uint32_t * step)
+    {
+      if (*step < SPIN_BACKOFF_LIMIT)
+      {
+        for (uint32_t i = 0; i < (uint32_t(1) << *step); ++i)
+          cpu_relax();
+        ++(*step);
+      }
+      else
+        thread_yield();
+    }
+  } // namespace detail
+
+  //----------------------------------------------------------------------------
+  // For short critical sections without system calls. Waiting threads spin
+  // on reading, so lock's cache line is not bounced between CPUs.
+  class SpinLock
+  {
+    SpinLock(const SpinLock &);
+    SpinLock & operator = (const SpinLock &);
+
+  public:
+    SpinLock() : locked_(0) {}
+
+    bool TryLock()
+    {
+      return detail::atomic_load(&locked_) == 0 &&
+          detail::atomic_exchange(&locked_, uint32_t(1)) == 0;
+    }
+
+    void Lock()
+    {
+      uint32_t step = 0;
+      while (!TryLock())
+      {
+        do
+          detail::spin_backoff(&step);
+        while (detail::atomic_load(&locked_) != 0);
+      }
+    }
+
+    void Unlock()
+    {
+      detail::atomic_store(&locked_, uint32_t(0));
+    }
+
+  private:
+    volatile uint32_t locked_;
+  }; // class SpinLock
+} // namespace nkit
+
+#endif // __NKIT__THREADING__SPIN__LOCK__H__
@@ -0,0 +1,281 @@
+/*
+   Copyright 2014 Boris T. Darchiev (boris.darchiev@gmail.com)
+                  Vasiliy Soshnikov (dedok.mad@gmail.com)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef __NKIT__THREADING__THREAD__POOL__H__
+#define __NKIT__THREADING__THREAD__POOL__H__
+
+#include <nkit/types.h>
+#include <nkit/detail/atomic.h>
+#include <nkit/threading/spin_lock.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#if defined(NKIT_WINNT)
+#  include <windows.h>
+#else
+#  include <pthread.h>
+#endif
+
+namespace nkit
+{
+  //----------------------------------------------------------------------------
+  // Unit of work of ThreadPool. Pool does not delete tasks, task may delete
+  // itself at the end of Run(). Run() must not throw.
+  class Task
+  {
+  public:
+    virtual ~Task() {}
+    virtual void Run() = 0;
+  };
+
+  class ThreadPool;
+
+  namespace detail
+  {
+    struct ThreadPoolWorker
+    {
+      ThreadPool * pool_;
+      size_t index_;
+      SpinLock lock_;
+      std::deque<Task *> tasks_; // owner works on back, thieves on front
+#if defined(NKIT_WINNT)
+      HANDLE thread_;
+#else
+      pthread_t thread_;
+#endif
+    };
+
+    size_t cpu_count();
+  } // namespace detail
+
+  //----------------------------------------------------------------------------
+  // Work-stealing pool. Every worker has its own deque: tasks submitted by
+  // worker go to its deque and are taken back in LIFO order, so nested
+  // tasks run while their data is still in cache. Idle workers steal
+  // oldest tasks from other deques, then take tasks submitted by other
+  // threads from shared queue, and sleep when there is nothing to do.
+  class ThreadPool
+  {
+    ThreadPool(const ThreadPool &);
+    ThreadPool & operator = (const ThreadPool &);
+
+  public:
+    typedef NKIT_SHARED_PTR(ThreadPool) Ptr;
+
+    struct Options
+    {
+      Options()
+        : threads(0)
+        , pin_threads(false)
+      {}
+
+      size_t threads;   // count of workers, 0 - count of CPUs
+      bool pin_threads; // worker N is bound to CPU N (Linux and Windows)
+    };
+
+    static Ptr Create(const Options & options = Options(),
+        std::string * error = NULL);
+
+    // Options of process-wide pool, which is used by ParallelFor() and
+    // TaskGroup by default. Returns false if that pool is already started
+    // by first Default() call.
+    static bool Configure(const Options & options, std::string * error = NULL);
+    static ThreadPool & Default();
+
+    // Runs all submitted tasks and stops workers
+    ~ThreadPool();
+
+    size_t size() const { return workers_.size(); }
+
+    void Submit(Task * task);
+
+    // Runs one pending task in calling thread. Used by threads waiting for
+    // tasks, so nested waits do not deadlock. Returns false if there is
+    // nothing to run.
+    bool RunPendingTask();
+
+  private:
+    ThreadPool();
+    bool Start(const Options & options, std::string * error);
+    void Stop(size_t started);
+    Task * TakeTask(detail::ThreadPoolWorker * self);
+    Task * Steal(size_t first);
+    void Sleep();
+    void WakeUp();
+    void Run(detail::ThreadPoolWorker * self);
+
+#if defined(NKIT_WINNT)
+    static DWORD WINAPI ThreadProc(LPVOID arg);
+#else
+    static void * ThreadProc(void * arg);
+#endif
+
+  private:
+    std::vector<detail::ThreadPoolWorker *> workers_;
+    SpinLock shared_lock_;
+    std::deque<Task *> shared_tasks_;
+
+    volatile uint64_t queued_;   // tasks in all queues
+    volatile uint32_t sleepers_;
+    volatile uint32_t stop_;
+
+#if defined(NKIT_WINNT)
+    CRITICAL_SECTION sleep_lock_;
+    CONDITION_VARIABLE wake_up_;
+#else
+    pthread_mutex_t sleep_lock_;
+    pthread_cond_t wake_up_;
+#endif
+  }; // class ThreadPool
+
+  //----------------------------------------------------------------------------
+  // Tasks which are waited together. Waiting thread runs pending tasks of
+  // pool, so groups can be waited inside other tasks.
+  //
+  //   TaskGroup group;
+  //   group.Run(BuildIndex(table, "name"));
+  //   group.Run(BuildIndex(table, "age"));
+  //   group.Wait();
+  class TaskGroup
+  {
+    TaskGroup(const TaskGroup &);
+    TaskGroup & operator = (const TaskGroup &);
+
+    template <typename Func>
+    class FuncTask : public Task
+    {
+    public:
+      FuncTask(const Func & func, TaskGroup * group)
+        : func_(func)
+        , group_(group)
+      {}
+
+      virtual void Run()
+      {
+        func_();
+        TaskGroup * group = group_;
+        delete this;
+        group->Done();
+      }
+
+    private:
+      Func func_;
+      TaskGroup * group_;
+    };
+
+  public:
+    explicit TaskGroup(ThreadPool & pool = ThreadPool::Default())
+      : pool_(pool)
+      , pending_(0)
+    {}
+
+    ~TaskGroup()
+    {
+      Wait();
+    }
+
+    // Copy of 'func' is called as func() by one of pool threads
+    template <typename Func>
+    void Run(const Func & func)
+    {
+      detail::atomic_add(&pending_, uint64_t(1));
+      pool_.Submit(new FuncTask<Func>(func, this));
+    }
+
+    void Wait()
+    {
+      uint32_t step = 0;
+      while (detail::atomic_load(&pending_) != 0)
+      {
+        if (pool_.RunPendingTask())
+          step = 0;
+        else
+          detail::spin_backoff(&step);
+      }
+    }
+
+  private:
+    void Done()
+    {
+      detail::atomic_sub(&pending_, uint64_t(1));
+    }
+
+  private:
+    ThreadPool & pool_;
+    volatile uint64_t pending_;
+  }; // class TaskGroup
+
+  namespace detail
+  {
+    // Splits range in halves till 'grain' and gives right halves to
+    // other threads
+    template <typename Func>
+    class ParallelForTask
+    {
+    public:
+      ParallelForTask(TaskGroup * group, size_t begin, size_t end,
+          size_t grain, const Func * func)
+        : group_(group)
+        , begin_(begin)
+        , end_(end)
+        , grain_(grain)
+        , func_(func)
+      {}
+
+      void operator() () const
+      {
+        size_t end = end_;
+        while (end - begin_ > grain_)
+        {
+          size_t middle = begin_ + (end - begin_) / 2;
+          group_->Run(ParallelForTask(group_, middle, end, grain_, func_));
+          end = middle;
+        }
+        (*func_)(begin_, end);
+      }
+
+    private:
+      TaskGroup * group_;
+      size_t begin_;
+      size_t end_;
+      size_t grain_;
+      const Func * func_;
+    };
+  } // namespace detail
+
+  // Calls func(chunk_begin, chunk_end) for chunks of [begin, end) not longer
+  // than 'grain' in pool threads and calling thread. Returns when all
+  // chunks are done. 'func' is called concurrently, so its operator() is
+  // const.
+  template <typename Func>
+  void ParallelFor(size_t begin, size_t end, size_t grain, const Func & func,
+      ThreadPool & pool = ThreadPool::Default())
+  {
+    if (begin >= end)
+      return;
+    if (grain == 0)
+      grain = 1;
+
+    TaskGroup group(pool);
+    detail::ParallelForTask<Func>(&group, begin, end, grain, &func)();
+    group.Wait();
+  }
+} // namespace nkit
+
+#endif // __NKIT__THREADING__THREAD__POOL__H__
@@ -114,6 +114,30 @@ namespace nkit
 #endif
   std::string string_cast(double v, size_t precision = 2);
 
+  //----------------------------------------------------------------------------
+  // Locale independent number <-> text conversions (src/numeric).
+  // Output buffers must have at least NUMBER_TO_CHARS_BUFFER_SIZE bytes,
+  // result is zero-terminated, returned value is its length.
+  static const size_t NUMBER_TO_CHARS_BUFFER_SIZE = 32;
+  static const size_t DOUBLE_MAX_FAST_PRECISION = 15;
+
+  size_t uint64_to_chars(uint64_t v, char * out);
+  size_t int64_to_chars(int64_t v, char * out);
+
+  // Shortest representation that reads back to the same double
+  // (always has '.' or exponent, e.g. "1.0", "0.1", "1e30")
+  size_t double_to_chars(double v, char * out);
+
+  // Same as printf("%.*f", precision, v). Returns 0 if value can not be
+  // formatted exactly without printf (precision > DOUBLE_MAX_FAST_PRECISION
+  // or too large value)
+  size_t double_to_chars(double v, size_t precision, char * out);
+
+  // Parses [+-]digits[.digits][(e|E)[+-]digits]. Returns false if there are
+  // no digits. 'parsed' receives the count of consumed characters.
+  bool chars_to_double(const char * str, size_t size, double * out,
+      size_t * parsed = NULL);
+
   //----------------------------------------------------------------------------
   inline uint64_t & operator << (uint64_t & uv, const std::string & s)
   {
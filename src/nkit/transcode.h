@@ -24,6 +24,10 @@ namespace nkit
           const std::string & from, std::string * to);
 
   //----------------------------------------------------------------------------
+  // Single byte encoding <-> UTF-8. UTF-8 sequences of all 256 characters
+  // are precomputed, reverse lookup goes through two level table indexed
+  // by UTF-16 code unit. Runs of ASCII characters are copied as a whole
+  // for encodings where they map to themselves.
   class Transcoder
   {
     friend bool transcode(const std::string & enc_from,
@@ -32,10 +36,24 @@ namespace nkit
             std::string * to);
 
   private:
-    typedef std::map<uint16_t, char> SingleUtf16ToCharMap;
     typedef bool (*SPECIAL_CHAR_CALLBACK)(char ch, std::string * out);
 
+    enum
+    {
+      CHARS_COUNT = 0x100,
+      NO_PAGE = 0xFFFF
+    };
+
+    struct Utf8Char
+    {
+      uint8_t size_; // 0 if character has no UTF-8 representation
+      char bytes_[3];
+    };
+
   public:
+    // UTF-8 sequence of single byte character is at most 3 bytes long
+    static const size_t MAX_UTF8_CHAR_SIZE = 3;
+
     Transcoder(const uint16_t * char_to_single_utf16_map);
     static void Build();
     static const Transcoder * Find(const std::string & name);
@@ -45,18 +63,32 @@ namespace nkit
             std::string * out) const;
     bool FromUtf8(const char * src, size_t size, std::string * out) const;
     bool ToUtf8(const std::string & src, std::string * out) const;
+    bool ToUtf8(const char * src, size_t size, std::string * out) const;
+
+    // Bulk conversions into caller provided buffer, which must have room
+    // for 'size' bytes (FromUtf8) or for 'size * MAX_UTF8_CHAR_SIZE' bytes
+    // (ToUtf8). Return false on character which can not be converted,
+    // '*written' is set in any case.
+    bool FromUtf8(const char * src, size_t size, char * out,
+            size_t * written) const;
+    bool ToUtf8(const char * src, size_t size, char * out,
+            size_t * written) const;
 
   private:
     bool Transcode(const std::string & src,
             const Transcoder & out_transcoder,std::string * out) const;
-    bool FromUtf8(const char ** src, size_t * bytes_left,
-            std::string * out) const;
+    bool FromUtf8(const uint8_t ** src, const uint8_t * end, char * out) const;
     void AddMapping(uint16_t single_utf16_c, char c);
     bool GetChar(uint16_t single_utf16_c, char * c) const;
 
   private:
     const uint16_t * char_to_single_utf16_map_;
-    std::vector<SingleUtf16ToCharMap> single_utf16_to_char_hash_table_;
+    Utf8Char to_utf8_[CHARS_COUNT];
+    // high byte of UTF-16 code unit -> page of 256 characters in pages_
+    std::vector<uint16_t> page_index_;
+    // character or -1 if there is no one for UTF-16 code unit
+    std::vector<int16_t> pages_;
+    bool ascii_as_is_;
   };
 
 } // namespace nkit
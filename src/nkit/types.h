@@ -54,6 +54,7 @@
 #  define NKIT_STRNCASECMP  ::strncasecmp
 #  define NKIT_STRPTIME  ::strptime
 #  define NKIT_STRDUP  ::strdup
+#  define NKIT_THREAD_LOCAL __thread
 
 #elif defined(NKIT_WINNT) && defined(HAVE_STD_CXX_11)
 #  include <cstdint>
@@ -102,6 +103,7 @@
 #  define NKIT_STRNCASECMP  ::_strnicmp
 #  define NKIT_STRPTIME  ::nkit::strptime
 #  define NKIT_STRDUP  ::_strdup
+#  define NKIT_THREAD_LOCAL __declspec(thread)
 
 #  define __PRETTY_FUNCTION__ __FUNCTION__
 
@@ -17,9 +17,10 @@
 #ifndef NKIT__XML2VAR__H__
 #define NKIT__XML2VAR__H__
 
-#include <stack>
+#include <algorithm>
 
 #include "nkit/dynamic_getter.h"
+#include "nkit/output_sink.h"
 #include "nkit/transcode.h"
 
 namespace nkit
@@ -147,7 +148,92 @@ namespace nkit
     std::string bool_false_;
   };  // struct Var2XmlOptions
 
+  namespace detail
+  {
+    //--------------------------------------------------------------------------
+    // Bytes of 'x' equal to zero get high bit set (result is non-zero
+    // if and only if 'x' has zero byte)
+    inline uint64_t swar_zero_bytes(uint64_t x)
+    {
+      return (x - 0x0101010101010101ULL) & ~x & 0x8080808080808080ULL;
+    }
+
+    inline bool swar_has_xml_special(uint64_t x)
+    {
+      static const uint64_t ONES = 0x0101010101010101ULL;
+      return (swar_zero_bytes(x ^ (ONES * '<'))
+          | swar_zero_bytes(x ^ (ONES * '>'))
+          | swar_zero_bytes(x ^ (ONES * '&'))
+          | swar_zero_bytes(x ^ (ONES * '"'))
+          | swar_zero_bytes(x ^ (ONES * '\''))) != 0;
+    }
+
+    inline bool is_xml_special(char ch)
+    {
+      return ch == '<' || ch == '>' || ch == '&' || ch == '"' || ch == '\'';
+    }
+
+    // Checks 8 bytes at once while there are no special characters
+    inline const char * find_xml_special(const char * begin, const char * end)
+    {
+      while (end - begin >= 8)
+      {
+        uint64_t word;
+        std::memcpy(&word, begin, sizeof(word));
+        if (swar_has_xml_special(word))
+          break;
+        begin += 8;
+      }
+
+      for (; begin != end; ++begin)
+        if (is_xml_special(*begin))
+          return begin;
+      return end;
+    }
+
+    inline void append_xml_entity(char ch, OutputSink * out)
+    {
+      switch (ch)
+      {
+      case '<':
+        out->append("&lt;", 4);
+        break;
+      case '>':
+        out->append("&gt;", 4);
+        break;
+      case '&':
+        out->append("&amp;", 5);
+        break;
+      case '"':
+        out->append("&quot;", 6);
+        break;
+      default:
+        out->append("&apos;", 6);
+        break;
+      }
+    }
+
+    // Unescaped runs between special characters are copied as a whole
+    inline void append_xml_escaped(const char * text, size_t size,
+        OutputSink * out)
+    {
+      const char * end = text + size;
+      while (text != end)
+      {
+        const char * special = find_xml_special(text, end);
+        out->append(text, static_cast<size_t>(special - text));
+        if (special == end)
+          break;
+        append_xml_entity(*special, out);
+        text = special + 1;
+      }
+    }
+  } // namespace detail
+
   //----------------------------------------------------------------------------
+  // Writes XML into OutputSink, so output of any size is produced with
+  // bounded memory. Element names, indentation and transcoding buffers
+  // are reused between elements.
   template <typename T>
   class Var2XmlConverter
   {
@@ -169,38 +255,50 @@ namespace nkit
     //--------------------------------------------------------------------------
     static bool Process(const Dynamic & options, const DataType & data,
         std::string * out, std::string * error)
+    {
+      OutputSink sink(out);
+      return Process(options, data, &sink, error);
+    }
+
+    //--------------------------------------------------------------------------
+    static bool Process(const std::string & options, const DataType & data,
+        OutputSink * out, std::string * error)
+    {
+      Dynamic op = DynamicFromJson(options, error);
+      if (!op && !error->empty())
+        return false;
+      return Process(op, data, out, error);
+    }
+
+    //--------------------------------------------------------------------------
+    // Sink is flushed on return
+    static bool Process(const Dynamic & options, const DataType & data,
+        OutputSink * out, std::string * error)
     {
       Var2XmlOptions::Ptr op = Var2XmlOptions::Create(options, error);
       if (!op)
         return false;
 
-      Var2XmlConverter builder(op);
-
-      if (T::IsDict(data))
+      if (!T::IsDict(data) && !T::IsList(data) && !T::IsTable(data))
       {
-        if (!op->root_name_.empty())
-          builder.BeginElement(op->root_name_, data, out);
+        *error = "Variable MUST be object (dict), list or table";
+        return false;
+      }
 
-        if (!builder.Convert(op->item_name_, data, builder, out, error))
-          return false;
+      Var2XmlConverter builder(op, out);
 
-        if (!op->root_name_.empty())
-          builder.EndElement(out);
-      }
-      else if (T::IsList(data))
-      {
-        if (!op->root_name_.empty())
-          builder.BeginElement(op->root_name_, data, out);
+      if (!op->root_name_.empty())
+        builder.BeginElement(op->root_name_, data);
 
-        if (!builder.Convert(op->item_name_, data, builder, out, error))
-          return false;
+      if (!builder.Convert(op->item_name_, data, error))
+        return false;
 
-        if (!op->root_name_.empty())
-          builder.EndElement(out);
-      }
-      else
+      if (!op->root_name_.empty())
+        builder.EndElement();
+
+      if (!out->Flush())
       {
-        *error = "Variable MUST be object (dict) or list";
+        *error = out->error();
         return false;
       }
 
@@ -209,68 +307,52 @@ namespace nkit
 
   private:
     //--------------------------------------------------------------------------
-    Var2XmlConverter(Var2XmlOptions::Ptr options)
+    Var2XmlConverter(Var2XmlOptions::Ptr options, OutputSink * out)
       : options_(options)
+      , out_(out)
+      , depth_(0)
       , first_end_after_begin_(false)
       , begin_(true)
     {}
 
     //--------------------------------------------------------------------------
     bool Convert(const std::string & item_name, const DataType & data,
-        Var2XmlConverter & builder, std::string * out, std::string * error)
+        std::string * error)
     {
       if (T::IsDict(data))
       {
         bool dict_is_empty = true;
-//        bool dict_has_attrkey = false;
         StringList::const_iterator pr_it = options_->priority_list_.begin(),
             pr_end = options_->priority_list_.end();
         for (; pr_it != pr_end; ++pr_it)
         {
-          std::string key(*pr_it);
-          if (options_->attr_key_ == key)
-          {
-//            dict_has_attrkey = true;
-            continue;
-          }
-          else if (options_->text_key_ == key)
+          const std::string & key = *pr_it;
+          if (options_->attr_key_ == key || options_->text_key_ == key)
             continue;
           bool found = false;
           DataType v = T::GetByKey(data, key, &found);
           if (found)
           {
             dict_is_empty = false;
-            if (!T::IsList(v))
-              builder.BeginElement(key, v, out);
-            if (!Convert(key, v, builder, out, error))
+            if (!ConvertElement(key, v, error))
               return false;
-            if (!T::IsList(v))
-              builder.EndElement(out);
           }
         }
 
+        bool check_priority = !options_->priority_set_.empty();
         StringSet::const_iterator prset_end = options_->priority_set_.end();
         DictConstIterator it = T::begin_d(data), end = T::end_d(data);
         for (; it != end; ++it)
         {
-          std::string key(T::First(it));
-          if (options_->attr_key_ == key)
-          {
-//            dict_has_attrkey = true;
-            continue;
-          }
-          else if ( options_->text_key_ == key ||
-              (options_->priority_set_.find(key) != prset_end) )
+          const std::string & key = T::First(it);
+          if (options_->attr_key_ == key || options_->text_key_ == key ||
+              (check_priority &&
+                  options_->priority_set_.find(key) != prset_end))
             continue;
 
           dict_is_empty = false;
-          DataType v = T::Second(it);
-          if (!T::IsList(v))
-            builder.BeginElement(key, v, out);
-          if (!Convert(key, v, builder, out, error))
+          if (!ConvertElement(key, T::Second(it), error))
             return false;
-          if (!T::IsList(v))
-            builder.EndElement(out);
         }
 
         // textkey option ('_')
@@ -278,55 +360,270 @@ namespace nkit
         DataType text = T::GetByKey(data, options_->text_key_, &found);
         if (found)
         {
-          bool newline = // dict_has_attrkey ||
-              !dict_is_empty;
-          builder.PutText(text, newline, out);
+          bool newline = !dict_is_empty;
+          PutText(text, newline);
           first_end_after_begin_ = !newline;
         }
       }
       else if (T::IsList(data))
       {
-        bool use_item_name = !item_name.empty();
+        const std::string & name =
+            item_name.empty() ? options_->item_name_ : item_name;
         ListConstIterator it = T::begin_l(data), end = T::end_l(data);
-        for (size_t counter = 0; it != end; ++it, ++counter)
+        for (; it != end; ++it)
         {
-          builder.BeginElement(
-                  use_item_name ? item_name :
-                          options_->item_name_, // + string_cast(counter),
-                  T::Value(it), out);
-          if (!Convert("", T::Value(it), builder, out, error))
+          BeginElement(name, T::Value(it));
+          if (!Convert(S_EMPTY_, T::Value(it), error))
             return false;
-          builder.EndElement(out);
+          EndElement();
         }
       }
+      else if (T::IsTable(data))
+      {
+        return ConvertTable(
+            item_name.empty() ? options_->item_name_ : item_name, data, error);
+      }
       else
       {
-        builder.PutText(data, false, out);
+        PutText(data, false);
+      }
+
+      return true;
+    }
+
+    //--------------------------------------------------------------------------
+    // Table is written as list of dicts: row elements with an element for
+    // each column. Tags and indents of columns are prepared once, scalar
+    // cells are read from table storage without creating Dynamic.
+    bool ConvertTable(const std::string & row_name, const DataType & data,
+        std::string * error)
+    {
+      size_t height = T::GetHeight(data);
+      if (height == 0)
+        return true;
+
+      StringVector names = T::GetColumnNames(data);
+      detail::DynamicTypeVector types = T::GetColumnTypeIds(data);
+      size_t width = names.size(), text_col = width;
+
+      // priority columns first, then others in table order
+      std::vector<size_t> columns;
+      StringList::const_iterator pr_it = options_->priority_list_.begin(),
+          pr_end = options_->priority_list_.end();
+      for (; pr_it != pr_end; ++pr_it)
+      {
+        if (options_->attr_key_ == *pr_it || options_->text_key_ == *pr_it)
+          continue;
+        StringVector::const_iterator name =
+            std::find(names.begin(), names.end(), *pr_it);
+        if (name != names.end())
+          columns.push_back(static_cast<size_t>(name - names.begin()));
+      }
+
+      StringSet::const_iterator prset_end = options_->priority_set_.end();
+      for (size_t col = 0; col < width; ++col)
+      {
+        if (options_->text_key_ == names[col])
+          text_col = col;
+        else if (options_->attr_key_ != names[col] &&
+            options_->priority_set_.find(names[col]) == prset_end)
+          columns.push_back(col);
+      }
+
+      std::string cell_indent(current_indent_ + options_->pretty_.indent_);
+      StringVector begin_tags(width), end_tags(width);
+      std::vector<bool> cdata(width);
+      for (size_t col = 0; col < width; ++col)
+      {
+        std::string name;
+        if (options_->transcoder_)
+          options_->transcoder_->FromUtf8(names[col], &name);
+        else
+          name = names[col];
+        begin_tags[col] = options_->pretty_.newline_ + cell_indent +
+            "<" + name + ">";
+        end_tags[col] = "</" + name + ">";
+        cdata[col] = IsCdata(names[col]);
+      }
+
+      size_t columns_count = columns.size();
+      for (size_t row = 0; row < height; ++row)
+      {
+        BeginElement(row_name, data);
+        const detail::Data * cells = T::GetRowData(data, row);
+        for (size_t i = 0; i < columns_count; ++i)
+        {
+          size_t col = columns[i];
+          if (!IsScalarCell(types[col]))
+          {
+            if (!ConvertElement(names[col], T::GetCellValue(data, row, col),
+                error))
+              return false;
+            continue;
+          }
+          out_->append(begin_tags[col]);
+          PutCell(types[col], cells[col], cdata[col]);
+          out_->append(end_tags[col]);
+          first_end_after_begin_ = false;
+        }
+
+        if (text_col != width)
+        {
+          if (!IsScalarCell(types[text_col]))
+            PutText(T::GetCellValue(data, row, text_col), columns_count != 0);
+          else
+          {
+            if (columns_count != 0 && !IsEmptyCell(types[text_col],
+                cells[text_col]))
+            {
+              out_->append(options_->pretty_.newline_);
+              out_->append(current_indent_);
+            }
+            PutCell(types[text_col], cells[text_col], cdata[text_col]);
+          }
+          first_end_after_begin_ = columns_count == 0;
+        }
+
+        EndElement();
       }
 
       return true;
     }
 
     //--------------------------------------------------------------------------
-    void BeginElement(const std::string & name, const DataType & data,
-        std::string * out)
+    static bool IsScalarCell(uint64_t type)
+    {
+      switch (type)
+      {
+      case detail::BOOL:
+      case detail::INTEGER:
+      case detail::UNSIGNED_INTEGER:
+      case detail::FLOAT:
+      case detail::STRING:
+      case detail::DATE_TIME:
+        return true;
+      default:
+        return false;
+      }
+    }
+
+    static bool IsEmptyCell(uint64_t type, const detail::Data & cell)
+    {
+      return type == detail::STRING &&
+          detail::SharedString::Get(cell)->GetRef().empty();
+    }
+
+    //--------------------------------------------------------------------------
+    void PutCell(uint64_t type, const detail::Data & cell, bool cdata)
+    {
+      char tmp[NUMBER_TO_CHARS_BUFFER_SIZE];
+      size_t size = 0;
+      switch (type)
+      {
+      case detail::STRING:
+        PutCellText(detail::SharedString::Get(cell)->GetRef(), cdata);
+        return;
+      case detail::BOOL:
+        PutCellText(cell.i64_ != 0 ?
+            options_->bool_true_ : options_->bool_false_, cdata);
+        return;
+      case detail::DATE_TIME:
+      {
+        const size_t BUFFER_SIZE = 1024;
+        char buffer[BUFFER_SIZE];
+        size = detail::Impl<detail::DATE_TIME>::Format(cell,
+            options_->date_time_format_.c_str(), buffer, BUFFER_SIZE);
+        if (cdata || options_->transcoder_)
+          PutCellText(std::string(buffer, size), cdata);
+        else
+          detail::append_xml_escaped(buffer, size, out_);
+        return;
+      }
+      case detail::INTEGER:
+        size = int64_to_chars(cell.i64_, tmp);
+        break;
+      case detail::UNSIGNED_INTEGER:
+        size = uint64_to_chars(cell.ui64_, tmp);
+        break;
+      case detail::FLOAT:
+        size = double_to_chars(cell.f_, options_->float_precision_, tmp);
+        if (size == 0)
+        {
+          PutCellText(string_cast(cell.f_, options_->float_precision_),
+              cdata);
+          return;
+        }
+        break;
+      default:
+        return;
+      }
+
+      // numbers have only ASCII characters, which need no escaping
+      if (cdata)
+        PutCellText(std::string(tmp, size), cdata);
+      else
+        out_->append(tmp, size);
+    }
+
+    void PutCellText(const std::string & text, bool cdata)
+    {
+      if (text.empty())
+        return;
+      if (cdata)
+        PutCdata(text);
+      else
+        PutText(text);
+    }
+
+    //--------------------------------------------------------------------------
+    bool IsCdata(const std::string & name) const
+    {
+      if (options_->cdata_.empty())
+        return false;
+      bool found = options_->cdata_.find(name) != options_->cdata_.end();
+      return found != options_->cdata_exclude_;
+    }
+
+    //--------------------------------------------------------------------------
+    bool ConvertElement(const std::string & key, const DataType & v,
+        std::string * error)
+    {
+      bool is_list = T::IsList(v) || T::IsTable(v);
+      if (!is_list)
+        BeginElement(key, v);
+      if (!Convert(key, v, error))
+        return false;
+      if (!is_list)
+        EndElement();
+      return true;
+    }
+
+    //--------------------------------------------------------------------------
+    void BeginElement(const std::string & name, const DataType & data)
     {
       if (begin_)
       {
         begin_ = false;
         if (!options_->xml_dec_.empty() && !options_->root_name_.empty())
         {
-          out->append(options_->xml_dec_);
-          out->append(options_->pretty_.newline_);
+          out_->append(options_->xml_dec_);
+          out_->append(options_->pretty_.newline_);
         }
       }
       else
-        out->append(options_->pretty_.newline_);
+        out_->append(options_->pretty_.newline_);
 
-      path_.push(name);
-      out->append(current_indent_);
-      out->append("<");
-      AppendTranscoded(name, out);
+      // strings of path are reused, so they do not allocate memory
+      // after first elements of such depth
+      if (depth_ == path_.size())
+        path_.push_back(name);
+      else
+        path_[depth_].assign(name);
+      ++depth_;
+
+      out_->append(current_indent_);
+      out_->push_back('<');
+      AppendTranscoded(name.data(), name.size());
 
       // attrkey option ('$')
       if (T::IsDict(data))
@@ -338,139 +635,121 @@ namespace nkit
           DictConstIterator pair = T::begin_d(attrs), end = T::end_d(attrs);
           for (; pair != end; ++pair)
           {
-            (*out) += ' ';
-            AppendTranscoded(T::First(pair), out);
-            out->append("=\"");
-            PutText(T::Second(pair), out);
-            (*out) += '\"';
+            out_->push_back(' ');
+            const std::string & attr_name = T::First(pair);
+            AppendTranscoded(attr_name.data(), attr_name.size());
+            out_->append("=\"", 2);
+            PutText(T::Second(pair));
+            out_->push_back('\"');
           }
         }
       }
 
-      out->append(">");
+      out_->push_back('>');
       current_indent_ += options_->pretty_.indent_;
       first_end_after_begin_ = true;
     }
 
     //--------------------------------------------------------------------------
-    void EndElement(std::string * out)
+    void EndElement()
     {
-      assert(!path_.empty());
+      assert(depth_ > 0);
 
       current_indent_.resize(
           current_indent_.size() - options_->pretty_.indent_.size());
       if (!first_end_after_begin_)
       {
-        out->append(options_->pretty_.newline_);
-        out->append(current_indent_);
+        out_->append(options_->pretty_.newline_);
+        out_->append(current_indent_);
       }
       first_end_after_begin_ = false;
-      out->append("</");
-      AppendTranscoded(path_.top(), out);
-      out->append(">");
-      path_.pop();
+      out_->append("</", 2);
+      const std::string & name = path_[--depth_];
+      AppendTranscoded(name.data(), name.size());
+      out_->push_back('>');
     }
 
     //--------------------------------------------------------------------------
-    void AppendTranscoded(const std::string & text, std::string * out)
+    void AppendTranscoded(const char * text, size_t len)
     {
       if (options_->transcoder_)
-        options_->transcoder_->FromUtf8(text, out);
-      else
-        out->append(text);
-    }
-
-    //--------------------------------------------------------------------------
-    void AppendTranscoded(const char * text, size_t len, std::string * out)
-    {
-      if (options_->transcoder_)
-        options_->transcoder_->FromUtf8(text, len, out);
+      {
+        transcoded_.clear();
+        options_->transcoder_->FromUtf8(text, len, &transcoded_);
+        out_->append(transcoded_);
+      }
       else
-        out->append(text, len);
+        out_->append(text, len);
     }
 
     //--------------------------------------------------------------------------
-    void PutText(const DataType & data, bool newline, std::string * out)
+    void PutText(const DataType & data, bool newline)
     {
-      // TODO: optimize by member string
-      if (T::IsDateTime(data))
+      if (T::IsString(data))
+        PutText(T::GetConstString(data), newline);
+      else if (T::IsDateTime(data))
         PutText(T::GetStringAsDateTime(data, options_->date_time_format_),
-                newline, out);
+                newline);
       else if (T::IsFloat(data))
         PutText(T::GetStringAsFloat(data, options_->float_precision_),
-                newline, out);
+                newline);
       else if (T::IsBool(data))
         PutText(T::GetStringAsBool(data,
                   options_->bool_true_,
                   options_->bool_false_),
-                newline, out);
+                newline);
       else
-        PutText(T::GetString(data), newline, out);
+        PutText(T::GetString(data), newline);
     }
 
     //--------------------------------------------------------------------------
-    void PutText(const DataType & data, std::string * out)
+    void PutText(const DataType & data)
     {
-      // TODO: optimize by member string
-      if (T::IsDateTime(data))
-        PutText(T::GetStringAsDateTime(data, options_->date_time_format_), out);
+      if (T::IsString(data))
+        PutText(T::GetConstString(data));
+      else if (T::IsDateTime(data))
+        PutText(T::GetStringAsDateTime(data, options_->date_time_format_));
       else if (T::IsFloat(data))
-        PutText(T::GetStringAsFloat(data, options_->float_precision_), out);
+        PutText(T::GetStringAsFloat(data, options_->float_precision_));
       else if (T::IsBool(data))
         PutText(T::GetStringAsBool(data,
                   options_->bool_true_,
-                  options_->bool_false_),
-                out);
+                  options_->bool_false_));
       else
-        PutText(T::GetString(data), out);
+        PutText(T::GetString(data));
     }
 
     //--------------------------------------------------------------------------
-    void PutText(const std::string & text, bool newline, std::string * out)
+    void PutText(const std::string & text, bool newline)
     {
       if (text.empty())
         return;
 
       if (newline)
       {
-        out->append(options_->pretty_.newline_);
-        out->append(current_indent_);
+        out_->append(options_->pretty_.newline_);
+        out_->append(current_indent_);
       }
 
-      if (options_->cdata_.empty())
-      {
-        PutText(text, out);
-      }
+      if (!options_->cdata_.empty() &&
+          IsCdata(depth_ > 0 ? path_[depth_ - 1] : S_EMPTY_))
+        PutCdata(text);
       else
-      {
-        bool found = !path_.empty() &&
-                options_->cdata_.find(path_.top()) != options_->cdata_.end();
-        if (( found && !options_->cdata_exclude_) ||
-            (!found &&  options_->cdata_exclude_))
-          PutCdata(text, out);
-        else
-          PutText(text, out);
-      }
+        PutText(text);
     }
 
     //--------------------------------------------------------------------------
-    void PutText(const std::string & text, std::string * out)
+    void PutText(const std::string & text)
     {
       if (options_->transcoder_)
       {
-        options_->transcoder_->FromUtf8(text, SpetialCharCallback, out);
+        transcoded_.clear();
+        options_->transcoder_->FromUtf8(text, SpetialCharCallback,
+            &transcoded_);
+        out_->append(transcoded_);
       }
       else
-      {
-        size_t count = text.size();
-        for (size_t i=0; i < count; ++i)
-        {
-          char ch = text[i];
-          if (SpetialCharCallback(ch, out))
-            continue;
-          (*out) += ch;
-        }
-      }
+        detail::append_xml_escaped(text.data(), text.size(), out_);
     }
 
     static bool SpetialCharCallback(char ch, std::string * out)
@@ -499,9 +778,9 @@ namespace nkit
     }
 
     //--------------------------------------------------------------------------
-    void PutCdata(const std::string & cdata, std::string * out)
+    void PutCdata(const std::string & cdata)
     {
-      out->append(S_CDATA_BEGIN_);
+      out_->append(S_CDATA_BEGIN_);
 
       size_t total = cdata.size();
       size_t b_len = S_CDATA_BEGIN_.size();
@@ -535,16 +814,16 @@ namespace nkit
             (cdata[i+8] == b_8)
             )
         {
-          AppendTranscoded(&cdata.at(first), len, out);
+          AppendTranscoded(cdata.data() + first, len);
           i += b_len;
           first = i;
           --i; // compensate increment in 'for' statement
           len = 0;
           rest -= (b_len-1);
-          out->append("<![");
-          out->append(S_CDATA_END_);
-          out->append(S_CDATA_BEGIN_);
-          out->append("CDATA[");
+          out_->append("<![");
+          out_->append(S_CDATA_END_);
+          out_->append(S_CDATA_BEGIN_);
+          out_->append("CDATA[");
         }
         else if ((rest >= e_len) &&
             (cdata[i] == e_0) &&
@@ -552,31 +831,34 @@ namespace nkit
             (cdata[i+2] == e_2)
             )
         {
-          AppendTranscoded(&cdata.at(first), len, out);
+          AppendTranscoded(cdata.data() + first, len);
           i += e_len;
           first = i;
           --i; // compensate increment in 'for' statement
           len = 0;
           rest -= (e_len-1);
-          out->append("]]");
-          out->append(S_CDATA_END_);
-          out->append(S_CDATA_BEGIN_);
-          out->append(">");
+          out_->append("]]");
+          out_->append(S_CDATA_END_);
+          out_->append(S_CDATA_BEGIN_);
+          out_->append(">");
         }
         else
           ++len;
       }
 
       if (len)
-        AppendTranscoded(&cdata.at(first), len, out);
+        AppendTranscoded(cdata.data() + first, len);
 
-      out->append(S_CDATA_END_);
+      out_->append(S_CDATA_END_);
     }
 
   private:
     Var2XmlOptions::Ptr options_;
-    std::stack<std::string> path_;
+    OutputSink * out_;
+    std::vector<std::string> path_;
+    size_t depth_;
     std::string current_indent_;
+    std::string transcoded_;
     bool first_end_after_begin_;
     bool begin_;
   };  // Var2XmlConverter
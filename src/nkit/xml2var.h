@@ -145,6 +145,22 @@ namespace nkit
       p_.InitAsUndefined();
     }
 
+    // Drops all values held by builder
+    void Release()
+    {
+      p_.InitAsUndefined();
+      if (attr_bulder_)
+        attr_bulder_->InitAsUndefined();
+      if (string_bulder_)
+        string_bulder_->InitAsUndefined();
+    }
+
+    // Makes value safe to be shared by results, passed to other threads
+    void Freeze()
+    {
+      p_.Freeze();
+    }
+
     static const type & GetUndefined()
     {
       return Policy::GetUndefined();
@@ -182,6 +198,22 @@ namespace nkit
       p_.InitAsDict();
     }
 
+    bool InitAsTable(const StringVector & table_def, std::string * error)
+    {
+      return p_.InitAsTable(table_def, error);
+    }
+
+    // Fills 'row' with default values of table columns
+    void InitTableRow(std::vector<type> * row) const
+    {
+      p_.InitTableRow(row);
+    }
+
+    bool AppendToTable(std::vector<type> & row)
+    {
+      return p_.AppendToTable(row);
+    }
+
     void SetAttrKey(const char ** attrs)
     {
       if (!options_.attrkey_.empty() && attrs[0])
@@ -428,6 +460,12 @@ namespace nkit
     virtual void OnText(const char * text, size_t len) = 0;
     virtual void Clear() = 0;
 
+    // Drops values and per-document state
+    virtual void Release()
+    {
+      var_builder_.Release();
+    }
+
     virtual void PutTargetItem(
         NKIT_SHARED_PTR(TargetItem<T>) NKIT_UNUSED(target_item))
     {}
@@ -454,7 +492,13 @@ namespace nkit
     void SetOrInsertTo(const char * key_name,
         Target * parent_target) const
     {
-      parent_target->var_builder_.SetDictKeyValue(key_name, var());
+      parent_target->SetChildValue(this, key_name);
+    }
+
+    // Called by completed child target to pass its value to parent
+    virtual void SetChildValue(const Target * child, const char * key_name)
+    {
+      var_builder_.SetDictKeyValue(key_name, child->var());
     }
 
     void AppendTo(T & var_builder) const
@@ -550,6 +594,11 @@ namespace nkit
       target_->Clear();
     }
 
+    void Release()
+    {
+      target_->Release();
+    }
+
     void OnEnter(const char ** attrs)
     {
       target_->OnEnter(attrs);
@@ -730,6 +779,9 @@ namespace nkit
       return Ptr(new ListTarget<T>(options));
     }
 
+    typedef void (*RecordHandler)(typename T::type const & record,
+        void * context);
+
     ~ListTarget() {}
 
     void PutTargetItem(TargetItemPtr target_item)
@@ -738,9 +790,18 @@ namespace nkit
       target_item->SetParentTarget(this);
     }
 
+    // Items are passed to callback instead of being appended to the list
+    void SetRecordHandler(RecordHandler handler, void * context)
+    {
+      handler_ = handler;
+      context_ = context;
+    }
+
   private:
     ListTarget(const detail::Options::Ptr & options)
       : Target<T>(options)
+      , handler_(NULL)
+      , context_(NULL)
     {
       Clear();
     }
@@ -771,7 +832,10 @@ namespace nkit
       for (; it != end; ++it)
       {
         TargetItemPtr target_item = (*it);
-        target_item->AppendTo(Target<T>::var_builder_);
+        if (handler_)
+          handler_(target_item->target()->var(), context_);
+        else
+          target_item->AppendTo(Target<T>::var_builder_);
         target_item->Clear();
       }
     }
@@ -785,6 +849,95 @@ namespace nkit
 
   private:
     TargetItemVector target_items_;
+    RecordHandler handler_;
+    void * context_;
+  };
+
+  //----------------------------------------------------------------------------
+  // Fills table row by row: columns are scalar child targets, their values
+  // are put to the row directly, without intermediate dict.
+  template<typename T>
+  class TableTarget: public Target<T>
+  {
+  public:
+    typedef NKIT_SHARED_PTR(TableTarget<T>) Ptr;
+    typedef typename TargetItem<T>::Ptr TargetItemPtr;
+    typedef typename TargetItem<T>::Vector TargetItemVector;
+    typedef std::vector<typename T::type> Row;
+
+    static Ptr Create(const detail::Options::Ptr & options,
+        const StringVector & table_def, std::string * error)
+    {
+      Ptr ret(new TableTarget<T>(options, table_def));
+      if (!ret->var_builder_.InitAsTable(table_def, error))
+        return Ptr();
+      return ret;
+    }
+
+    ~TableTarget() {}
+
+    // Target items must be put in the order of table columns
+    void PutTargetItem(TargetItemPtr target_item)
+    {
+      target_items_.push_back(target_item);
+      target_item->SetParentTarget(this);
+    }
+
+  private:
+    TableTarget(const detail::Options::Ptr & options,
+        const StringVector & table_def)
+      : Target<T>(options)
+      , table_def_(table_def)
+    {}
+
+    void OnEnter(const char ** NKIT_UNUSED(attrs))
+    {
+      Target<T>::var_builder_.InitTableRow(&row_);
+    }
+
+    void OnExit(const char * NKIT_UNUSED(el))
+    {
+      for (size_t i = 0; i < target_items_.size(); ++i)
+      {
+        const TargetItemPtr & target_item = target_items_[i];
+        if (target_item->must_use_default_value())
+          row_[i] = target_item->target()->var();
+        target_item->Clear();
+      }
+      Target<T>::var_builder_.AppendToTable(row_);
+    }
+
+    void OnText(const char *, size_t) {}
+
+    void SetChildValue(const Target<T> * child,
+        const char * NKIT_UNUSED(key_name))
+    {
+      for (size_t i = 0; i < target_items_.size(); ++i)
+      {
+        if (target_items_[i]->target().get() == child)
+        {
+          row_[i] = child->var();
+          return;
+        }
+      }
+    }
+
+    void Clear()
+    {
+      std::string error;
+      Target<T>::var_builder_.InitAsTable(table_def_, &error);
+    }
+
+    void Release()
+    {
+      Target<T>::Release();
+      row_.clear();
+    }
+
+  private:
+    StringVector table_def_;
+    TargetItemVector target_items_;
+    Row row_;
   };
 
   //----------------------------------------------------------------------------
@@ -847,6 +1000,7 @@ namespace nkit
         (default_value_.*InitByString)(*p_default_value);
       else
         (default_value_.*InitByStringWithFormat)(*p_default_value, format_);
+      default_value_.Freeze();
     }
 
     ScalarTarget(const detail::Options::Ptr & options,
@@ -859,6 +1013,7 @@ namespace nkit
     {
       Init();
       (default_value_.*InitByString)(default_value);
+      default_value_.Freeze();
     }
 
     ScalarTarget(const detail::Options::Ptr & options)
@@ -909,6 +1064,12 @@ namespace nkit
       use_default_value_ = true;
     }
 
+    void Release()
+    {
+      Target<T>::Release();
+      Clear();
+    }
+
     virtual bool must_use_default_value() const
     {
       return has_default_value_ && use_default_value_;
@@ -994,6 +1155,19 @@ namespace nkit
         (*target_item)->OnText(text, len);
     }
 
+    // Calls 'method' of target items of this node and all its descendants
+    void ForEachTargetItem(void (TargetItem<T>::*method)())
+    {
+      Iterator target_item = target_items_.begin(), end = target_items_.end();
+      for (; target_item != end; ++target_item)
+        ((**target_item).*method)();
+
+      typename std::vector<Ptr>::iterator child = children_.begin(),
+          children_end = children_.end();
+      for (; child != children_end; ++child)
+        (*child)->ForEachTargetItem(method);
+    }
+
     void PutTargetItem(TargetItemPtr const & target_item)
     {
       PathNode<T> * current = this;
@@ -1067,6 +1241,133 @@ namespace nkit
     TargetItemVector target_items_;
   };
 
+  //---------------------------------------------------------------------------
+  // Deterministic automaton over element ids for mask ('*') target items.
+  // State is a set of mask target items, which path prefix matches current
+  // path. States and transitions are built lazily and cached, so each XML
+  // event costs one table lookup plus the number of matching target items.
+  template<typename T>
+  class MaskAutomaton: Uncopyable
+  {
+  public:
+    typedef typename TargetItem<T>::Ptr TargetItemPtr;
+    typedef typename TargetItem<T>::Vector TargetItemVector;
+    typedef std::vector<TargetItem<T> *> Matches;
+
+    enum
+    {
+      DEAD_STATE = 0,
+      ROOT_STATE = 1
+    };
+
+  public:
+    MaskAutomaton(const TargetItemVector & target_items)
+      : target_items_(target_items)
+    {
+      Reset();
+    }
+
+    // Must be called after target items have been changed
+    void Reset()
+    {
+      states_.clear();
+      state_index_.clear();
+      states_.push_back(State(0));
+      std::vector<uint32_t> all;
+      for (size_t i = 0; i < target_items_.size(); ++i)
+        all.push_back(static_cast<uint32_t>(i));
+      AddState(0, all);
+    }
+
+    uint32_t Next(uint32_t state, size_t element_id)
+    {
+      if (state == DEAD_STATE)
+        return DEAD_STATE;
+      std::vector<uint32_t> & next = states_[state].next_;
+      if (element_id < next.size() && next[element_id] != NO_STATE)
+        return next[element_id];
+      uint32_t result = BuildNext(state, element_id);
+      std::vector<uint32_t> & next_again = states_[state].next_;
+      if (element_id >= next_again.size())
+        next_again.resize(element_id + 1, NO_STATE);
+      next_again[element_id] = result;
+      return result;
+    }
+
+    const Matches & matches(uint32_t state) const
+    {
+      return states_[state].matches_;
+    }
+
+  private:
+    enum { NO_STATE = 0xFFFFFFFFu };
+
+    struct State
+    {
+      explicit State(size_t depth) : depth_(depth) {}
+
+      size_t depth_;
+      // target items with prefix matched by path of 'depth_' elements
+      std::vector<uint32_t> items_;
+      // target items with path fully matched
+      Matches matches_;
+      // element id -> state
+      std::vector<uint32_t> next_;
+    };
+
+    typedef std::pair<size_t, std::vector<uint32_t> > StateKey;
+    typedef std::map<StateKey, uint32_t> StateIndex;
+
+    uint32_t BuildNext(uint32_t state, size_t element_id)
+    {
+      size_t depth = states_[state].depth_;
+      std::vector<uint32_t> items;
+      std::vector<uint32_t>::const_iterator it = states_[state].items_.begin(),
+          end = states_[state].items_.end();
+      for (; it != end; ++it)
+      {
+        const std::vector<size_t> & elements =
+            target_items_[*it]->fool_path().elements();
+        if (elements.size() > depth
+            && (elements[depth] == element_id
+                || elements[depth] == String2IdMap::STAR_ID))
+          items.push_back(*it);
+      }
+
+      if (items.empty())
+        return DEAD_STATE;
+
+      StateKey key(depth + 1, items);
+      typename StateIndex::const_iterator found = state_index_.find(key);
+      if (found != state_index_.end())
+        return found->second;
+      return AddState(depth + 1, items);
+    }
+
+    uint32_t AddState(size_t depth, const std::vector<uint32_t> & items)
+    {
+      uint32_t id = static_cast<uint32_t>(states_.size());
+      states_.push_back(State(depth));
+      State & state = states_.back();
+      state.items_ = items;
+      std::vector<uint32_t>::const_iterator it = items.begin(),
+          end = items.end();
+      for (; it != end; ++it)
+      {
+        TargetItem<T> * target_item = target_items_[*it].get();
+        if (target_item->fool_path().size() == depth)
+          state.matches_.push_back(target_item);
+      }
+      state_index_[StateKey(depth, items)] = id;
+      return id;
+    }
+
+  private:
+    const TargetItemVector & target_items_;
+    std::vector<State> states_;
+    StateIndex state_index_;
+  };
+
   //----------------------------------------------------------------------------
   template <typename T>
   class StructXml2VarBuilder: public ExpatParser<StructXml2VarBuilder<T> >
@@ -1079,6 +1380,8 @@ namespace nkit
     typedef typename TargetItem<T>::Vector TargetItemVector;
     typedef typename TargetItemVector::iterator TargetItemVectorIterator;
     typedef std::map<std::string, TargetPtr> RootTargets;
+    typedef typename MaskAutomaton<T>::Matches MaskMatches;
+    typedef typename MaskMatches::const_iterator MaskMatchesIterator;
 
   public:
     typedef NKIT_SHARED_PTR(StructXml2VarBuilder<T>) Ptr;
@@ -1121,6 +1424,12 @@ namespace nkit
       return Ptr(new StructXml2VarBuilder<T>(o));
     }
 
+    // Options are not modified by builder, so they may be shared
+    static Ptr Create(const detail::Options::Ptr & options)
+    {
+      return Ptr(new StructXml2VarBuilder<T>(options));
+    }
+
     bool AddMapping(const std::string & target_name,
         const std::string & mapping, std::string * error)
     {
@@ -1142,11 +1451,56 @@ namespace nkit
       if (!root_target)
         return false;
       root_targets_[target_name] = root_target;
+      mask_automaton_.Reset();
+      return true;
+    }
+
+    // Returns false to stop parsing
+    typedef bool (*RecordCallback)(typename T::type const & record,
+        void * context);
+
+    // Record-at-a-time mode: items of root list mapping 'target_name' are
+    // passed to 'callback' one by one as soon as they are complete and are
+    // not accumulated, so memory usage does not depend on their number.
+    // If callback returns false, parsing stops with error.
+    bool SetRecordCallback(const std::string & target_name,
+        RecordCallback callback, void * context, std::string * error)
+    {
+      typename RootTargets::const_iterator found =
+          root_targets_.find(target_name);
+      ListTarget<T> * list_target = found == root_targets_.end() ? NULL :
+          dynamic_cast<ListTarget<T> *>(found->second.get());
+      if (!list_target)
+      {
+        *error = "Record callback requires list mapping, but '"
+            + target_name + "' is not";
+        return false;
+      }
+
+      RecordSink & sink = record_sinks_[target_name];
+      sink.callback_ = callback;
+      sink.context_ = context;
+      sink.builder_ = this;
+      list_target->SetRecordHandler(&StructXml2VarBuilder::OnRecord, &sink);
       return true;
     }
 
     ~StructXml2VarBuilder() {}
 
+    // Prepares builder for the next document: mappings, element ids and
+    // expat parser are kept, results and state of the previous document
+    // are dropped. Targets are re-initialized at the next root element.
+    void Clear()
+    {
+      error_.clear();
+      current_node_ = path_tree_.get();
+      first_node_ = true;
+      stopped_ = false;
+      mask_states_.clear();
+      ForEachTargetItem(&TargetItem<T>::Release);
+      cleared_ = true;
+    }
+
     StringList mapping_names() const
     {
       StringList ret;
@@ -1169,6 +1523,15 @@ namespace nkit
     }
 
   private:
+    struct RecordSink
+    {
+      RecordCallback callback_;
+      void * context_;
+      StructXml2VarBuilder * builder_;
+    };
+
+    typedef std::map<std::string, RecordSink> RecordSinks;
+
     StructXml2VarBuilder(detail::Options::Ptr o)
       : path_tree_(PathNode<T>::CreateRoot())
       , current_node_(path_tree_.get())
@@ -1177,31 +1540,62 @@ namespace nkit
       , first_node_(true)
       , str2id_()
       , mask_target_items_()
+      , mask_automaton_(mask_target_items_)
+      , stopped_(false)
+      , cleared_(false)
     {}
 
+    void ForEachTargetItem(void (TargetItem<T>::*method)())
+    {
+      path_tree_->ForEachTargetItem(method);
+      TargetItemVectorIterator it = mask_target_items_.begin(),
+          end = mask_target_items_.end();
+      for (; it != end; ++it)
+        ((**it).*method)();
+    }
+
+    static void OnRecord(typename T::type const & record, void * context)
+    {
+      RecordSink * sink = static_cast<RecordSink *>(context);
+      if (!sink->callback_(record, sink->context_))
+      {
+        sink->builder_->error_ = "Parsing has been stopped by record callback";
+        sink->builder_->stopped_ = true;
+      }
+    }
+
     bool OnStartElement(const char * el, const char ** attrs)
     {
       size_t element_id = str2id_.GetId(el);
 
+      // Every element pushes one state of mask automaton, root element
+      // gets root state, and OnEndElement() pops it
       if (first_node_)
       {
         first_node_ = false;
+        if (cleared_)
+        {
+          cleared_ = false;
+          ForEachTargetItem(&TargetItem<T>::Clear);
+        }
+        if (!mask_target_items_.empty())
+        {
+          assert(mask_states_.empty());
+          mask_states_.push_back(MaskAutomaton<T>::ROOT_STATE);
+        }
         return true;
       }
 
-      current_path_ /= element_id;
       PathNode<T>::MoveToChild(&current_node_, element_id);
 
       if (!mask_target_items_.empty())
       {
-        TargetItemVectorIterator it = mask_target_items_.begin(),
-            end = mask_target_items_.end();
+        uint32_t state = mask_automaton_.Next(mask_states_.back(), element_id);
+        mask_states_.push_back(state);
+        const MaskMatches & matches = mask_automaton_.matches(state);
+        MaskMatchesIterator it = matches.begin(), end = matches.end();
         for (; it != end; ++it)
-        {
-          TargetItemPtr mask_target_item = (*it);
-          if (mask_target_item->fool_path() == current_path_)
-            mask_target_item->OnEnter(attrs);
-        }
+          (*it)->OnEnter(attrs);
       }
 
       current_node_->OnEnter(attrs);
@@ -1212,20 +1606,18 @@ namespace nkit
     {
       if (!mask_target_items_.empty())
       {
-        TargetItemVectorIterator it = mask_target_items_.begin(),
-            end = mask_target_items_.end();
+        assert(!mask_states_.empty());
+        const MaskMatches & matches =
+            mask_automaton_.matches(mask_states_.back());
+        MaskMatchesIterator it = matches.begin(), end = matches.end();
         for (; it != end; ++it)
-        {
-          TargetItemPtr mask_target_item = (*it);
-          if (mask_target_item->fool_path() == current_path_)
-            mask_target_item->OnExit(el);
-        }
+          (*it)->OnExit(el);
+        mask_states_.pop_back();
       }
 
       current_node_->OnExit(el);
-      current_path_.BubbleUp();
       PathNode<T>::MoveToParent(&current_node_);
-      return true;
+      return !stopped_;
     }
 
     bool OnText(const char * text, int len)
@@ -1234,14 +1626,11 @@ namespace nkit
 
       if (!mask_target_items_.empty())
       {
-        TargetItemVectorIterator it = mask_target_items_.begin(),
-            end = mask_target_items_.end();
+        const MaskMatches & matches =
+            mask_automaton_.matches(mask_states_.back());
+        MaskMatchesIterator it = matches.begin(), end = matches.end();
         for (; it != end; ++it)
-        {
-          TargetItemPtr mask_target_item = (*it);
-          if (mask_target_item->fool_path() == current_path_)
-            mask_target_item->OnText(text, static_cast<size_t>(len));
-        }
+          (*it)->OnText(text, static_cast<size_t>(len));
       }
 
       return true;
@@ -1387,6 +1776,10 @@ namespace nkit
         std::string * error)
     {
       size_t count = mapping.size();
+      if (count == 3)
+        return ParseTableTargetSpec(parent_target, parent_path, mapping,
+            options, path_tree, mask_target_items, str2id, error);
+
       if (count != 2)
       {
         *error = "List mapping must have two elements: "
@@ -1422,6 +1815,133 @@ namespace nkit
       return target_item;
     }
 
+    //--------------------------------------------------------------------------
+    // Table column type for scalar type definition, empty if not supported
+    static const std::string & TableColumnType(const std::string & mapping)
+    {
+      static const std::string STRING_TYPE = "string";
+      static const std::string INTEGER_TYPE = "integer";
+      static const std::string NUMBER_TYPE = "number";
+      static const std::string DATETIME_TYPE = "datetime";
+      static const std::string BOOLEAN_TYPE = "boolean";
+      static const std::string STRING_COLUMN = "STRING";
+      static const std::string INTEGER_COLUMN = "INTEGER";
+      static const std::string FLOAT_COLUMN = "FLOAT";
+      static const std::string DATE_TIME_COLUMN = "DATE_TIME";
+      static const std::string BOOL_COLUMN = "BOOL";
+
+      std::string type, rest;
+      simple_split(mapping, "|", &type, &rest);
+      if (type == STRING_TYPE)
+        return STRING_COLUMN;
+      else if (type == INTEGER_TYPE)
+        return INTEGER_COLUMN;
+      else if (type == NUMBER_TYPE)
+        return FLOAT_COLUMN;
+      else if (type == DATETIME_TYPE)
+        return DATE_TIME_COLUMN;
+      else if (type == BOOLEAN_TYPE)
+        return BOOL_COLUMN;
+      return S_EMPTY_;
+    }
+
+    //--------------------------------------------------------------------------
+    // ["/path/to/row/element", "table", {"/column/path -> name": "type", ...}]
+    // Columns are ordered as keys of column sub-mapping.
+    static TargetItemPtr ParseTableTargetSpec(
+        Target<T> * parent_target,
+        Path parent_path,
+        const Dynamic & mapping,
+        const detail::Options::Ptr & options,
+        PathNodePtr path_tree,
+        TargetItemVector * mask_target_items,
+        String2IdMap * str2id,
+        std::string * error)
+    {
+      static const std::string TABLE_TYPE = "table";
+
+      const Dynamic & columns_mapping = mapping.GetByIndex(2);
+      if (!mapping.GetByIndex(0).IsString()
+          || !mapping.GetByIndex(1).IsString()
+          || mapping.GetByIndex(1).GetConstString() != TABLE_TYPE
+          || !columns_mapping.IsDict() || columns_mapping.empty())
+      {
+        *error = "Table mapping must have three elements: "
+          "path/to/xml/element/with/row, \"table\" and "
+          "non-empty object with column sub-mappings";
+        return TargetItemPtr();
+      }
+
+      Path path(mapping.GetByIndex(0).GetString(), str2id);
+      Path fool_path(parent_path / path);
+
+      StringVector table_def, keys;
+      std::vector<Path> column_paths;
+      std::set<std::string> unique_keys;
+      DDICT_FOREACH(pair, columns_mapping)
+      {
+        std::string path_spec, key;
+        simple_split(pair->first, "->", &path_spec, &key);
+        Path column_path(path_spec, str2id);
+        if (key.empty())
+        {
+          if (!column_path.attribute_name().empty())
+            key = column_path.attribute_name();
+          else
+            key = column_path.GetLastElementName(*str2id);
+        }
+
+        if (key.empty() || key == S_STAR_ || starts_with(key, "@")
+            || !unique_keys.insert(key).second)
+        {
+          *error = "Wrong table column name in '" + pair->first + "'";
+          return TargetItemPtr();
+        }
+
+        if (!pair->second.IsString()
+            || TableColumnType(pair->second.GetConstString()).empty())
+        {
+          *error = "Table column '" + key + "' must be one of scalar types: "
+              "string, integer, number, boolean, datetime";
+          return TargetItemPtr();
+        }
+
+        table_def.push_back(key + ":" +
+            TableColumnType(pair->second.GetConstString()));
+        keys.push_back(key);
+        column_paths.push_back(fool_path / column_path);
+      }
+
+      typename TableTarget<T>::Ptr target =
+          TableTarget<T>::Create(options, table_def, error);
+      if (!target)
+        return TargetItemPtr();
+
+      size_t column = 0;
+      DDICT_FOREACH(pair, columns_mapping)
+      {
+        TargetItemPtr child_target_item = ParseScalarTargetSpec(target.get(),
+            column_paths[column], pair->second.GetConstString(), options,
+            path_tree, mask_target_items, error);
+        if (!child_target_item)
+          return TargetItemPtr();
+
+        child_target_item->SetKey(keys[column], false);
+        target->PutTargetItem(child_target_item);
+        ++column;
+      }
+
+      TargetItemPtr target_item = TargetItem<T>::Create(fool_path, target);
+      target_item->SetParentTarget(parent_target);
+
+      if (fool_path.is_mask())
+        mask_target_items->push_back(target_item);
+      else
+        path_tree->PutTargetItem(target_item);
+
+      return target_item;
+    }
+
     //--------------------------------------------------------------------------
     static TargetItemPtr ParseObjectTargetSpec(
         Target<T> * parent_target,
@@ -1558,11 +2078,15 @@ namespace nkit
     PathNodePtr path_tree_;
     PathNode<T> * current_node_;
     detail::Options::Ptr options_;
-    Path current_path_;
     RootTargets root_targets_;
     bool first_node_;
     String2IdMap str2id_;
     TargetItemVector mask_target_items_;
+    MaskAutomaton<T> mask_automaton_;
+    std::vector<uint32_t> mask_states_;
+    RecordSinks record_sinks_;
+    bool stopped_;
+    bool cleared_;
   }; // StructXml2VarBuilder
 
   //----------------------------------------------------------------------------
@@ -0,0 +1,717 @@
+/*
+   Copyright 2010-2015 Boris T. Darchiev (boris.darchiev@gmail.com)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+#include "nkit/tools.h"
+
+namespace nkit
+{
+  namespace detail
+  {
+    //--------------------------------------------------------------------------
+    struct UInt128
+    {
+      uint64_t low_;
+      uint64_t high_;
+    };
+
+    inline UInt128 full_multiplication(uint64_t a, uint64_t b)
+    {
+      UInt128 result;
+#if defined(__GNUC__) && defined(__SIZEOF_INT128__)
+      unsigned __int128 r = static_cast<unsigned __int128>(a) * b;
+      result.low_ = static_cast<uint64_t>(r);
+      result.high_ = static_cast<uint64_t>(r >> 64);
+#else
+      const uint64_t M32 = 0xFFFFFFFFULL;
+      uint64_t a_lo = a & M32, a_hi = a >> 32;
+      uint64_t b_lo = b & M32, b_hi = b >> 32;
+      uint64_t lo_lo = a_lo * b_lo;
+      uint64_t hi_lo = a_hi * b_lo;
+      uint64_t lo_hi = a_lo * b_hi;
+      uint64_t hi_hi = a_hi * b_hi;
+      uint64_t cross = (lo_lo >> 32) + (hi_lo & M32) + lo_hi;
+      result.high_ = hi_hi + (hi_lo >> 32) + (cross >> 32);
+      result.low_ = (cross << 32) | (lo_lo & M32);
+#endif
+      return result;
+    }
+
+    inline int leading_zeroes(uint64_t v)
+    {
+#if defined(__GNUC__)
+      return __builtin_clzll(v);
+#else
+      int n = 0;
+      while (!(v & 0x8000000000000000ULL))
+      {
+        v <<= 1;
+        ++n;
+      }
+      return n;
+#endif
+    }
+
+    inline double bits_to_double(uint64_t bits)
+    {
+      double d;
+      std::memcpy(&d, &bits, sizeof(d));
+      return d;
+    }
+
+    inline uint64_t double_to_bits(double d)
+    {
+      uint64_t bits;
+      std::memcpy(&bits, &d, sizeof(bits));
+      return bits;
+    }
+
+    static const char DIGITS_LUT[200 + 1] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+
+    static const uint64_t POW10_U64[20] =
+    {
+      1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+      10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL,
+      100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+      100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+      100000000000000000ULL, 1000000000000000000ULL,
+      10000000000000000000ULL
+    };
+
+    // Exactly representable powers of ten
+    static const double POW10_DOUBLE[23] =
+    {
+      1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12,
+      1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    /***************************************************************************
+     * Decimal to binary: Clinger's fast path, then Eisel-Lemire algorithm
+     * (D. Lemire, "Number Parsing at a Gigabyte per Second"), then strtod()
+     * for the rare cases neither of them can decide on.
+     **************************************************************************/
+    static const int64_t POW5_SMALLEST = -325;
+    static const int64_t POW5_LARGEST = 308;
+
+    struct Pow5Item
+    {
+      uint64_t high_;
+      uint64_t low_;
+    };
+
+    static const Pow5Item POW5_128[] =
+    {
+#include "numeric/pow5_128.inc"
+    };
+
+    bool compute_double(int64_t power, uint64_t i, bool negative,
+        double * out)
+    {
+      if (-22 <= power && power <= 22 && i <= 9007199254740991ULL)
+      {
+        double d = static_cast<double>(i);
+        if (power < 0)
+          d = d / POW10_DOUBLE[-power];
+        else
+          d = d * POW10_DOUBLE[power];
+        *out = negative ? -d : d;
+        return true;
+      }
+
+      if (i == 0)
+      {
+        *out = negative ? -0.0 : 0.0;
+        return true;
+      }
+
+      if (power < POW5_SMALLEST || power > POW5_LARGEST)
+        return false;
+
+      const Pow5Item & factor = POW5_128[power - POW5_SMALLEST];
+      int64_t exponent = (((152170 + 65536) * power) >> 16) + 1024 + 63;
+      int lz = leading_zeroes(i);
+      i <<= lz;
+
+      UInt128 product = full_multiplication(i, factor.high_);
+      uint64_t lower = product.low_;
+      uint64_t upper = product.high_;
+
+      if (unlikely((upper & 0x1FF) == 0x1FF) && unlikely(lower + i < lower))
+      {
+        product = full_multiplication(i, factor.low_);
+        uint64_t product_low = product.low_;
+        uint64_t product_middle2 = product.high_;
+        uint64_t product_middle1 = lower;
+        uint64_t product_high = upper;
+        uint64_t product_middle = product_middle1 + product_middle2;
+        if (product_middle < product_middle1)
+          product_high++;
+        if ((product_middle + 1 == 0) && ((product_high & 0x1FF) == 0x1FF)
+            && (product_low + i < product_low))
+          return false;
+        upper = product_high;
+        lower = product_middle;
+      }
+
+      uint64_t upperbit = upper >> 63;
+      uint64_t mantissa = upper >> (upperbit + 9);
+      lz += static_cast<int>(1 ^ upperbit);
+
+      // halfway between two doubles: let strtod() decide
+      if (unlikely((lower == 0) && ((upper & 0x1FF) == 0)
+          && ((mantissa & 3) == 1)))
+        return false;
+
+      mantissa += mantissa & 1;
+      mantissa >>= 1;
+      if (mantissa >= (1ULL << 53))
+      {
+        mantissa = (1ULL << 52);
+        lz--;
+      }
+      mantissa &= ~(1ULL << 52);
+
+      int64_t real_exponent = exponent - lz;
+      // subnormals and overflows go to strtod()
+      if (unlikely((real_exponent < 1) || (real_exponent > 2046)))
+        return false;
+
+      mantissa |= static_cast<uint64_t>(real_exponent) << 52;
+      mantissa |= static_cast<uint64_t>(negative) << 63;
+      *out = bits_to_double(mantissa);
+      return true;
+    }
+
+    /***************************************************************************
+     * Binary to decimal: Grisu2 (F. Loitsch, "Printing Floating-Point Numbers
+     * Quickly and Accurately with Integers"). Output always reads back to
+     * the same double and is the shortest one in the vast majority of cases.
+     **************************************************************************/
+    static const uint64_t DP_SIGNIFICAND_MASK = 0x000FFFFFFFFFFFFFULL;
+    static const uint64_t DP_EXPONENT_MASK = 0x7FF0000000000000ULL;
+    static const uint64_t DP_HIDDEN_BIT = 0x0010000000000000ULL;
+    static const int DP_SIGNIFICAND_SIZE = 52;
+    static const int DP_EXPONENT_BIAS = 0x3FF + DP_SIGNIFICAND_SIZE;
+    static const int DP_MIN_EXPONENT = -DP_EXPONENT_BIAS;
+    static const int DIY_SIGNIFICAND_SIZE = 64;
+
+    struct DiyFp
+    {
+      DiyFp() : f_(0), e_(0) {}
+      DiyFp(uint64_t f, int e) : f_(f), e_(e) {}
+
+      explicit DiyFp(double d)
+      {
+        uint64_t u = double_to_bits(d);
+        int biased_e = static_cast<int>((u & DP_EXPONENT_MASK)
+            >> DP_SIGNIFICAND_SIZE);
+        uint64_t significand = u & DP_SIGNIFICAND_MASK;
+        if (biased_e != 0)
+        {
+          f_ = significand + DP_HIDDEN_BIT;
+          e_ = biased_e - DP_EXPONENT_BIAS;
+        }
+        else
+        {
+          f_ = significand;
+          e_ = DP_MIN_EXPONENT + 1;
+        }
+      }
+
+      DiyFp operator -(const DiyFp & rhs) const
+      {
+        return DiyFp(f_ - rhs.f_, e_);
+      }
+
+      DiyFp operator *(const DiyFp & rhs) const
+      {
+        UInt128 p = full_multiplication(f_, rhs.f_);
+        uint64_t h = p.high_;
+        if (p.low_ & (1ULL << 63))
+          h++; // round
+        return DiyFp(h, e_ + rhs.e_ + 64);
+      }
+
+      DiyFp Normalize() const
+      {
+        int s = leading_zeroes(f_);
+        return DiyFp(f_ << s, e_ - s);
+      }
+
+      DiyFp NormalizeBoundary() const
+      {
+        DiyFp res = *this;
+        while (!(res.f_ & (DP_HIDDEN_BIT << 1)))
+        {
+          res.f_ <<= 1;
+          res.e_--;
+        }
+        res.f_ <<= (DIY_SIGNIFICAND_SIZE - DP_SIGNIFICAND_SIZE - 2);
+        res.e_ = res.e_ - (DIY_SIGNIFICAND_SIZE - DP_SIGNIFICAND_SIZE - 2);
+        return res;
+      }
+
+      void NormalizedBoundaries(DiyFp * minus, DiyFp * plus) const
+      {
+        DiyFp pl = DiyFp((f_ << 1) + 1, e_ - 1).NormalizeBoundary();
+        DiyFp mi = (f_ == DP_HIDDEN_BIT) ?
+            DiyFp((f_ << 2) - 1, e_ - 2) : DiyFp((f_ << 1) - 1, e_ - 1);
+        mi.f_ <<= mi.e_ - pl.e_;
+        mi.e_ = pl.e_;
+        *plus = pl;
+        *minus = mi;
+      }
+
+      uint64_t f_;
+      int e_;
+    };
+
+    struct CachedPower
+    {
+      uint64_t f_;
+      int e_;
+    };
+
+    static const CachedPower CACHED_POW10[] =
+    {
+#include "numeric/cached_pow10.inc"
+    };
+
+    inline DiyFp get_cached_power(int e, int * K)
+    {
+      double dk = (-61 - e) * 0.30102999566398114 + 347;
+      int k = static_cast<int>(dk);
+      if (dk - k > 0.0)
+        k++;
+      unsigned index = static_cast<unsigned>((k >> 3) + 1);
+      *K = -(-348 + static_cast<int>(index << 3));
+      return DiyFp(CACHED_POW10[index].f_, CACHED_POW10[index].e_);
+    }
+
+    inline void grisu_round(char * buffer, int len, uint64_t delta,
+        uint64_t rest, uint64_t ten_kappa, uint64_t wp_w)
+    {
+      while (rest < wp_w && delta - rest >= ten_kappa &&
+          (rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w))
+      {
+        buffer[len - 1]--;
+        rest += ten_kappa;
+      }
+    }
+
+    inline int count_decimal_digit32(uint32_t n)
+    {
+      if (n < 10) return 1;
+      if (n < 100) return 2;
+      if (n < 1000) return 3;
+      if (n < 10000) return 4;
+      if (n < 100000) return 5;
+      if (n < 1000000) return 6;
+      if (n < 10000000) return 7;
+      if (n < 100000000) return 8;
+      return 9; // n < 2^32 && n >= 10^9 is handled by the kappa <= 10 loop
+    }
+
+    void digit_gen(const DiyFp & W, const DiyFp & Mp, uint64_t delta,
+        char * buffer, int * len, int * K)
+    {
+      const DiyFp one(1ULL << -Mp.e_, Mp.e_);
+      const DiyFp wp_w = Mp - W;
+      uint32_t p1 = static_cast<uint32_t>(Mp.f_ >> -one.e_);
+      uint64_t p2 = Mp.f_ & (one.f_ - 1);
+      int kappa = (p1 >= 1000000000) ? 10 : count_decimal_digit32(p1);
+      *len = 0;
+
+      while (kappa > 0)
+      {
+        uint32_t divisor = static_cast<uint32_t>(POW10_U64[kappa - 1]);
+        uint32_t d = p1 / divisor;
+        p1 %= divisor;
+        if (d || *len)
+          buffer[(*len)++] = static_cast<char>('0' + d);
+        kappa--;
+        uint64_t tmp = (static_cast<uint64_t>(p1) << -one.e_) + p2;
+        if (tmp <= delta)
+        {
+          *K += kappa;
+          grisu_round(buffer, *len, delta, tmp,
+              POW10_U64[kappa] << -one.e_, wp_w.f_);
+          return;
+        }
+      }
+
+      for (;;)
+      {
+        p2 *= 10;
+        delta *= 10;
+        char d = static_cast<char>(p2 >> -one.e_);
+        if (d || *len)
+          buffer[(*len)++] = static_cast<char>('0' + d);
+        p2 &= one.f_ - 1;
+        kappa--;
+        if (p2 < delta)
+        {
+          *K += kappa;
+          int index = -kappa;
+          grisu_round(buffer, *len, delta, p2, one.f_,
+              wp_w.f_ * (index < 20 ? POW10_U64[index] : 0));
+          return;
+        }
+      }
+    }
+
+    void grisu2(double value, char * buffer, int * length, int * K)
+    {
+      const DiyFp v(value);
+      DiyFp w_m, w_p;
+      v.NormalizedBoundaries(&w_m, &w_p);
+
+      const DiyFp c_mk = get_cached_power(w_p.e_, K);
+      const DiyFp W = v.Normalize() * c_mk;
+      DiyFp Wp = w_p * c_mk;
+      DiyFp Wm = w_m * c_mk;
+      Wm.f_++;
+      Wp.f_--;
+      digit_gen(W, Wp, Wp.f_ - Wm.f_, buffer, length, K);
+    }
+
+    char * write_exponent(int K, char * buffer)
+    {
+      if (K < 0)
+      {
+        *buffer++ = '-';
+        K = -K;
+      }
+
+      if (K >= 100)
+      {
+        *buffer++ = static_cast<char>('0' + K / 100);
+        K %= 100;
+        const char * d = DIGITS_LUT + K * 2;
+        *buffer++ = d[0];
+        *buffer++ = d[1];
+      }
+      else if (K >= 10)
+      {
+        const char * d = DIGITS_LUT + K * 2;
+        *buffer++ = d[0];
+        *buffer++ = d[1];
+      }
+      else
+        *buffer++ = static_cast<char>('0' + K);
+
+      return buffer;
+    }
+
+    // Fixed notation for 1e-6 <= v < 1e21, exponential otherwise.
+    // Integral values always get ".0" to stay a FLOAT after re-parsing.
+    char * prettify(char * buffer, int length, int k)
+    {
+      const int kk = length + k; // 10^(kk-1) <= v < 10^kk
+
+      if (0 <= k && kk <= 21)
+      {
+        // 1234e7 -> 12340000000.0
+        for (int i = length; i < kk; i++)
+          buffer[i] = '0';
+        buffer[kk] = '.';
+        buffer[kk + 1] = '0';
+        return &buffer[kk + 2];
+      }
+      else if (0 < kk && kk <= 21)
+      {
+        // 1234e-2 -> 12.34
+        std::memmove(&buffer[kk + 1], &buffer[kk],
+            static_cast<size_t>(length - kk));
+        buffer[kk] = '.';
+        return &buffer[length + 1];
+      }
+      else if (-6 < kk && kk <= 0)
+      {
+        // 1234e-6 -> 0.001234
+        const int offset = 2 - kk;
+        std::memmove(&buffer[offset], &buffer[0], static_cast<size_t>(length));
+        buffer[0] = '0';
+        buffer[1] = '.';
+        for (int i = 2; i < offset; i++)
+          buffer[i] = '0';
+        return &buffer[length + offset];
+      }
+      else if (length == 1)
+      {
+        // 1e30
+        buffer[1] = 'e';
+        return write_exponent(kk - 1, &buffer[2]);
+      }
+      else
+      {
+        // 1234e30 -> 1.234e33
+        std::memmove(&buffer[2], &buffer[1], static_cast<size_t>(length - 1));
+        buffer[1] = '.';
+        buffer[length + 1] = 'e';
+        return write_exponent(kk - 1, &buffer[length + 2]);
+      }
+    }
+
+    size_t write_non_finite(double v, char * out)
+    {
+      const char * s = (v != v) ? "nan" : (v < 0 ? "-inf" : "inf");
+      size_t len = strlen(s);
+      std::memcpy(out, s, len + 1);
+      return len;
+    }
+  } // namespace detail
+
+  //----------------------------------------------------------------------------
+  size_t uint64_to_chars(uint64_t v, char * out)
+  {
+    char tmp[20];
+    char * p = tmp + sizeof(tmp);
+    while (v >= 100)
+    {
+      const char * d = detail::DIGITS_LUT + (v % 100) * 2;
+      v /= 100;
+      *--p = d[1];
+      *--p = d[0];
+    }
+    if (v >= 10)
+    {
+      const char * d = detail::DIGITS_LUT + v * 2;
+      *--p = d[1];
+      *--p = d[0];
+    }
+    else
+      *--p = static_cast<char>('0' + v);
+
+    size_t len = static_cast<size_t>(tmp + sizeof(tmp) - p);
+    std::memcpy(out, p, len);
+    out[len] = '\0';
+    return len;
+  }
+
+  //----------------------------------------------------------------------------
+  size_t int64_to_chars(int64_t v, char * out)
+  {
+    if (v < 0)
+    {
+      *out = '-';
+      return uint64_to_chars(0 - static_cast<uint64_t>(v), out + 1) + 1;
+    }
+    return uint64_to_chars(static_cast<uint64_t>(v), out);
+  }
+
+  //----------------------------------------------------------------------------
+  size_t double_to_chars(double v, char * out)
+  {
+    uint64_t bits = detail::double_to_bits(v);
+    if (unlikely((bits & detail::DP_EXPONENT_MASK) ==
+        detail::DP_EXPONENT_MASK))
+      return detail::write_non_finite(v, out);
+
+    char * buffer = out;
+    if (bits >> 63)
+    {
+      *buffer++ = '-';
+      v = -v;
+    }
+
+    if (v == 0.0)
+    {
+      std::memcpy(buffer, "0.0", 4);
+      return static_cast<size_t>(buffer - out) + 3;
+    }
+
+    int length, K;
+    detail::grisu2(v, buffer, &length, &K);
+    char * end = detail::prettify(buffer, length, K);
+    *end = '\0';
+    return static_cast<size_t>(end - out);
+  }
+
+  //----------------------------------------------------------------------------
+  size_t double_to_chars(double v, size_t precision, char * out)
+  {
+    static const double EXACT_INTEGER_LIMIT = 4503599627370496.0; // 2^52
+
+    if (unlikely(precision > DOUBLE_MAX_FAST_PRECISION))
+      return 0;
+
+    uint64_t bits = detail::double_to_bits(v);
+    if (unlikely((bits & detail::DP_EXPONENT_MASK) ==
+        detail::DP_EXPONENT_MASK))
+      return detail::write_non_finite(v, out);
+
+    const double a = std::fabs(v);
+    const double scale = detail::POW10_DOUBLE[precision];
+    const double s = a * scale;
+    if (unlikely(!(s < EXACT_INTEGER_LIMIT)))
+      return 0;
+
+    // 'a * scale' is exactly 's + err', so rounding of the scaled value
+    // to an integer can be decided without any precision loss, with ties
+    // going to even, as printf() does
+    const double err = fma(a, scale, -s);
+    const double n = std::floor(s);
+    const double half_diff = (s - n) - 0.5;
+    uint64_t digits = static_cast<uint64_t>(n);
+    if (half_diff > -err || (half_diff == -err && (digits & 1)))
+      digits++;
+
+    char * p = out;
+    if (bits >> 63)
+      *p++ = '-';
+
+    char tmp[24];
+    size_t len = uint64_to_chars(digits, tmp);
+    if (precision == 0)
+    {
+      std::memcpy(p, tmp, len + 1);
+      return static_cast<size_t>(p - out) + len;
+    }
+
+    if (len <= precision)
+    {
+      // 0.00ddd
+      *p++ = '0';
+      *p++ = '.';
+      for (size_t i = len; i < precision; ++i)
+        *p++ = '0';
+      std::memcpy(p, tmp, len);
+      p += len;
+    }
+    else
+    {
+      size_t int_len = len - precision;
+      std::memcpy(p, tmp, int_len);
+      p += int_len;
+      *p++ = '.';
+      std::memcpy(p, tmp + int_len, precision);
+      p += precision;
+    }
+
+    *p = '\0';
+    return static_cast<size_t>(p - out);
+  }
+
+  //----------------------------------------------------------------------------
+  bool chars_to_double(const char * str, size_t size, double * out,
+      size_t * parsed)
+  {
+    const char * p = str;
+    const char * const end = str + size;
+    bool negative = false;
+
+    if (p != end && (*p == '-' || *p == '+'))
+    {
+      negative = (*p == '-');
+      ++p;
+    }
+
+    const char * const start_digits = p;
+    uint64_t i = 0;
+    while (p != end && *p >= '0' && *p <= '9')
+    {
+      i = 10 * i + static_cast<uint64_t>(*p - '0');
+      ++p;
+    }
+
+    int64_t exponent = 0;
+    const char * first_after_period = NULL;
+    if (p != end && *p == '.')
+    {
+      ++p;
+      first_after_period = p;
+      while (p != end && *p >= '0' && *p <= '9')
+      {
+        i = 10 * i + static_cast<uint64_t>(*p - '0');
+        ++p;
+      }
+      exponent = first_after_period - p;
+    }
+
+    int64_t digit_count = p - start_digits;
+    if (first_after_period)
+      --digit_count;
+    if (digit_count == 0)
+      return false;
+
+    const char * const digits_end = p;
+
+    if (p != end && (*p == 'e' || *p == 'E'))
+    {
+      const char * exp_begin = p;
+      ++p;
+      bool neg_exp = false;
+      if (p != end && (*p == '-' || *p == '+'))
+      {
+        neg_exp = (*p == '-');
+        ++p;
+      }
+
+      if (p == end || *p < '0' || *p > '9')
+      {
+        p = exp_begin; // "1e" is "1" followed by garbage, as in strtod()
+      }
+      else
+      {
+        int64_t exp_number = 0;
+        while (p != end && *p >= '0' && *p <= '9')
+        {
+          if (exp_number < 0x100000000LL)
+            exp_number = 10 * exp_number + (*p - '0');
+          ++p;
+        }
+        exponent += neg_exp ? -exp_number : exp_number;
+      }
+    }
+
+    if (parsed)
+      *parsed = static_cast<size_t>(p - str);
+
+    // More than 19 significant digits might have overflowed 'i'
+    bool fast = true;
+    if (unlikely(digit_count > 19))
+    {
+      const char * s = start_digits;
+      while (s != digits_end && (*s == '0' || *s == '.'))
+        ++s;
+      int64_t significant_count = digits_end - s;
+      if (first_after_period && s < first_after_period)
+        --significant_count;
+      fast = significant_count <= 19;
+    }
+
+    if (likely(fast) && detail::compute_double(exponent, i, negative, out))
+      return true;
+
+    std::string tmp(str, static_cast<size_t>(p - str));
+    *out = ::strtod(tmp.c_str(), NULL);
+    return true;
+  }
+} // namespace nkit
@@ -0,0 +1,407 @@
+/*
+   Copyright 2014 Boris T. Darchiev (boris.darchiev@gmail.com)
+                  Vasiliy Soshnikov (dedok.mad@gmail.com)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include <nkit/threading/thread_pool.h>
+#include <nkit/tools.h>
+
+#include <nkit/detail/push_options.h>
+
+#if !defined(NKIT_WINNT)
+#  include <sched.h>
+#  include <unistd.h>
+#endif
+
+namespace nkit
+{
+  namespace detail
+  {
+    static NKIT_THREAD_LOCAL ThreadPoolWorker * current_worker_ = NULL;
+
+    // Process-wide pool and its options. Pool lives till process exit.
+    static SpinLock default_pool_lock_;
+    static ThreadPool * volatile default_pool_ = NULL;
+    static size_t default_threads_ = 0;
+    static bool default_pin_threads_ = false;
+
+    size_t cpu_count()
+    {
+#if defined(NKIT_WINNT)
+      SYSTEM_INFO info;
+      GetSystemInfo(&info);
+      return info.dwNumberOfProcessors ? info.dwNumberOfProcessors : 1;
+#else
+      long count = sysconf(_SC_NPROCESSORS_ONLN);
+      return count > 0 ? static_cast<size_t>(count) : 1;
+#endif
+    }
+
+    static bool pin_thread(ThreadPoolWorker * worker)
+    {
+#if defined(NKIT_WINNT)
+      size_t cpu = worker->index_ % cpu_count() % (sizeof(DWORD_PTR) * 8);
+      return SetThreadAffinityMask(worker->thread_, DWORD_PTR(1) << cpu) != 0;
+#elif defined(__linux__)
+      // process may be restricted to some CPUs, worker N takes N-th of them
+      cpu_set_t allowed;
+      if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+        return false;
+      size_t skip = worker->index_ % CPU_COUNT(&allowed);
+      for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+      {
+        if (!CPU_ISSET(cpu, &allowed) || skip--)
+          continue;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        return pthread_setaffinity_np(worker->thread_, sizeof(set), &set)
+            == 0;
+      }
+      return false;
+#else
+      (void)worker; // there is no affinity API, pinning is ignored
+      return true;
+#endif
+    }
+  } // namespace detail
+
+  ThreadPool::Ptr ThreadPool::Create(const Options & options,
+      std::string * error)
+  {
+    ThreadPool * pool = new ThreadPool;
+    std::string start_error;
+    if (!pool->Start(options, &start_error))
+    {
+      delete pool;
+      if (error)
+        *error = start_error;
+      return Ptr();
+    }
+    return Ptr(pool);
+  }
+
+  bool ThreadPool::Configure(const Options & options, std::string * error)
+  {
+    LockGuard<SpinLock> guard(detail::default_pool_lock_);
+    if (detail::default_pool_)
+    {
+      if (error)
+        *error = "ThreadPool: default pool is already started";
+      return false;
+    }
+    detail::default_threads_ = options.threads;
+    detail::default_pin_threads_ = options.pin_threads;
+    return true;
+  }
+
+  ThreadPool & ThreadPool::Default()
+  {
+    ThreadPool * pool = detail::atomic_load(&detail::default_pool_);
+    if (likely(pool != NULL))
+      return *pool;
+
+    LockGuard<SpinLock> guard(detail::default_pool_lock_);
+    if (!detail::default_pool_)
+    {
+      Options options;
+      options.threads = detail::default_threads_;
+      options.pin_threads = detail::default_pin_threads_;
+      pool = new ThreadPool;
+      std::string error;
+      if (!pool->Start(options, &error))
+        abort_with_core(error);
+      detail::atomic_store(&detail::default_pool_, pool);
+    }
+    return *detail::default_pool_;
+  }
+
+  ThreadPool::ThreadPool()
+    : queued_(0)
+    , sleepers_(0)
+    , stop_(0)
+  {
+#if defined(NKIT_WINNT)
+    InitializeCriticalSection(&sleep_lock_);
+    InitializeConditionVariable(&wake_up_);
+#else
+    pthread_mutex_init(&sleep_lock_, NULL);
+    pthread_cond_init(&wake_up_, NULL);
+#endif
+  }
+
+  ThreadPool::~ThreadPool()
+  {
+    Stop(workers_.size());
+
+    // tasks submitted by threads, which are not workers, after stop
+    while (RunPendingTask())
+      ;
+
+#if defined(NKIT_WINNT)
+    DeleteCriticalSection(&sleep_lock_);
+#else
+    pthread_cond_destroy(&wake_up_);
+    pthread_mutex_destroy(&sleep_lock_);
+#endif
+  }
+
+  bool ThreadPool::Start(const Options & options, std::string * error)
+  {
+    size_t threads = options.threads ? options.threads : detail::cpu_count();
+
+    // all workers are created before first one starts to steal
+    workers_.reserve(threads);
+    for (size_t i = 0; i < threads; ++i)
+    {
+      detail::ThreadPoolWorker * worker = new detail::ThreadPoolWorker;
+      worker->pool_ = this;
+      worker->index_ = i;
+      workers_.push_back(worker);
+    }
+
+    for (size_t i = 0; i < threads; ++i)
+    {
+      detail::ThreadPoolWorker * worker = workers_[i];
+#if defined(NKIT_WINNT)
+      worker->thread_ = CreateThread(NULL, 0, ThreadProc, worker, 0, NULL);
+      bool started = worker->thread_ != NULL;
+#else
+      bool started = pthread_create(&worker->thread_, NULL, ThreadProc,
+          worker) == 0;
+#endif
+      if (!started)
+      {
+        Stop(i);
+        *error = "ThreadPool: could not start worker thread";
+        return false;
+      }
+
+      if (options.pin_threads && !detail::pin_thread(worker))
+      {
+        Stop(i + 1);
+        *error = "ThreadPool: could not set CPU affinity of worker thread";
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Joins first 'started' workers and deletes all of them. Workers read
+  // workers_ while stealing, so it is changed only after join.
+  void ThreadPool::Stop(size_t started)
+  {
+    detail::atomic_store(&stop_, uint32_t(1));
+#if defined(NKIT_WINNT)
+    EnterCriticalSection(&sleep_lock_);
+    WakeAllConditionVariable(&wake_up_);
+    LeaveCriticalSection(&sleep_lock_);
+#else
+    pthread_mutex_lock(&sleep_lock_);
+    pthread_cond_broadcast(&wake_up_);
+    pthread_mutex_unlock(&sleep_lock_);
+#endif
+
+    for (size_t i = 0; i < started; ++i)
+    {
+#if defined(NKIT_WINNT)
+      WaitForSingleObject(workers_[i]->thread_, INFINITE);
+      CloseHandle(workers_[i]->thread_);
+#else
+      pthread_join(workers_[i]->thread_, NULL);
+#endif
+    }
+
+    for (size_t i = 0; i < workers_.size(); ++i)
+      delete workers_[i];
+    workers_.clear();
+  }
+
+#if defined(NKIT_WINNT)
+  DWORD WINAPI ThreadPool::ThreadProc(LPVOID arg)
+  {
+    detail::ThreadPoolWorker * worker =
+        static_cast<detail::ThreadPoolWorker *>(arg);
+    worker->pool_->Run(worker);
+    return 0;
+  }
+#else
+  void * ThreadPool::ThreadProc(void * arg)
+  {
+    detail::ThreadPoolWorker * worker =
+        static_cast<detail::ThreadPoolWorker *>(arg);
+    worker->pool_->Run(worker);
+    return NULL;
+  }
+#endif
+
+  void ThreadPool::Submit(Task * task)
+  {
+    detail::ThreadPoolWorker * self = detail::current_worker_;
+    if (self && self->pool_ == this)
+    {
+      LockGuard<SpinLock> guard(self->lock_);
+      self->tasks_.push_back(task);
+    }
+    else
+    {
+      LockGuard<SpinLock> guard(shared_lock_);
+      shared_tasks_.push_back(task);
+    }
+    detail::atomic_add(&queued_, uint64_t(1));
+    WakeUp();
+  }
+
+  bool ThreadPool::RunPendingTask()
+  {
+    detail::ThreadPoolWorker * self = detail::current_worker_;
+    Task * task = TakeTask(self && self->pool_ == this ? self : NULL);
+    if (!task)
+      return false;
+    task->Run();
+    return true;
+  }
+
+  Task * ThreadPool::TakeTask(detail::ThreadPoolWorker * self)
+  {
+    if (detail::atomic_load(&queued_) == 0)
+      return NULL;
+
+    Task * task = NULL;
+    if (self)
+    {
+      LockGuard<SpinLock> guard(self->lock_);
+      if (!self->tasks_.empty())
+      {
+        task = self->tasks_.back();
+        self->tasks_.pop_back();
+      }
+    }
+
+    if (!task)
+      task = Steal(self ? self->index_ + 1 : 0);
+
+    if (!task)
+    {
+      LockGuard<SpinLock> guard(shared_lock_);
+      if (!shared_tasks_.empty())
+      {
+        task = shared_tasks_.front();
+        shared_tasks_.pop_front();
+      }
+    }
+
+    if (task)
+      detail::atomic_sub(&queued_, uint64_t(1));
+    return task;
+  }
+
+  // Takes oldest task of first non-empty worker starting from 'first'.
+  // Lock is not waited for, busy victim is skipped.
+  Task * ThreadPool::Steal(size_t first)
+  {
+    size_t count = workers_.size();
+    for (size_t i = 0; i < count; ++i)
+    {
+      detail::ThreadPoolWorker * victim = workers_[(first + i) % count];
+      if (!victim->lock_.TryLock())
+        continue;
+      Task * task = NULL;
+      if (!victim->tasks_.empty())
+      {
+        task = victim->tasks_.front();
+        victim->tasks_.pop_front();
+      }
+      victim->lock_.Unlock();
+      if (task)
+        return task;
+    }
+    return NULL;
+  }
+
+  // Sleeper is counted before queued_ is checked and Submit() counts task
+  // before sleepers_ is checked, so one of them sees the other.
+  void ThreadPool::Sleep()
+  {
+#if defined(NKIT_WINNT)
+    EnterCriticalSection(&sleep_lock_);
+#else
+    pthread_mutex_lock(&sleep_lock_);
+#endif
+    detail::atomic_add(&sleepers_, uint32_t(1));
+    detail::memory_barrier();
+    while (detail::atomic_load(&queued_) == 0 &&
+        !detail::atomic_load(&stop_))
+    {
+#if defined(NKIT_WINNT)
+      SleepConditionVariableCS(&wake_up_, &sleep_lock_, INFINITE);
+#else
+      pthread_cond_wait(&wake_up_, &sleep_lock_);
+#endif
+    }
+    detail::atomic_sub(&sleepers_, uint32_t(1));
+#if defined(NKIT_WINNT)
+    LeaveCriticalSection(&sleep_lock_);
+#else
+    pthread_mutex_unlock(&sleep_lock_);
+#endif
+  }
+
+  void ThreadPool::WakeUp()
+  {
+    detail::memory_barrier();
+    if (!detail::atomic_load(&sleepers_))
+      return;
+#if defined(NKIT_WINNT)
+    EnterCriticalSection(&sleep_lock_);
+    WakeConditionVariable(&wake_up_);
+    LeaveCriticalSection(&sleep_lock_);
+#else
+    pthread_mutex_lock(&sleep_lock_);
+    pthread_cond_signal(&wake_up_);
+    pthread_mutex_unlock(&sleep_lock_);
+#endif
+  }
+
+  void ThreadPool::Run(detail::ThreadPoolWorker * self)
+  {
+    detail::current_worker_ = self;
+    uint32_t step = 0;
+    while (true)
+    {
+      // stop_ is read before queues, so tasks submitted before stop are run
+      bool stop = detail::atomic_load(&stop_) != 0;
+      Task * task = TakeTask(self);
+      if (task)
+      {
+        task->Run();
+        step = 0;
+        continue;
+      }
+
+      if (stop)
+        break;
+
+      if (step < detail::SPIN_BACKOFF_LIMIT)
+        detail::spin_backoff(&step);
+      else
+      {
+        Sleep();
+        step = 0;
+      }
+    }
+    detail::current_worker_ = NULL;
+  }
+} // namespace nkit
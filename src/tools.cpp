@@ -302,9 +302,13 @@ namespace nkit
 
   std::string string_cast(double v, size_t precision)
   {
+    char tmp[BUF_LEN];
+    size_t len = double_to_chars(v, precision, tmp);
+    if (likely(len != 0))
+      return std::string(tmp, len);
+
     if (precision >= formats_of_double_count)
       return S_NAN_;
-    char tmp[BUF_LEN];
     if (unlikely(NKIT_SNPRINTF(tmp, BUF_LEN, formats_of_double[precision], v) >=
         BUF_LEN))
       return S_NAN_;
@@ -0,0 +1,40 @@
+#include "nkit/logger/log_record.h"
+
+#include <cstdio>
+#include <iostream>
+
+// Prints binary log of LogRecordFileLogger as text:
+//   example_log_record_decode ./app.bin
+
+bool print_record(nkit::detail::LogLevel level, time_t time,
+    const std::string & message, const nkit::Dynamic &, void *)
+{
+  char buf[64];
+  if (!CTIME_R(time, buf, sizeof(buf)))
+    buf[0] = 0;
+  std::string time_str(buf);
+  if (!time_str.empty())
+    time_str.erase(time_str.size() - 1); // '\n'
+
+  std::cout << time_str << " " << nkit::detail::get_log_level_name(level)
+      << " " << message << '\n';
+  return true;
+}
+
+int main(int argc, char ** argv)
+{
+  if (argc != 2)
+  {
+    std::cerr << "Usage: " << argv[0] << " <binary log file>" << std::endl;
+    return 1;
+  }
+
+  std::string error;
+  if (!nkit::ReadLogRecordFile(argv[1], print_record, NULL, &error))
+  {
+    std::cerr << error << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -853,6 +853,135 @@ namespace nkit_test
     NKIT_TEST_ASSERT(hash1[_k3] == hash2[_k3]);
   }
 
+  NKIT_TEST_CASE(DynamicDictLarge)
+  {
+    const size_t SIZE = 1000;
+    Dynamic dict = Dynamic::Dict();
+    StringDynamicMap check;
+    Dynamic & first = dict["key_0"];
+    first = Dynamic(0);
+    for (size_t i = SIZE; i > 0; --i)
+    {
+      std::string key("key_" + string_cast(static_cast<uint64_t>(i)));
+      dict[key] = Dynamic(static_cast<uint64_t>(i));
+      check[key] = Dynamic(static_cast<uint64_t>(i));
+    }
+    check["key_0"] = Dynamic(0);
+    NKIT_TEST_EQ(dict.size(), SIZE + 1);
+
+    // references to values survive growth of the dict
+    NKIT_TEST_ASSERT(&first == &dict["key_0"]);
+
+    // iteration goes in key order
+    StringDynamicMap::const_iterator check_it = check.begin();
+    DDICT_FOREACH(it, dict)
+    {
+      NKIT_TEST_EQ(it->first, check_it->first);
+      NKIT_TEST_EQ(it->second, check_it->second);
+      ++check_it;
+    }
+    NKIT_TEST_ASSERT(check_it == check.end());
+
+    Dynamic::DictConstIterator found = dict.FindByKey("key_500");
+    NKIT_TEST_ASSERT(found != dict.end_d());
+    NKIT_TEST_EQ(found->second, Dynamic(500));
+    ++found;
+    NKIT_TEST_EQ(found->first, std::string("key_501"));
+    NKIT_TEST_ASSERT(dict.FindByKey("key_1001") == dict.end_d());
+
+    // erase down to small dict
+    for (size_t i = 1; i < SIZE; ++i)
+      dict.Erase("key_" + string_cast(static_cast<uint64_t>(i)));
+    NKIT_TEST_EQ(dict.size(), size_t(2));
+    NKIT_TEST_EQ(dict["key_1000"], Dynamic(1000));
+    NKIT_TEST_ASSERT(dict == DDICT("key_0" << 0 << "key_1000" << 1000));
+    NKIT_TEST_ASSERT(dict.Clone() == dict);
+  }
+
+#if !defined(NKIT_WINNT)
+  void * read_frozen_dynamic(void * arg)
+  {
+    const Dynamic & shared = *static_cast<const Dynamic *>(arg);
+    for (size_t i = 0; i < 10000; ++i)
+    {
+      Dynamic copy(shared);
+      Dynamic list(copy["list"]);
+      Dynamic cell(copy["table"].GetCellValue(0, 0));
+      if (list[(size_t)1] != Dynamic("item") || cell != Dynamic("name"))
+        abort_with_core("Frozen value has been corrupted");
+    }
+    return NULL;
+  }
+#endif
+
+#if !defined(NKIT_WINNT)
+  void * iterate_const_dict(void * arg)
+  {
+    const Dynamic & dict = *static_cast<const Dynamic *>(arg);
+    size_t count = 0;
+    std::string prev;
+    Dynamic::DictConstIterator it = dict.begin_d(), end = dict.end_d();
+    for (; it != end; ++it, ++count)
+    {
+      if (count && !(prev < it->first))
+        abort_with_core("Dict keys are not in order");
+      prev = it->first;
+    }
+    if (count != dict.size())
+      abort_with_core("Dict iteration has lost keys");
+    return NULL;
+  }
+
+  // Big dict sorts its keys on first iteration, const dict may be
+  // iterated by several threads at a time
+  NKIT_TEST_CASE(DynamicDictConcurrentIteration)
+  {
+    const size_t THREADS = 4;
+    for (size_t round = 0; round < 20; ++round)
+    {
+      Dynamic dict = Dynamic::Dict();
+      for (size_t i = 0; i < 1000; ++i)
+        dict["key_" + string_cast(uint64_t(i * 7919 % 1000))] = Dynamic(i);
+
+      pthread_t threads[THREADS];
+      for (size_t i = 0; i < THREADS; ++i)
+        pthread_create(&threads[i], NULL, iterate_const_dict, &dict);
+      for (size_t i = 0; i < THREADS; ++i)
+        pthread_join(threads[i], NULL);
+    }
+  }
+#endif
+
+  NKIT_TEST_CASE(DynamicFreeze)
+  {
+    std::string error;
+    Dynamic table = Dynamic::Table("name:STRING,value:INTEGER", &error);
+    NKIT_TEST_ASSERT(table.AppendRow(Dynamic("name"), Dynamic(1)));
+    Dynamic shared = DDICT(
+           "list" << DLIST(1 << "item")
+        << "table" << table
+        << "string" << "value");
+
+    NKIT_TEST_ASSERT(!shared.IsFrozen());
+    NKIT_TEST_ASSERT(shared.Freeze().IsFrozen());
+    NKIT_TEST_ASSERT(shared["list"].IsFrozen());
+    NKIT_TEST_ASSERT(shared["list"][(size_t)1].IsFrozen());
+    NKIT_TEST_ASSERT(shared["table"].IsFrozen());
+    NKIT_TEST_ASSERT(shared["string"].IsFrozen());
+    NKIT_TEST_ASSERT(!shared.Clone().IsFrozen());
+
+#if !defined(NKIT_WINNT)
+    const size_t THREADS = 4;
+    pthread_t threads[THREADS];
+    for (size_t i = 0; i < THREADS; ++i)
+      pthread_create(&threads[i], NULL, read_frozen_dynamic, &shared);
+    for (size_t i = 0; i < THREADS; ++i)
+      pthread_join(threads[i], NULL);
+#endif
+
+    NKIT_TEST_EQ(shared["list"][(size_t)1], Dynamic("item"));
+  }
+
   NKIT_TEST_CASE(DynamicForEach)
   {
     Dynamic item1("Item 1");
@@ -15,6 +15,7 @@
 */
 
 #include "nkit/test.h"
+#include "nkit/date_time_parser.h"
 #include "nkit/dynamic_json.h"
 #include "nkit/detail/config.h"
 #include "nkit/dynamic_getter.h"
@@ -253,6 +254,128 @@ namespace nkit_test
     NKIT_TEST_ASSERT(etalon == dt);
   }
 
+  NKIT_TEST_CASE(DynamicDateTimeISO8601Fraction)
+  {
+    std::string error;
+    Dynamic dt(Dynamic::DateTimeFromISO8601("2012-07-08T00:12:33.25Z",
+        &error));
+    NKIT_TEST_ASSERT(Dynamic(2012, 7, 8, 0, 12, 33, 250000) == dt);
+
+    dt = Dynamic::DateTimeFromISO8601("20120708T001233,000001", &error);
+    NKIT_TEST_ASSERT(Dynamic(2012, 7, 8, 0, 12, 33, 1) == dt);
+
+    const char * const WRONG[] = {"", "2012", "2012-07-08T00:12:3",
+        "2012-07-08 00:12:33", "2012-07-08T00:12:33.", "2012-07-08T00:1a:33",
+        "2012-07-08T00:12:33.1234567", "2012-07-08T00:12:33+03:00",
+        "2012-02-30T00:12:33"};
+    for (size_t i = 0; i < sizeof(WRONG) / sizeof(WRONG[0]); ++i)
+    {
+      error.clear();
+      dt = Dynamic::DateTimeFromISO8601(WRONG[i], &error);
+      NKIT_TEST_ASSERT_WITH_TEXT(dt.IsUndef() && !error.empty(), WRONG[i]);
+    }
+
+    DateTimeFields fields;
+    NKIT_TEST_ASSERT(parse_iso8601("1970-01-02T00:00:01", 19, &fields));
+    NKIT_TEST_EQ(fields.utc_timestamp(), int64_t(86401));
+    NKIT_TEST_ASSERT(parse_iso8601("1969-12-31T23:59:59", 19, &fields));
+    NKIT_TEST_EQ(fields.utc_timestamp(), int64_t(-1));
+  }
+
+  // Compiled parser gives the same as strptime()
+  NKIT_TEST_CASE(DynamicDateTimeParser)
+  {
+    struct Etalon
+    {
+      const char * format;
+      const char * str;
+    };
+    const Etalon ETALONS[] = {
+        {"%Y-%m-%d %H:%M:%S", "2014-01-01 12:13:14"},
+        {"%Y-%m-%d %H:%M:%S", "2014-1-1  2:3:4 and rest"},
+        {"%Y-%m-%d %H:%M:%S", "2014-01-01  12:13:14"},
+        {"%Y-%m-%d %H:%M:%S", "2014-01-0112:13:14 "},
+        {"%Y-%m-%d %H:%M:%S", "2014-13-01 12:13:14"},
+        {"%Y-%m-%d %H:%M:%S", "0014-01-01 02:03:60"},
+        {"%Y%m%d", "20141301"},
+        {"%Y/%m/%d %H:%M:%S", "2014/01/01 12-13-14"},
+        {"%d.%m.%y %T", "31.12.68 23:59:59"},
+        {"%d.%m.%y %T", "31.12.69 23:59:59"},
+        {"%D %R", "02/29/16 07:08"},
+        {"%F", "2016-02-29"},
+        {"%a, %d %b %Y %H:%M:%S", "Fri, 22 Aug 2014 13:59:06"},
+        {"%A %e %B %Y", "friday 22 AUGUST 2014"},
+        {"%I:%M %p", "12:30 AM"},
+        {"%I:%M %p", "12:30 pm"},
+        {"%I:%M %p", "01:30 PM"},
+        {"%m", "13"},
+        {"%H%M%S", "235960"},
+        {"%Y%m%d", "20140101"},
+        {"%Y-%m-%d%n%H", "2014-01-01\t\n 7"},
+        {"100%% %Y", "100% 2014"},
+        {"%Y-%j", "2014-100"}};
+
+    for (size_t i = 0; i < sizeof(ETALONS) / sizeof(ETALONS[0]); ++i)
+    {
+      std::string text(std::string(ETALONS[i].format) + " <- "
+          + ETALONS[i].str);
+#ifdef NKIT_WINNT
+      struct tm _tm = { 0, 0, 0, 0, 0, 0, 0, 0, 0};
+#else
+      struct tm _tm = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+#endif
+      bool etalon_parsed =
+          NKIT_STRPTIME(ETALONS[i].str, ETALONS[i].format, &_tm) != NULL;
+
+      DateTimeFields fields;
+      DateTimeParser::Ptr parser = DateTimeParser::Create(ETALONS[i].format);
+      bool parsed = parser->Parse(ETALONS[i].str, strlen(ETALONS[i].str),
+          &fields);
+      NKIT_TEST_ASSERT_WITH_TEXT(parsed == etalon_parsed, text);
+      if (!parsed)
+        continue;
+      NKIT_TEST_ASSERT_WITH_TEXT(
+          int(fields.year) == _tm.tm_year + 1900 &&
+          int(fields.month) == _tm.tm_mon + 1 &&
+          int(fields.day) == _tm.tm_mday &&
+          int(fields.hour) == _tm.tm_hour &&
+          int(fields.minute) == _tm.tm_min &&
+          int(fields.second) == _tm.tm_sec, text);
+      NKIT_TEST_ASSERT(Dynamic::DateTimeFromString(ETALONS[i].str,
+          ETALONS[i].format) == Dynamic::DateTimeFromTm(_tm));
+    }
+
+    NKIT_TEST_ASSERT(DateTimeParser::Create("%d %b %Y")->compiled());
+    NKIT_TEST_ASSERT(!DateTimeParser::Create("%Y-%j")->compiled());
+    NKIT_TEST_ASSERT(!DateTimeParser::Create("%Y %")->compiled());
+    const DateTimeParser & cached = DateTimeParser::Get("%Y-%m-%d");
+    NKIT_TEST_ASSERT(&cached != &DateTimeParser::Get("%Y/%m/%d"));
+    NKIT_TEST_ASSERT(&cached == &DateTimeParser::Get("%Y-%m-%d"));
+  }
+
+  NKIT_TEST_CASE(DynamicDateArithmetic)
+  {
+    Dynamic dt(2016, 2, 28, 23, 59, 59);
+    dt.AddSeconds(1);
+    NKIT_TEST_ASSERT(Dynamic(2016, 2, 29, 0, 0, 0) == dt);
+    dt.AddDays(366);
+    NKIT_TEST_ASSERT(Dynamic(2017, 3, 1, 0, 0, 0) == dt);
+    dt.AddSeconds(-1);
+    NKIT_TEST_ASSERT(Dynamic(2017, 2, 28, 23, 59, 59) == dt);
+    dt.AddHours(-24 * 365 * 2);
+    NKIT_TEST_ASSERT(Dynamic(2015, 3, 1, 23, 59, 59) == dt);
+
+    dt = Dynamic(1, 1, 1, 0, 0, 0);
+    dt.AddDays(-1);
+    NKIT_TEST_ASSERT(Dynamic(0, 12, 31, 0, 0, 0) == dt);
+
+    // week and year days are counted without mktime()
+    dt = Dynamic(2000, 3, 1, 0, 0, 0);
+    NKIT_TEST_EQ(dt.GetString("%a %j"), std::string("Wed 061"));
+    dt = Dynamic(1969, 12, 31, 0, 0, 0);
+    NKIT_TEST_EQ(dt.GetString("%A %j"), std::string("Wednesday 365"));
+  }
+
   NKIT_TEST_CASE(DynamicDateTimeWrongValues)
   {
     Dynamic dt(2014, 2, 28, 0, 12, 33);
@@ -272,6 +395,19 @@ namespace nkit_test
 
     dt = Dynamic(2014, 2, 28, 24, 0, 0);
     NKIT_TEST_ASSERT(dt.IsUndef());
+
+    // default format has no fraction, 'Z' and basic form of ISO 8601
+    const char * wrong_defaults[] = { "1998-07-17 14:08:55.25",
+        "1998-07-17 14:08:55Z", "19980717 140855", "1998-07-17T14:08:55",
+        "1998-07-17 14:08:5" };
+    for (size_t i = 0; i < sizeof(wrong_defaults) / sizeof(wrong_defaults[0]);
+        ++i)
+    {
+      std::string error;
+      dt = Dynamic::DateTimeFromDefault(wrong_defaults[i], &error);
+      NKIT_TEST_ASSERT_WITH_TEXT(dt.IsUndef(), wrong_defaults[i]);
+      NKIT_TEST_ASSERT(!error.empty());
+    }
   }
 
   NKIT_TEST_CASE(DynamicDateTime_TimeZoneOffset)
@@ -20,6 +20,10 @@
 #include <nkit/logger_brief.h>
 #include <nkit/test.h>
 
+#if !defined(NKIT_WINNT)
+#  include <pthread.h>
+#endif
+
 namespace nkit_test
 {
   using namespace nkit;
@@ -213,6 +217,53 @@ namespace nkit_test
     NKIT_TEST_ASSERT(list == etalon);
   }
 
+  //----------------------------------------------------------------------------
+  NKIT_TEST_CASE(DynamicJsonTableTypedCells)
+  {
+    std::string error;
+    Dynamic table = Dynamic::Table("s:STRING, i:INTEGER, u:UNSIGNED_INTEGER,"
+        " f:FLOAT, b:BOOL, d:DATE_TIME, q:STRING", &error);
+    NKIT_TEST_ASSERT_WITH_TEXT(error.empty(), error);
+    Dynamic date = Dynamic::DateTimeFromTimestamp(1400000000);
+    for (int64_t i = 0; i < 100; ++i)
+    {
+      DynamicVector row;
+      row.push_back(Dynamic("a\"b\\c\n" + string_cast(i)));
+      row.push_back(Dynamic(-i));
+      row.push_back(Dynamic::UInt64(i * 1000));
+      row.push_back(Dynamic(i / 3.0));
+      row.push_back(Dynamic(i % 2 == 0));
+      row.push_back(date);
+      row.push_back(Dynamic(""));
+      NKIT_TEST_ASSERT(table.AppendRow(row));
+    }
+
+    // same rows through generic Dynamic path
+    Dynamic rows = Dynamic::List();
+    StringVector names = table.GetColumnNames();
+    for (size_t row = 0; row < table.height(); ++row)
+    {
+      Dynamic dict = Dynamic::Dict();
+      for (size_t col = 0; col < table.width(); ++col)
+        dict[names[col]] = table.GetCellValue(row, col);
+      rows.PushBack(dict);
+    }
+
+    std::string json_table = DynamicToJson(table);
+    Dynamic parsed_table = DynamicFromJson(json_table, &error);
+    NKIT_TEST_ASSERT_WITH_TEXT(parsed_table, error);
+    Dynamic parsed_rows = DynamicFromJson(DynamicToJson(rows), &error);
+    NKIT_TEST_ASSERT_WITH_TEXT(parsed_rows, error);
+    NKIT_TEST_EQ(parsed_table, parsed_rows);
+
+    std::ostringstream stream;
+    NKIT_TEST_ASSERT(DynamicToJson(table, &stream));
+    NKIT_TEST_EQ(stream.str(), json_table);
+
+    Dynamic empty = Dynamic::Table("a:STRING", &error);
+    NKIT_TEST_EQ(DynamicToJson(empty), std::string("[]"));
+  }
+
   //----------------------------------------------------------------------------
   NKIT_TEST_CASE(DynamicJsonOStream)
   {
@@ -266,4 +317,125 @@ namespace nkit_test
     d = DynamicFromJson("123", &error);
     NKIT_TEST_ASSERT(d.IsUndef());
   }
+
+  NKIT_TEST_CASE(DynamicJsonArena)
+  {
+    std::string json = "{\"list\": [1, 2.5, \"a rather long string value\"],"
+        "\"dict\": {\"k1\": \"v1\", \"k2\": [true, null, {\"x\": -1}]}}";
+    std::string error;
+    Dynamic etalon = DynamicFromJson(json, &error);
+    NKIT_TEST_ASSERT_WITH_TEXT(etalon, error);
+
+    Dynamic dict;
+    {
+      DynamicArena arena;
+      Dynamic d = DynamicFromJson(json, &error, &arena);
+      NKIT_TEST_ASSERT_WITH_TEXT(d, error);
+      NKIT_TEST_ASSERT(d == etalon);
+      NKIT_TEST_ASSERT(arena.allocated_bytes() > 0);
+      NKIT_TEST_EQ(arena.block_count(), size_t(1));
+      dict = d["dict"];
+    }
+
+    // values outlive the arena object
+    NKIT_TEST_ASSERT(dict == etalon["dict"]);
+    dict["k3"] = Dynamic("v3");
+    dict["k2"].PushBack(Dynamic(1));
+    NKIT_TEST_EQ(dict["k3"].GetString(), std::string("v3"));
+    NKIT_TEST_EQ(dict["k2"].size(), size_t(4));
+  }
+
+#if !defined(NKIT_WINNT)
+  void * release_frozen_items(void * arg)
+  {
+    Dynamic * items = static_cast<Dynamic *>(arg);
+    for (size_t i = 0; i < items->size(); ++i)
+    {
+      Dynamic copy((*items)[i]);
+      if (copy["name"].GetString().empty())
+        abort_with_core("Frozen arena value has been corrupted");
+    }
+    items->Clear();
+    return NULL;
+  }
+
+  // Last references to frozen arena nodes are dropped by several threads
+  // at a time, so arena blocks are released concurrently
+  NKIT_TEST_CASE(DynamicJsonArenaFrozenRelease)
+  {
+    const size_t THREADS = 4;
+    const size_t ITEMS = 2000;
+    Dynamic per_thread[THREADS];
+    for (size_t i = 0; i < THREADS; ++i)
+      per_thread[i] = Dynamic::List();
+
+    {
+      std::string json = "[";
+      for (size_t i = 0; i < ITEMS; ++i)
+        json += std::string(i ? "," : "") +
+            "{\"name\": \"a rather long name of item\", \"id\": [1, 2]}";
+      json += "]";
+
+      std::string error;
+      DynamicArena arena;
+      Dynamic root = DynamicFromJson(json, &error, &arena);
+      NKIT_TEST_ASSERT_WITH_TEXT(root, error);
+      root.Freeze();
+      for (size_t i = 0; i < ITEMS; ++i)
+        per_thread[i % THREADS].PushBack(root[i]);
+    }
+
+    pthread_t threads[THREADS];
+    for (size_t i = 0; i < THREADS; ++i)
+      pthread_create(&threads[i], NULL, release_frozen_items, &per_thread[i]);
+    for (size_t i = 0; i < THREADS; ++i)
+      pthread_join(threads[i], NULL);
+
+    for (size_t i = 0; i < THREADS; ++i)
+      NKIT_TEST_EQ(per_thread[i].size(), size_t(0));
+  }
+#endif
+
+  NKIT_TEST_CASE(DynamicJsonInternedKeys)
+  {
+    std::string error;
+    Dynamic d1 = DynamicFromJson("{\"interned_key\": 1}", &error);
+    NKIT_TEST_ASSERT_WITH_TEXT(d1, error);
+    Dynamic d2 = DynamicFromJson("{\"interned_key\": 2}", &error);
+    NKIT_TEST_ASSERT_WITH_TEXT(d2, error);
+    NKIT_TEST_EQ(d1["interned_key"].GetSignedInteger(), int64_t(1));
+    NKIT_TEST_EQ(d2["interned_key"].GetSignedInteger(), int64_t(2));
+
+    const std::string * key = detail::KeyPool::Intern("interned_key");
+    NKIT_TEST_ASSERT(key != NULL);
+    NKIT_TEST_EQ(*key, std::string("interned_key"));
+    NKIT_TEST_ASSERT(
+        key == detail::KeyPool::Intern(std::string("interned_key")));
+    NKIT_TEST_ASSERT(detail::KeyPool::Intern(
+        std::string(detail::KeyPool::MAX_KEY_SIZE + 1, 'k')) == NULL);
+
+    std::string long_key(detail::KeyPool::MAX_KEY_SIZE + 1, 'k');
+    Dynamic d3 = DynamicFromJson("{\"" + long_key + "\": 3}", &error);
+    NKIT_TEST_ASSERT_WITH_TEXT(d3, error);
+    NKIT_TEST_EQ(d3[long_key].GetSignedInteger(), int64_t(3));
+  }
+
+  // Only parsers (and explicit GetInterned() calls) intern keys
+  NKIT_TEST_CASE(DynamicDictKeysInternedOnlyOnRequest)
+  {
+    size_t pool_size = detail::KeyPool::size();
+    Dynamic dict = Dynamic::Dict();
+    for (size_t i = 0; i < 100; ++i)
+      dict["user_id_" + string_cast(uint64_t(i))] = Dynamic(i);
+    dict.Update("user_id_100", Dynamic(100));
+    NKIT_TEST_EQ(detail::KeyPool::size(), pool_size);
+    NKIT_TEST_EQ(dict["user_id_5"], Dynamic(5));
+
+    dict.GetInterned("interned_on_request", 19) = Dynamic("value");
+    NKIT_TEST_EQ(detail::KeyPool::size(), pool_size + 1);
+    NKIT_TEST_EQ(dict["interned_on_request"], Dynamic("value"));
+    NKIT_TEST_EQ(dict.GetInterned("user_id_5", 9), Dynamic(5));
+    NKIT_TEST_EQ(detail::KeyPool::size(), pool_size + 1);
+    NKIT_TEST_EQ(dict.size(), size_t(102));
+  }
 } // namespace nkit_test
@@ -17,12 +17,25 @@
 #include <iostream>
 #include <iomanip>
 #include <deque>
+#include <vector>
+#include <cstdio>
+#include <fstream>
 
 #include "nkit/test.h"
 #include <nkit/version.h>
 #include <nkit/logger_brief.h>
+#include <nkit/logger/log_record.h>
+#include <nkit/dynamic_json.h>
 #include <nkit/tools.h>
 
+#if defined(NKIT_POSIX_PLATFORM)
+#  include <sys/socket.h>
+#  include <sys/un.h>
+#  include <sys/stat.h>
+#  include <sys/wait.h>
+#  include <unistd.h>
+#endif
+
 NKIT_TEST_CASE(OstreamOperator)
 {
   nkit::StringList list;
@@ -88,6 +101,647 @@ void * second_thread(void *)
   return NULL;
 }
 
+#if !defined(NKIT_WINNT)
+static const size_t ASYNC_THREADS = 4;
+static const size_t ASYNC_LINES = 5000;
+
+void * write_async(void * arg)
+{
+  nkit::Logger * logger = static_cast<nkit::Logger *>(arg);
+  for (size_t i = 0; i < ASYNC_LINES; ++i)
+    NKIT_LOG_INFO(logger << "async line " << i);
+  return NULL;
+}
+
+NKIT_TEST_CASE(AsyncLoggerWritesAllLines)
+{
+  const std::string path("./async_test.log");
+  std::remove(path.c_str());
+
+  std::string error;
+  nkit::Logger::Ptr target = nkit::RotateLogger::Create(path,
+      nkit::ROTATE_INTERVAL_DISABLED, -1, &error);
+  NKIT_TEST_ASSERT_WITH_TEXT(target, error);
+
+  nkit::AsyncLogger::Options options;
+  options.queue_size = 1024;
+  nkit::Logger::Ptr logger = nkit::AsyncLogger::Create(target, options,
+      &error);
+  NKIT_TEST_ASSERT_WITH_TEXT(logger, error);
+
+  pthread_t threads[ASYNC_THREADS];
+  for (size_t i = 0; i < ASYNC_THREADS; ++i)
+    pthread_create(&threads[i], NULL, write_async, logger.get());
+  for (size_t i = 0; i < ASYNC_THREADS; ++i)
+    pthread_join(threads[i], NULL);
+
+  static_cast<nkit::AsyncLogger *>(logger.get())->Flush();
+  NKIT_TEST_EQ(static_cast<nkit::AsyncLogger *>(logger.get())->dropped(),
+      uint64_t(0));
+  logger.reset();
+  target.reset();
+
+  std::ifstream file(path.c_str());
+  std::string line;
+  size_t count = 0;
+  while (std::getline(file, line))
+  {
+    NKIT_TEST_ASSERT_WITH_TEXT(
+        line.find("async line ") != std::string::npos, line);
+    ++count;
+  }
+  NKIT_TEST_EQ(count, ASYNC_THREADS * ASYNC_LINES);
+  file.close();
+  std::remove(path.c_str());
+}
+#endif
+
+struct RotatedFiles
+{
+  RotatedFiles() : files_(0), lines_(0), next_line_(0), ok_(true) {}
+  size_t files_;
+  size_t lines_;
+  size_t next_line_;
+  bool ok_;
+};
+
+// Lines must go in order and have no zero bytes of mapped window
+static size_t check_log_lines(const std::string & path, RotatedFiles * files)
+{
+  std::ifstream file(path.c_str(), std::ios_base::binary);
+  std::string line;
+  size_t count = 0;
+  while (std::getline(file, line))
+  {
+    std::string expected("rotated line " +
+        nkit::string_cast(uint64_t(files->next_line_++)));
+    if (line.size() < expected.size() || line.compare(
+        line.size() - expected.size(), expected.size(), expected) != 0)
+      files->ok_ = false;
+    ++count;
+  }
+  return count;
+}
+
+static void on_rotated(const std::string & path, void * context)
+{
+  RotatedFiles * files = static_cast<RotatedFiles *>(context);
+  ++files->files_;
+  files->lines_ += check_log_lines(path, files);
+  std::remove(path.c_str());
+}
+
+NKIT_TEST_CASE(RotateLoggerRotatesInBackground)
+{
+  const std::string path("./rotate_test.log");
+  std::remove(path.c_str());
+
+  RotatedFiles files;
+  nkit::RotateOptions options;
+  options.segment_size = 4096;
+  options.on_rotated = on_rotated;
+  options.context = &files;
+
+  std::string error;
+  nkit::Logger::Ptr logger = nkit::RotateLogger::Create(path,
+      nkit::ROTATE_INTERVAL_DISABLED, 20000, options, &error);
+  NKIT_TEST_ASSERT_WITH_TEXT(logger, error);
+  const size_t count = 3000;
+  for (size_t i = 0; i < count; ++i)
+  {
+    NKIT_LOG_INFO(logger << "rotated line " << i);
+    if (i % 500 == 0)
+      nkit::sleep(10); // let rotation thread finish
+  }
+  logger.reset();
+
+  NKIT_TEST_ASSERT(files.files_ > 0);
+  NKIT_TEST_ASSERT(!nkit::path_is_file(path + ".next"));
+  size_t main_lines = check_log_lines(path, &files);
+  NKIT_TEST_EQ(files.lines_ + main_lines, count);
+  NKIT_TEST_ASSERT(files.ok_);
+
+  // existing file is appended
+  logger = nkit::RotateLogger::Create(path, nkit::ROTATE_INTERVAL_DISABLED,
+      -1, options, &error);
+  NKIT_TEST_ASSERT_WITH_TEXT(logger, error);
+  NKIT_LOG_INFO(logger << "rotated line " << count);
+  logger.reset();
+  files.next_line_ = files.lines_;
+  NKIT_TEST_EQ(check_log_lines(path, &files), main_lines + 1);
+  NKIT_TEST_ASSERT(files.ok_);
+  std::remove(path.c_str());
+}
+
+#if defined(NKIT_POSIX_PLATFORM)
+static bool has_zero_bytes(const std::string & path)
+{
+  std::string content, error;
+  nkit::text_file_to_string(path, &content, &error);
+  return content.find('\0') != std::string::npos;
+}
+
+NKIT_TEST_CASE(RotateLoggerReopensNotClosedFile)
+{
+  const std::string path("./rotate_crash_test.log");
+  std::remove(path.c_str());
+  std::remove((path + ".next").c_str());
+
+  nkit::RotateOptions options;
+  options.segment_size = 64 * 1024;
+  const size_t count = 100;
+
+  // child exits without destructors, as if it crashed
+  pid_t pid = fork();
+  NKIT_TEST_ASSERT(pid >= 0);
+  if (pid == 0)
+  {
+    nkit::Logger::Ptr logger = nkit::RotateLogger::Create(path,
+        nkit::ROTATE_INTERVAL_DISABLED, 1000000, options, NULL);
+    for (size_t i = 0; logger && i < count; ++i)
+      NKIT_LOG_INFO(logger << "rotated line " << i);
+    _exit(logger ? 0 : 1);
+  }
+  int status = 0;
+  waitpid(pid, &status, 0);
+  NKIT_TEST_ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  NKIT_TEST_ASSERT(has_zero_bytes(path));
+
+  // next file is not mapped till it is written
+  std::string next;
+  std::string error;
+  NKIT_TEST_ASSERT(nkit::text_file_to_string(path + ".next", &next, &error));
+  NKIT_TEST_ASSERT(next.empty());
+
+  nkit::Logger::Ptr logger = nkit::RotateLogger::Create(path,
+      nkit::ROTATE_INTERVAL_DISABLED, 1000000, options, &error);
+  NKIT_TEST_ASSERT_WITH_TEXT(logger, error);
+  NKIT_TEST_ASSERT(!has_zero_bytes(path));
+  NKIT_LOG_INFO(logger << "rotated line " << count);
+  logger.reset();
+
+  RotatedFiles files;
+  NKIT_TEST_EQ(check_log_lines(path, &files), count + 1);
+  NKIT_TEST_ASSERT(files.ok_);
+  NKIT_TEST_ASSERT(!has_zero_bytes(path));
+  NKIT_TEST_ASSERT(!nkit::path_is_file(path + ".next"));
+  std::remove(path.c_str());
+}
+
+// Rotated name is taken by directory, logger keeps writing to its file
+NKIT_TEST_CASE(RotateLoggerKeepsFileIfRenameFails)
+{
+  const std::string path("./rotate_fail_test.log");
+  std::remove(path.c_str());
+
+  std::vector<std::string> dirs;
+  time_t now = time(NULL);
+  for (time_t t = now - 1; t <= now + 3; ++t)
+  {
+    struct tm ti;
+    LOCALTIME_R(t, &ti);
+    char iso_time[128];
+    strftime(iso_time, sizeof(iso_time), "%Y-%m-%dT%H%M%S", &ti);
+    dirs.push_back(path + "." + iso_time);
+    ::mkdir(dirs.back().c_str(), 0777);
+  }
+
+  RotatedFiles files;
+  nkit::RotateOptions options;
+  options.segment_size = 4096;
+  options.on_rotated = on_rotated;
+  options.context = &files;
+
+  std::string error;
+  nkit::Logger::Ptr logger = nkit::RotateLogger::Create(path,
+      nkit::ROTATE_INTERVAL_DISABLED, 2000, options, &error);
+  NKIT_TEST_ASSERT_WITH_TEXT(logger, error);
+  const size_t count = 200;
+  for (size_t i = 0; i < count; ++i)
+    NKIT_LOG_INFO(logger << "rotated line " << i);
+  logger.reset();
+
+  for (size_t i = 0; i < dirs.size(); ++i)
+    ::rmdir(dirs[i].c_str());
+
+  NKIT_TEST_EQ(files.files_, size_t(0));
+  NKIT_TEST_EQ(check_log_lines(path, &files), count);
+  NKIT_TEST_ASSERT(files.ok_);
+  NKIT_TEST_ASSERT(!has_zero_bytes(path));
+  std::remove(path.c_str());
+}
+#endif
+
+class SlowLogger : public nkit::Logger
+{
+public:
+  SlowLogger() : lines_(0) {}
+  size_t lines_;
+
+private:
+  virtual bool WriteLine(nkit::detail::LogLevel, time_t, bool)
+  {
+    nkit::sleep(1);
+    ++lines_;
+    return true;
+  }
+};
+
+NKIT_TEST_CASE(AsyncLoggerDropsOnOverflow)
+{
+  SlowLogger * slow = new SlowLogger;
+  nkit::Logger::Ptr target(slow);
+
+  nkit::AsyncLogger::Options options;
+  options.queue_size = 4;
+  options.overflow = nkit::ASYNC_OVERFLOW_DROP;
+  std::string error;
+  nkit::Logger::Ptr logger = nkit::AsyncLogger::Create(target, options,
+      &error);
+  NKIT_TEST_ASSERT_WITH_TEXT(logger, error);
+
+  const size_t count = 200;
+  for (size_t i = 0; i < count; ++i)
+    NKIT_LOG_INFO(logger << "line " << i);
+
+  uint64_t dropped =
+      static_cast<nkit::AsyncLogger *>(logger.get())->dropped();
+  logger.reset();
+
+  NKIT_TEST_ASSERT(dropped > 0);
+  NKIT_TEST_EQ(slow->lines_ + dropped, count);
+}
+
+class CountingLogger : public nkit::Logger
+{
+public:
+  CountingLogger() : lines_(0) {}
+  size_t lines_;
+
+private:
+  virtual bool WriteLine(nkit::detail::LogLevel, time_t, bool)
+  {
+    ++lines_;
+    return true;
+  }
+};
+
+struct FormatCounter
+{
+  FormatCounter() : count_(0) {}
+  mutable size_t count_;
+};
+
+std::ostream & operator << (std::ostream & out, const FormatCounter & counter)
+{
+  ++counter.count_;
+  return out;
+}
+
+NKIT_TEST_CASE(LogLevelFilterSkipsFormatting)
+{
+  CountingLogger * counting = new CountingLogger;
+  nkit::Logger::Ptr logger(counting);
+  FormatCounter counter;
+  nkit::detail::LogLevel saved = nkit::Logger::level();
+
+  nkit::Logger::SetLevel(nkit::detail::LL_WARN);
+  NKIT_TEST_ASSERT(!nkit::Logger::IsEnabled(nkit::detail::LL_INFO));
+  NKIT_LOG_DEBUG(logger << counter);
+  NKIT_LOG_INFO(logger << counter);
+  NKIT_LOG_WARNING(logger << counter);
+  NKIT_LOG_ERROR(logger << counter);
+  NKIT_TEST_EQ(counter.count_, size_t(2));
+  NKIT_TEST_EQ(counting->lines_, size_t(2));
+
+  nkit::Logger::SetLevel(nkit::detail::LL_DEBUG);
+  NKIT_LOG_DEBUG(logger << counter);
+  NKIT_TEST_EQ(counter.count_, size_t(3));
+  NKIT_TEST_EQ(counting->lines_, size_t(3));
+
+  nkit::Logger::SetLevel(saved);
+}
+
+class HeaderLogger : public nkit::Logger
+{
+public:
+  std::string last_;
+
+private:
+  virtual bool WriteLine(nkit::detail::LogLevel level, time_t now, bool)
+  {
+    last_.clear();
+    AppendHeader(level, now, &last_);
+    last_.append(stream().str());
+    return true;
+  }
+};
+
+NKIT_TEST_CASE(LoggerCachedHeader)
+{
+  HeaderLogger * header_logger = new HeaderLogger;
+  nkit::Logger::Ptr logger(header_logger);
+
+  for (size_t i = 0; i < 3; ++i)
+  {
+    time_t now = time(NULL);
+    NKIT_LOG_WARNING(logger << "text " << i);
+    if (time(NULL) != now)
+      continue; // line could get other second
+
+    char buf[128];
+    NKIT_TEST_ASSERT(CTIME_R(now, buf, sizeof(buf)));
+    std::string expected(buf + 4, strlen(buf) - 5);
+    expected += " " + nkit::get_hostname() + " " + nkit::get_username() +
+        nkit::get_process_id() + ": [Warning]\t text " +
+        nkit::string_cast(i);
+    NKIT_TEST_EQ(header_logger->last_, expected);
+  }
+}
+
+class TextLogger : public nkit::Logger
+{
+public:
+  TextLogger() : lines_(0), flushes_(0) {}
+  std::string last_;
+  size_t lines_;
+  size_t flushes_;
+
+private:
+  virtual bool WriteLine(nkit::detail::LogLevel, time_t, bool)
+  {
+    last_ = stream().str();
+    ++lines_;
+    return true;
+  }
+
+  virtual void Flush()
+  {
+    ++flushes_;
+  }
+};
+
+NKIT_TEST_CASE(LogRecordFormatsText)
+{
+  TextLogger * text_logger = new TextLogger;
+  nkit::Logger::Ptr logger(text_logger);
+
+  NKIT_SLOG_WARNING("user {} has {} items, ratio {}",
+      logger << "bob" << 3 << 0.5 << true);
+  NKIT_TEST_EQ(text_logger->last_,
+      std::string("user bob has 3 items, ratio 0.5 true"));
+
+  nkit::Dynamic list = nkit::Dynamic::List();
+  list.PushBack(nkit::Dynamic(1));
+  list.PushBack(nkit::Dynamic("a"));
+  NKIT_SLOG_INFO("{} {} {}", logger << std::string("list") << list);
+  NKIT_TEST_EQ(text_logger->last_, std::string("list [1,\"a\"] {}"));
+
+  // records go through WriteLine() as text lines, without extra Flush()
+  NKIT_TEST_EQ(text_logger->lines_, size_t(2));
+  NKIT_TEST_EQ(text_logger->flushes_, size_t(0));
+
+  NKIT_TEST_EQ(nkit::RegisterLogFormat("id {}"),
+      nkit::RegisterLogFormat("id {}"));
+  NKIT_TEST_EQ(std::string(nkit::GetLogFormat(
+      nkit::RegisterLogFormat("id {}"))), std::string("id {}"));
+}
+
+NKIT_TEST_CASE(AsyncLoggerFormatsRecords)
+{
+  TextLogger * text_logger = new TextLogger;
+  nkit::Logger::Ptr target(text_logger);
+  std::string error;
+  nkit::Logger::Ptr logger = nkit::AsyncLogger::Create(target,
+      nkit::AsyncLogger::Options(), &error);
+  NKIT_TEST_ASSERT_WITH_TEXT(logger, error);
+
+  for (int i = 0; i < 100; ++i)
+    NKIT_SLOG_INFO("record {} of {}", logger << i << 100);
+  static_cast<nkit::AsyncLogger *>(logger.get())->Flush();
+  NKIT_TEST_EQ(text_logger->last_, std::string("record 99 of 100"));
+}
+
+NKIT_TEST_CASE(LogRecordFileLoggerJson)
+{
+  const std::string path("./log_record_test.json");
+  std::remove(path.c_str());
+
+  std::string error;
+  nkit::Logger::Ptr logger = nkit::LogRecordFileLogger::Create(path,
+      nkit::LOG_RECORD_FILE_JSON, &error);
+  NKIT_TEST_ASSERT_WITH_TEXT(logger, error);
+  NKIT_SLOG_ERROR("{} failed with \"{}\"", logger << "request" << -5);
+  NKIT_LOG_INFO(logger << "plain " << 1);
+  logger.reset();
+
+  std::ifstream file(path.c_str());
+  std::string line;
+  NKIT_TEST_ASSERT(std::getline(file, line));
+  nkit::Dynamic record = nkit::DynamicFromJson(line, &error);
+  NKIT_TEST_ASSERT_WITH_TEXT(record.IsDict(), error + ": " + line);
+  NKIT_TEST_EQ(record["level"].GetConstString(), std::string("error"));
+  NKIT_TEST_EQ(record["format"].GetConstString(),
+      std::string("{} failed with \"{}\""));
+  NKIT_TEST_EQ(record["message"].GetConstString(),
+      std::string("request failed with \"-5\""));
+  NKIT_TEST_EQ(record["args"].size(), size_t(2));
+  NKIT_TEST_EQ(record["args"][size_t(1)].GetSignedInteger(), int64_t(-5));
+  NKIT_TEST_ASSERT(record["time"].GetSignedInteger() > 0);
+
+  NKIT_TEST_ASSERT(std::getline(file, line));
+  record = nkit::DynamicFromJson(line, &error);
+  NKIT_TEST_ASSERT_WITH_TEXT(record.IsDict(), error + ": " + line);
+  NKIT_TEST_EQ(record["message"].GetConstString(), std::string("plain 1"));
+  file.close();
+  std::remove(path.c_str());
+}
+
+struct ReadRecords
+{
+  std::vector<std::string> messages_;
+  std::vector<nkit::Dynamic> args_;
+  std::vector<nkit::detail::LogLevel> levels_;
+};
+
+bool on_log_record(nkit::detail::LogLevel level, time_t,
+    const std::string & message, const nkit::Dynamic & args, void * context)
+{
+  ReadRecords * records = static_cast<ReadRecords *>(context);
+  records->levels_.push_back(level);
+  records->messages_.push_back(message);
+  records->args_.push_back(args);
+  return true;
+}
+
+NKIT_TEST_CASE(LogRecordFileLoggerBinary)
+{
+  const std::string path("./log_record_test.bin");
+  std::remove(path.c_str());
+
+  std::string error;
+  nkit::Logger::Ptr logger = nkit::LogRecordFileLogger::Create(path,
+      nkit::LOG_RECORD_FILE_BINARY, &error);
+  NKIT_TEST_ASSERT_WITH_TEXT(logger, error);
+  for (uint64_t i = 0; i < 3; ++i)
+    NKIT_SLOG_WARNING("value {}: {}", logger << i << 1.5);
+  nkit::Dynamic dict = nkit::Dynamic::Dict();
+  dict["key"] = nkit::Dynamic("value");
+  NKIT_SLOG_INFO("dict {}", logger << dict);
+  logger.reset();
+
+  ReadRecords records;
+  NKIT_TEST_ASSERT_WITH_TEXT(
+      nkit::ReadLogRecordFile(path, on_log_record, &records, &error), error);
+  NKIT_TEST_EQ(records.messages_.size(), size_t(4));
+  NKIT_TEST_EQ(records.messages_[2], std::string("value 2: 1.5"));
+  NKIT_TEST_ASSERT(records.levels_[2] == nkit::detail::LL_WARN);
+  NKIT_TEST_EQ(records.args_[2][size_t(0)].GetUnsignedInteger(), uint64_t(2));
+  NKIT_TEST_EQ(records.args_[2][size_t(1)].GetFloat(), 1.5);
+  NKIT_TEST_EQ(records.messages_[3],
+      std::string("dict {\"key\":\"value\"}"));
+  NKIT_TEST_EQ(records.args_[3][size_t(0)]["key"].GetConstString(),
+      std::string("value"));
+  std::remove(path.c_str());
+}
+
+#if defined(NKIT_POSIX_PLATFORM)
+static int bind_unix_socket(const std::string & path, int type)
+{
+  unlink(path.c_str());
+  int fd = socket(AF_UNIX, type, 0);
+  struct sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path.c_str());
+  if (fd == -1 || bind(fd, (struct sockaddr *) &addr, sizeof(addr)) == -1)
+    return -1;
+  if (type == SOCK_STREAM && listen(fd, 1) == -1)
+    return -1;
+  return fd;
+}
+
+static size_t count_datagrams(int fd)
+{
+  char buf[4096];
+  size_t count = 0;
+  while (recv(fd, buf, sizeof(buf), MSG_DONTWAIT) > 0)
+    ++count;
+  return count;
+}
+
+// Without batch options every line is sent at once
+NKIT_TEST_CASE(RSysLoggerSendsLineByDefault)
+{
+  const std::string path("./rsyslog_default_test.sock");
+  int server = bind_unix_socket(path, SOCK_DGRAM);
+  NKIT_TEST_ASSERT(server != -1);
+
+  std::string error;
+  nkit::Logger::Ptr logger = nkit::RSysUnixSocketLogger::Create(LOG_USER,
+      "nkit-test", path, &error);
+  NKIT_TEST_ASSERT_WITH_TEXT(logger, error);
+
+  NKIT_LOG_INFO(logger << "single line");
+  NKIT_TEST_EQ(count_datagrams(server), size_t(1));
+
+  logger.reset();
+  NKIT_TEST_EQ(count_datagrams(server), size_t(0));
+  close(server);
+  unlink(path.c_str());
+}
+
+NKIT_TEST_CASE(RSysLoggerBatchesDatagrams)
+{
+  const std::string path("./rsyslog_dgram_test.sock");
+  int server = bind_unix_socket(path, SOCK_DGRAM);
+  NKIT_TEST_ASSERT(server != -1);
+
+  nkit::RSysBatchOptions batch;
+  batch.max_lines = 4;
+  batch.flush_interval = 3600;
+  std::string error;
+  nkit::Logger::Ptr logger = nkit::RSysUnixSocketLogger::Create(LOG_USER,
+      "nkit-test", path, &error, batch);
+  NKIT_TEST_ASSERT_WITH_TEXT(logger, error);
+
+  for (size_t i = 0; i < 3; ++i)
+    NKIT_LOG_INFO(logger << "line " << i);
+  NKIT_TEST_EQ(count_datagrams(server), size_t(0));
+
+  NKIT_LOG_INFO(logger << "line " << 3);
+  NKIT_TEST_EQ(count_datagrams(server), size_t(4));
+
+  NKIT_LOG_INFO(logger << "line " << 4);
+  NKIT_LOG_ERROR(logger << "line " << 5);
+  NKIT_TEST_EQ(count_datagrams(server), size_t(2));
+
+  NKIT_LOG_INFO(logger << "line " << 6);
+  logger.reset();
+  NKIT_TEST_EQ(count_datagrams(server), size_t(1));
+
+  close(server);
+  unlink(path.c_str());
+}
+
+NKIT_TEST_CASE(RSysLoggerOctetCountingAndBacklog)
+{
+  const std::string path("./rsyslog_stream_test.sock");
+  unlink(path.c_str());
+
+  nkit::RSysBatchOptions batch;
+  batch.max_backlog_bytes = 1024;
+  std::string error;
+  nkit::Logger::Ptr logger = nkit::RSysUnixSocketLogger::Create(LOG_USER,
+      "nkit-test", path, &error, batch);
+  NKIT_TEST_ASSERT_WITH_TEXT(logger, error);
+
+  // syslog is not reachable: lines are kept in backlog
+  std::string text(100, 'x');
+  for (size_t i = 0; i < 20; ++i)
+    NKIT_LOG_ERROR(logger << text);
+  uint64_t dropped =
+      static_cast<nkit::RSysLoggerBase *>(logger.get())->dropped();
+  NKIT_TEST_ASSERT(dropped > 0);
+  NKIT_TEST_ASSERT(dropped < 20);
+
+  int server = bind_unix_socket(path, SOCK_STREAM);
+  NKIT_TEST_ASSERT(server != -1);
+  nkit::sleep(1100);
+  NKIT_LOG_ERROR(logger << "last");
+  logger.reset();
+
+  int client = accept(server, NULL, NULL);
+  NKIT_TEST_ASSERT(client != -1);
+  std::string received;
+  char buf[4096];
+  ssize_t size;
+  while ((size = recv(client, buf, sizeof(buf), 0)) > 0)
+    received.append(buf, static_cast<size_t>(size));
+
+  // "MSG-LEN SP SYSLOG-MSG" frames
+  size_t frames = 0, pos = 0;
+  std::string last;
+  while (pos < received.size())
+  {
+    size_t space = received.find(' ', pos);
+    NKIT_TEST_ASSERT(space != std::string::npos);
+    size_t length = static_cast<size_t>(
+        atoi(received.substr(pos, space - pos).c_str()));
+    NKIT_TEST_ASSERT(space + 1 + length <= received.size());
+    last = received.substr(space + 1, length);
+    pos = space + 1 + length;
+    ++frames;
+  }
+  NKIT_TEST_EQ(frames, size_t(21 - dropped));
+  NKIT_TEST_ASSERT(last.find("[Error] last") != std::string::npos);
+
+  close(client);
+  close(server);
+  unlink(path.c_str());
+}
+#endif
+
 _NKIT_TEST_CASE(TestRSysLog)
 {
   std::string error;
@@ -1,4 +1,9 @@
 #include "nkit/test.h"
+#include "nkit/threading/once.h"
+#include "nkit/threading/rw_lock.h"
+#include "nkit/threading/seq_lock.h"
+#include "nkit/threading/spin_lock.h"
+#include "nkit/threading/thread_pool.h"
 
 namespace nkit_test
 {
@@ -270,4 +275,332 @@ namespace nkit_test
     NKIT_TEST_ASSERT(str != etalon);
   }
 
+
+  //---------------------------------------------------------------------------
+  NKIT_TEST_CASE(tools_double_to_chars)
+  {
+    char buf[NUMBER_TO_CHARS_BUFFER_SIZE];
+    NKIT_TEST_EQ(std::string(buf, double_to_chars(0.0, buf)), "0.0");
+    NKIT_TEST_EQ(std::string(buf, double_to_chars(1.0, buf)), "1.0");
+    NKIT_TEST_EQ(std::string(buf, double_to_chars(0.1, buf)), "0.1");
+    NKIT_TEST_EQ(std::string(buf, double_to_chars(-2.5, buf)), "-2.5");
+    NKIT_TEST_EQ(std::string(buf, double_to_chars(1e30, buf)), "1e30");
+    NKIT_TEST_EQ(std::string(buf, double_to_chars(123456.789, buf)),
+        "123456.789");
+
+    NKIT_TEST_EQ(string_cast(1.005, 2), "1.00");
+    NKIT_TEST_EQ(string_cast(2.5, 0), "2");
+    NKIT_TEST_EQ(string_cast(-0.125, 2), "-0.12");
+    NKIT_TEST_EQ(string_cast(0.001, 5), "0.00100");
+
+    // round trip and printf() compatibility
+    uint64_t x = 88172645463325252ULL;
+    for (size_t i = 0; i < 100000; ++i)
+    {
+      x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+      if (((x >> 52) & 0x7ff) == 0x7ff) // nan or inf
+        continue;
+      double v;
+      std::memcpy(&v, &x, sizeof(v));
+
+      size_t len = double_to_chars(v, buf);
+      double back = 0.0;
+      size_t parsed = 0;
+      NKIT_TEST_ASSERT(chars_to_double(buf, len, &back, &parsed));
+      NKIT_TEST_ASSERT_WITH_TEXT(back == v, buf);
+      NKIT_TEST_EQ(parsed, len);
+
+      double small = static_cast<double>(x % 100000000) / 1000.0;
+      size_t precision = x % (DOUBLE_MAX_FAST_PRECISION + 1);
+      char etalon[128];
+      NKIT_SNPRINTF(etalon, sizeof(etalon), "%.*f",
+          static_cast<int>(precision), small);
+      NKIT_TEST_EQ(string_cast(small, precision), std::string(etalon));
+    }
+  }
+
+  //---------------------------------------------------------------------------
+  NKIT_TEST_CASE(tools_chars_to_double)
+  {
+    double v = 0.0;
+    size_t parsed = 0;
+    const char * str = "-1.25e+2xyz";
+    NKIT_TEST_ASSERT(chars_to_double(str, strlen(str), &v, &parsed));
+    NKIT_TEST_ASSERT(v == -125.0);
+    NKIT_TEST_EQ(parsed, size_t(8));
+
+    str = "1e";
+    NKIT_TEST_ASSERT(chars_to_double(str, strlen(str), &v, &parsed));
+    NKIT_TEST_ASSERT(v == 1.0);
+    NKIT_TEST_EQ(parsed, size_t(1));
+
+    str = "-.e5";
+    NKIT_TEST_ASSERT(!chars_to_double(str, strlen(str), &v));
+
+    const char * etalons[] = { "0.1", "2.2250738585072014e-308",
+        "4.9e-324", "1.7976931348623157e308", "9007199254740993",
+        "123456789012345678901234567890", "0.000000000000000000001e-300",
+        "1e400" };
+    for (size_t i = 0; i < sizeof(etalons) / sizeof(etalons[0]); ++i)
+    {
+      NKIT_TEST_ASSERT(chars_to_double(etalons[i], strlen(etalons[i]), &v));
+      NKIT_TEST_ASSERT_WITH_TEXT(v == strtod(etalons[i], NULL), etalons[i]);
+    }
+  }
+
+#if !defined(NKIT_WINNT)
+  //---------------------------------------------------------------------------
+  static const size_t SYNC_THREADS = 4;
+  static const size_t SYNC_ITERATIONS = 100000;
+
+  struct SharedPair
+  {
+    SharedPair() : a_(0), b_(0), torn_(0), stop_(0) {}
+    uint64_t a_;
+    uint64_t b_;
+    volatile uint64_t torn_;
+    volatile uint32_t stop_;
+    SpinLock spin_lock_;
+    RWLock rw_lock_;
+    SeqLock seq_lock_;
+  };
+
+  void * increment_under_spin_lock(void * arg)
+  {
+    SharedPair * pair = static_cast<SharedPair *>(arg);
+    for (size_t i = 0; i < SYNC_ITERATIONS; ++i)
+    {
+      LockGuard<SpinLock> guard(pair->spin_lock_);
+      ++pair->a_;
+    }
+    return NULL;
+  }
+
+  NKIT_TEST_CASE(threading_spin_lock)
+  {
+    SharedPair pair;
+    pthread_t threads[SYNC_THREADS];
+    for (size_t i = 0; i < SYNC_THREADS; ++i)
+      pthread_create(&threads[i], NULL, increment_under_spin_lock, &pair);
+    for (size_t i = 0; i < SYNC_THREADS; ++i)
+      pthread_join(threads[i], NULL);
+    NKIT_TEST_EQ(pair.a_, uint64_t(SYNC_THREADS * SYNC_ITERATIONS));
+
+    NKIT_TEST_ASSERT(pair.spin_lock_.TryLock());
+    NKIT_TEST_ASSERT(!pair.spin_lock_.TryLock());
+    pair.spin_lock_.Unlock();
+  }
+
+  void * read_under_rw_lock(void * arg)
+  {
+    SharedPair * pair = static_cast<SharedPair *>(arg);
+    while (!detail::atomic_load(&pair->stop_))
+    {
+      ReadLockGuard<RWLock> guard(pair->rw_lock_);
+      if (pair->a_ != pair->b_)
+        detail::atomic_add(&pair->torn_, uint64_t(1));
+    }
+    return NULL;
+  }
+
+  void * read_under_seq_lock(void * arg)
+  {
+    SharedPair * pair = static_cast<SharedPair *>(arg);
+    while (!detail::atomic_load(&pair->stop_))
+    {
+      uint64_t a, b;
+      uint32_t sequence;
+      do
+      {
+        sequence = pair->seq_lock_.ReadBegin();
+        a = detail::atomic_load(&pair->a_);
+        b = detail::atomic_load(&pair->b_);
+      } while (pair->seq_lock_.ReadRetry(sequence));
+      if (a != b)
+        detail::atomic_add(&pair->torn_, uint64_t(1));
+    }
+    return NULL;
+  }
+
+  template <typename Lock>
+  void write_pair(SharedPair * pair, Lock * lock, void * (*reader)(void *))
+  {
+    pthread_t threads[SYNC_THREADS];
+    for (size_t i = 0; i < SYNC_THREADS; ++i)
+      pthread_create(&threads[i], NULL, reader, pair);
+
+    for (uint64_t i = 1; i <= SYNC_ITERATIONS; ++i)
+    {
+      LockGuard<Lock> guard(*lock);
+      detail::atomic_store(&pair->a_, i);
+      detail::atomic_store(&pair->b_, i);
+    }
+
+    detail::atomic_store(&pair->stop_, uint32_t(1));
+    for (size_t i = 0; i < SYNC_THREADS; ++i)
+      pthread_join(threads[i], NULL);
+  }
+
+  NKIT_TEST_CASE(threading_rw_lock)
+  {
+    SharedPair pair;
+    write_pair(&pair, &pair.rw_lock_, read_under_rw_lock);
+    NKIT_TEST_EQ(pair.torn_, uint64_t(0));
+    NKIT_TEST_EQ(pair.b_, uint64_t(SYNC_ITERATIONS));
+  }
+
+  NKIT_TEST_CASE(threading_seq_lock)
+  {
+    SharedPair pair;
+    write_pair(&pair, &pair.seq_lock_, read_under_seq_lock);
+    NKIT_TEST_EQ(pair.torn_, uint64_t(0));
+    NKIT_TEST_EQ(pair.b_, uint64_t(SYNC_ITERATIONS));
+  }
+
+  static Once once_ = NKIT_ONCE_INIT;
+  static volatile uint32_t once_calls_ = 0;
+
+  void count_once_call()
+  {
+    nkit::sleep(10); // other threads have to wait
+    detail::atomic_add(&once_calls_, uint32_t(1));
+  }
+
+  void * call_once(void *)
+  {
+    CallOnce(&once_, count_once_call);
+    return reinterpret_cast<void *>(
+        static_cast<size_t>(detail::atomic_load(&once_calls_)));
+  }
+
+  void add_to_context(void * context)
+  {
+    ++(*static_cast<size_t *>(context));
+  }
+
+  NKIT_TEST_CASE(threading_call_once)
+  {
+    pthread_t threads[SYNC_THREADS];
+    for (size_t i = 0; i < SYNC_THREADS; ++i)
+      pthread_create(&threads[i], NULL, call_once, NULL);
+    for (size_t i = 0; i < SYNC_THREADS; ++i)
+    {
+      void * calls = NULL;
+      pthread_join(threads[i], &calls);
+      // nobody returns before function is finished
+      NKIT_TEST_EQ(reinterpret_cast<size_t>(calls), size_t(1));
+    }
+    NKIT_TEST_EQ(once_calls_, uint32_t(1));
+
+    Once once = NKIT_ONCE_INIT;
+    size_t value = 0;
+    CallOnce(&once, add_to_context, &value);
+    CallOnce(&once, add_to_context, &value);
+    NKIT_TEST_EQ(value, size_t(1));
+  }
+
+  //---------------------------------------------------------------------------
+  struct MarkRange
+  {
+    explicit MarkRange(std::vector<uint32_t> * marks) : marks_(marks) {}
+
+    void operator() (size_t begin, size_t end) const
+    {
+      for (size_t i = begin; i < end; ++i)
+        detail::atomic_add(&(*marks_)[i], uint32_t(1));
+    }
+
+    std::vector<uint32_t> * marks_;
+  };
+
+  NKIT_TEST_CASE(threading_parallel_for)
+  {
+    ThreadPool::Options options;
+    options.threads = SYNC_THREADS;
+    options.pin_threads = true;
+    ThreadPool::Ptr pool = ThreadPool::Create(options);
+    NKIT_TEST_ASSERT(pool);
+    NKIT_TEST_EQ(pool->size(), SYNC_THREADS);
+
+    std::vector<uint32_t> marks(SYNC_ITERATIONS, 0);
+    ParallelFor(0, marks.size(), 1000, MarkRange(&marks), *pool);
+    for (size_t i = 0; i < marks.size(); ++i)
+      NKIT_TEST_EQ(marks[i], uint32_t(1));
+
+    ParallelFor(10, 20, 0, MarkRange(&marks), *pool);
+    ParallelFor(20, 20, 1, MarkRange(&marks), *pool);
+    NKIT_TEST_EQ(marks[9], uint32_t(1));
+    NKIT_TEST_EQ(marks[10], uint32_t(2));
+    NKIT_TEST_EQ(marks[19], uint32_t(2));
+    NKIT_TEST_EQ(marks[20], uint32_t(1));
+  }
+
+  class CountTask : public Task
+  {
+  public:
+    explicit CountTask(volatile uint64_t * count) : count_(count) {}
+
+    virtual void Run()
+    {
+      detail::atomic_add(count_, uint64_t(1));
+      delete this;
+    }
+
+  private:
+    volatile uint64_t * count_;
+  };
+
+  // Every level waits for its group inside pool thread
+  struct CountLeaves
+  {
+    CountLeaves(ThreadPool * pool, size_t depth, volatile uint64_t * leaves)
+      : pool_(pool), depth_(depth), leaves_(leaves)
+    {}
+
+    void operator() () const
+    {
+      if (!depth_)
+      {
+        detail::atomic_add(leaves_, uint64_t(1));
+        return;
+      }
+      TaskGroup group(*pool_);
+      group.Run(CountLeaves(pool_, depth_ - 1, leaves_));
+      group.Run(CountLeaves(pool_, depth_ - 1, leaves_));
+      group.Wait();
+    }
+
+    ThreadPool * pool_;
+    size_t depth_;
+    volatile uint64_t * leaves_;
+  };
+
+  NKIT_TEST_CASE(threading_task_group)
+  {
+    ThreadPool::Options options;
+    options.threads = 2;
+    ThreadPool::Ptr pool = ThreadPool::Create(options);
+    NKIT_TEST_ASSERT(pool);
+
+    volatile uint64_t count = 0;
+    {
+      TaskGroup group(*pool);
+      group.Run(CountLeaves(pool.get(), 12, &count));
+    }
+    NKIT_TEST_EQ(count, uint64_t(1) << 12);
+
+    // pool runs all submitted tasks before it is destroyed
+    count = 0;
+    for (size_t i = 0; i < 100; ++i)
+      pool->Submit(new CountTask(&count));
+    pool.reset();
+    NKIT_TEST_EQ(count, uint64_t(100));
+
+    NKIT_TEST_ASSERT(ThreadPool::Default().size() > 0);
+    std::string error;
+    NKIT_TEST_ASSERT(!ThreadPool::Configure(options, &error));
+    NKIT_TEST_ASSERT(!error.empty());
+  }
+#endif
+
 } // namespace nkit_test
@@ -2,6 +2,7 @@
 #include "nkit/test.h"
 #include "nkit/dynamic/dynamic_builder.h"
 #include "nkit/dynamic_xml.h"
+#include "nkit/output_sink.h"
 
 namespace nkit_test
 {
@@ -86,4 +87,149 @@ namespace nkit_test
     NKIT_TEST_EQ(out, etalon);
   }
 
+  //----------------------------------------------------------------------------
+  static bool append_to_string(const char * data, size_t size, void * context)
+  {
+    static_cast<std::string *>(context)->append(data, size);
+    return true;
+  }
+
+  static bool fail_write(const char *, size_t, void *)
+  {
+    return false;
+  }
+
+  NKIT_TEST_CASE(var2xml_sink)
+  {
+    Dynamic options = DDICT(
+         "rootname" << "ROOT"
+      << "itemname" << "row"
+      << "pretty" << DDICT("indent" << "  " << "newline" << "\n"));
+
+    std::string long_text;
+    for (size_t i = 0; i < 100; ++i)
+      long_text += "0123456789abc<>&\"'" + std::string(i % 13, 'x');
+
+    Dynamic data = Dynamic::List();
+    for (size_t i = 0; i < 2000; ++i)
+      data.PushBack(DDICT(
+             "$" << DDICT("id" << i)
+          << "name" << ("n\'" + string_cast(i) + "&")
+          << "text" << long_text
+          << "values" << DLIST(1 << 2.5 << true)));
+
+    std::string etalon, error;
+    NKIT_TEST_ASSERT_WITH_TEXT(Dynamic2XmlConverter::Process(
+        options, data, &etalon, &error), error);
+
+    std::string root_name;
+    Dynamic _data = DynamicFromAnyXml(etalon, options, &root_name, &error);
+    NKIT_TEST_ASSERT_WITH_TEXT(_data, error);
+    NKIT_TEST_EQ(_data["row"][1999]["text"][size_t(0)].GetString(), long_text);
+
+    // buffer much smaller than output and than some of texts
+    std::string out;
+    {
+      OutputSink sink(append_to_string, &out, 100);
+      NKIT_TEST_ASSERT_WITH_TEXT(Dynamic2XmlConverter::Process(
+          options, data, &sink, &error), error);
+    }
+    NKIT_TEST_EQ(out, etalon);
+
+    std::ostringstream stream;
+    {
+      OutputSink sink(&stream, 4096);
+      NKIT_TEST_ASSERT_WITH_TEXT(Dynamic2XmlConverter::Process(
+          options, data, &sink, &error), error);
+    }
+    NKIT_TEST_EQ(stream.str(), etalon);
+
+    OutputSink failed(fail_write, NULL, 100);
+    NKIT_TEST_ASSERT(!Dynamic2XmlConverter::Process(
+        options, data, &failed, &error));
+    NKIT_TEST_ASSERT(!error.empty());
+    NKIT_TEST_EQ(failed.error(),
+        std::string("Output write function has failed"));
+
+    // errno is reported for descriptors only
+    std::ostringstream bad_stream;
+    bad_stream.setstate(std::ios_base::badbit);
+    OutputSink stream_sink(&bad_stream, 100);
+    stream_sink.append("text");
+    errno = EINTR;
+    NKIT_TEST_ASSERT(!stream_sink.Flush());
+    NKIT_TEST_EQ(stream_sink.error(),
+        std::string("Could not write output to stream"));
+
+    OutputSink fd_sink(-1, 100);
+    fd_sink.append("text");
+    NKIT_TEST_ASSERT(!fd_sink.Flush());
+    NKIT_TEST_EQ(fd_sink.error(),
+        "Could not write output to file descriptor: " +
+        std::string(strerror(EBADF)));
+  }
+
+  //----------------------------------------------------------------------------
+  NKIT_TEST_CASE(var2xml_table)
+  {
+    Dynamic options = DDICT(
+         "rootname" << "ROOT"
+      << "itemname" << "row"
+      << "float_precision" << 3
+      << "cdata" << DLIST("c")
+      << "pretty" << DDICT("indent" << "  " << "newline" << "\n"));
+
+    std::string error;
+    Dynamic table = Dynamic::Table("s:STRING, i:INTEGER, f:FLOAT, b:BOOL,"
+        " d:DATE_TIME, c:STRING, _:STRING", &error);
+    NKIT_TEST_ASSERT_WITH_TEXT(error.empty(), error);
+    Dynamic date = Dynamic::DateTimeFromTimestamp(1400000000);
+    for (int64_t i = 0; i < 50; ++i)
+    {
+      DynamicVector row;
+      row.push_back(Dynamic("<a&b>'" + string_cast(i)));
+      row.push_back(Dynamic(-i));
+      row.push_back(Dynamic(i / 3.0));
+      row.push_back(Dynamic(i % 2 == 0));
+      row.push_back(date);
+      row.push_back(Dynamic(i % 5 ? "x]]>y" : ""));
+      row.push_back(Dynamic(i % 3 ? "text" : ""));
+      NKIT_TEST_ASSERT(table.AppendRow(row));
+    }
+
+    // same rows through generic Dynamic path
+    Dynamic rows = Dynamic::List();
+    StringVector names = table.GetColumnNames();
+    for (size_t row = 0; row < table.height(); ++row)
+    {
+      Dynamic dict = Dynamic::Dict();
+      for (size_t col = 0; col < table.width(); ++col)
+        dict[names[col]] = table.GetCellValue(row, col);
+      rows.PushBack(dict);
+    }
+
+    std::string table_xml, rows_xml;
+    NKIT_TEST_ASSERT_WITH_TEXT(Dynamic2XmlConverter::Process(
+        options, table, &table_xml, &error), error);
+    NKIT_TEST_ASSERT_WITH_TEXT(Dynamic2XmlConverter::Process(
+        options, rows, &rows_xml, &error), error);
+
+    std::string root_name;
+    Dynamic from_table = DynamicFromAnyXml(table_xml, options, &root_name,
+        &error);
+    NKIT_TEST_ASSERT_WITH_TEXT(from_table, error);
+    Dynamic from_rows = DynamicFromAnyXml(rows_xml, options, &root_name,
+        &error);
+    NKIT_TEST_ASSERT_WITH_TEXT(from_rows, error);
+    NKIT_TEST_EQ(from_table, from_rows);
+
+    // table as dict item
+    table_xml.clear();
+    NKIT_TEST_ASSERT_WITH_TEXT(Dynamic2XmlConverter::Process(
+        options, DDICT("t" << table), &table_xml, &error), error);
+    from_table = DynamicFromAnyXml(table_xml, options, &root_name, &error);
+    NKIT_TEST_ASSERT_WITH_TEXT(from_table, error);
+    NKIT_TEST_EQ(from_table["t"].size(), size_t(50));
+  }
+
 }  // namespace nkit_test
@@ -2,8 +2,12 @@
 #include "nkit/logger_brief.h"
 #include "nkit/dynamic/dynamic_builder.h"
 #include "nkit/dynamic_xml.h"
+#include "nkit/detail/str2id.h"
 #include "nkit/transcode.h"
 
+#include <cstring>
+#include <fcntl.h>
+
 namespace nkit_test
 {
   using namespace nkit;
@@ -46,6 +50,103 @@ namespace nkit_test
     NKIT_TEST_EQ(str_utf8, etalon_utf8);
   }
 
+  //---------------------------------------------------------------------------
+  NKIT_TEST_CASE(transcoder_bulk)
+  {
+    std::string utf8;
+    for (size_t i = 0; i < 50; ++i)
+      utf8 += "ASCII run of more than sixteen bytes " + string_cast(i) +
+          " Привет, мир! ёЁ" + std::string(i, 'x');
+
+    const char * encodings[] = { "WINDOWS-1251", "koi8-r", "cp866" };
+    for (size_t e = 0; e < sizeof(encodings) / sizeof(encodings[0]); ++e)
+    {
+      const Transcoder * transcoder = Transcoder::Find(encodings[e]);
+      NKIT_TEST_ASSERT_WITH_TEXT(transcoder, encodings[e]);
+
+      std::vector<char> single(utf8.size());
+      size_t single_size = 0;
+      NKIT_TEST_ASSERT(transcoder->FromUtf8(utf8.data(), utf8.size(),
+          &single[0], &single_size));
+      NKIT_TEST_ASSERT(single_size < utf8.size());
+
+      std::vector<char> back(single_size * Transcoder::MAX_UTF8_CHAR_SIZE);
+      size_t back_size = 0;
+      NKIT_TEST_ASSERT(transcoder->ToUtf8(&single[0], single_size, &back[0],
+          &back_size));
+      NKIT_TEST_EQ(std::string(&back[0], back_size), utf8);
+
+      std::string str;
+      NKIT_TEST_ASSERT(transcoder->FromUtf8(utf8, &str));
+      NKIT_TEST_EQ(str, std::string(&single[0], single_size));
+    }
+
+    const Transcoder * transcoder = Transcoder::Find("cp1251");
+    std::string str;
+    NKIT_TEST_ASSERT(!transcoder->FromUtf8("abc\xE4\xB8\xAD", &str));
+    NKIT_TEST_EQ(str, std::string("abc"));
+    NKIT_TEST_ASSERT(!transcoder->FromUtf8("\xD0", &str));
+    NKIT_TEST_ASSERT(!Transcoder::Find("no-such-encoding"));
+  }
+
+  //---------------------------------------------------------------------------
+  NKIT_TEST_CASE(str2id_lookup)
+  {
+    const size_t star = String2IdMap::STAR_ID;
+    String2IdMap str2id;
+    NKIT_TEST_EQ(str2id.size(), size_t(1));
+    NKIT_TEST_EQ(str2id.GetId("*"), star);
+    NKIT_TEST_EQ(str2id.GetString(star), std::string("*"));
+
+    // misses get next ids, hits return them back
+    size_t person = str2id.GetId("person");
+    size_t name = str2id.GetId("name");
+    NKIT_TEST_EQ(person, size_t(1));
+    NKIT_TEST_EQ(name, size_t(2));
+    NKIT_TEST_EQ(str2id.GetId("person"), person);
+    NKIT_TEST_EQ(str2id.GetId(std::string("name").c_str()), name);
+    NKIT_TEST_EQ(str2id.GetId("name_", 4), name);
+    NKIT_TEST_EQ(str2id.size(), size_t(3));
+
+    // empty string is a name as well
+    size_t empty = str2id.GetId("");
+    NKIT_TEST_EQ(empty, size_t(3));
+    NKIT_TEST_EQ(str2id.GetId("", 0), empty);
+    NKIT_TEST_EQ(str2id.GetString(empty), std::string());
+
+    // names with common prefixes differ
+    const char * prefixes[] = { "a", "ab", "abc", "abd", "abcd", "b",
+        "long_common_prefix_of_element_name_1",
+        "long_common_prefix_of_element_name_2",
+        "long_common_prefix_of_element_name_" };
+    const size_t PREFIX_COUNT = sizeof(prefixes) / sizeof(prefixes[0]);
+    size_t first = str2id.size();
+    for (size_t i = 0; i < PREFIX_COUNT; ++i)
+      NKIT_TEST_EQ(str2id.GetId(prefixes[i]), first + i);
+    for (size_t i = 0; i < PREFIX_COUNT; ++i)
+    {
+      NKIT_TEST_EQ(str2id.GetId(prefixes[i]), first + i);
+      NKIT_TEST_EQ(str2id.GetString(first + i), std::string(prefixes[i]));
+    }
+    NKIT_TEST_EQ(str2id.GetId("abcd", 3), str2id.GetId("abc"));
+
+    // unknown id
+    NKIT_TEST_EQ(str2id.GetString(str2id.size()), std::string());
+
+    // ids survive growth of the table
+    for (size_t i = 0; i < 1000; ++i)
+      NKIT_TEST_EQ(str2id.GetId(("element" + string_cast(i)).c_str()),
+          first + PREFIX_COUNT + i);
+    for (size_t i = 0; i < 1000; ++i)
+      NKIT_TEST_EQ(str2id.GetId(("element" + string_cast(i)).c_str()),
+          first + PREFIX_COUNT + i);
+    NKIT_TEST_EQ(str2id.GetId("person"), person);
+    NKIT_TEST_EQ(str2id.GetId(""), empty);
+    NKIT_TEST_EQ(str2id.GetId("*"), star);
+    NKIT_TEST_EQ(str2id.GetId("abd"), str2id.GetId("abd", 3));
+    NKIT_TEST_EQ(str2id.size(), first + PREFIX_COUNT + 1000);
+  }
+
   //---------------------------------------------------------------------------
   NKIT_TEST_CASE(xml2var_wrong_xml)
   {
@@ -138,6 +239,237 @@ namespace nkit_test
     NKIT_TEST_EQ(var, etalon);
   }
 
+  //---------------------------------------------------------------------------
+  struct StringStream
+  {
+    const std::string * data_;
+    size_t pos_;
+  };
+
+  // returns at most 7 bytes at a time to cross element boundaries
+  int64_t read_string_stream(char * buffer, size_t size, void * context,
+      std::string * NKIT_UNUSED(error))
+  {
+    StringStream * stream = static_cast<StringStream *>(context);
+    size_t rest = stream->data_->size() - stream->pos_;
+    size_t result = std::min(std::min(size, rest), size_t(7));
+    std::memcpy(buffer, stream->data_->data() + stream->pos_, result);
+    stream->pos_ += result;
+    return static_cast<int64_t>(result);
+  }
+
+  NKIT_TEST_CASE(xml2var_stream)
+  {
+    std::string error;
+    std::string xml_path("./data/sample.xml");
+    std::string xml;
+    NKIT_TEST_ASSERT_WITH_TEXT(
+        text_file_to_string(xml_path, &xml, &error), error);
+
+    std::string mapping("[\"/person\", {\"/name\": \"string\","
+        " \"/phone\": [\"/\", \"string\"]}]");
+    Dynamic etalon = DynamicFromXml(xml, mapping, &error);
+    NKIT_TEST_ASSERT_WITH_TEXT(etalon, error);
+
+    Dynamic var = DynamicFromXmlFile(xml_path, "{}", mapping, &error);
+    NKIT_TEST_ASSERT_WITH_TEXT(var, error);
+    NKIT_TEST_EQ(var, etalon);
+
+    StringStream stream = { &xml, 0 };
+    var = DynamicFromXmlStream(read_string_stream, &stream, "{}", mapping,
+        &error);
+    NKIT_TEST_ASSERT_WITH_TEXT(var, error);
+    NKIT_TEST_EQ(var, etalon);
+
+#if !defined(NKIT_WINNT)
+    int fd = open(xml_path.c_str(), O_RDONLY);
+    NKIT_TEST_ASSERT(fd >= 0);
+    var = DynamicFromXmlFd(fd, "{}", mapping, &error);
+    close(fd);
+    NKIT_TEST_ASSERT_WITH_TEXT(var, error);
+    NKIT_TEST_EQ(var, etalon);
+#endif
+
+    std::string root_name;
+    etalon = DynamicFromAnyXml(xml, "{}", &root_name, &error);
+    NKIT_TEST_ASSERT_WITH_TEXT(etalon, error);
+    stream.pos_ = 0;
+    var = DynamicFromAnyXmlStream(read_string_stream, &stream, "{}",
+        &root_name, &error);
+    NKIT_TEST_ASSERT_WITH_TEXT(var, error);
+    NKIT_TEST_EQ(var, etalon);
+
+    error.clear();
+    var = DynamicFromXmlFile("./data/no_such_file.xml", "{}", mapping,
+        &error);
+    NKIT_TEST_ASSERT(!var);
+    NKIT_TEST_ASSERT_WITH_TEXT(
+        error.find("./data/no_such_file.xml") != std::string::npos, error);
+  }
+
+  //---------------------------------------------------------------------------
+  struct RecordCollector
+  {
+    Dynamic records_;
+    size_t limit_;
+  };
+
+  bool collect_record(const Dynamic & record, void * context)
+  {
+    RecordCollector * collector = static_cast<RecordCollector *>(context);
+    collector->records_.PushBack(record);
+    return collector->records_.size() < collector->limit_;
+  }
+
+  NKIT_TEST_CASE(xml2var_record_callback)
+  {
+    std::string error;
+    std::string xml_path("./data/sample.xml");
+    std::string mapping("[\"/person\", {\"/name\": \"string\","
+        " \"/phone\": [\"/\", \"string\"]}]");
+    Dynamic etalon = DynamicFromXmlFile(xml_path, "{}", mapping, &error);
+    NKIT_TEST_ASSERT_WITH_TEXT(etalon && etalon.size() > 1, error);
+
+    RecordCollector collector = { Dynamic::List(), size_t(-1) };
+    NKIT_TEST_ASSERT_WITH_TEXT(DynamicXmlFileForEach(xml_path, "{}", mapping,
+        collect_record, &collector, &error), error);
+    NKIT_TEST_EQ(collector.records_, etalon);
+
+    collector.records_ = Dynamic::List();
+    collector.limit_ = 1;
+    NKIT_TEST_ASSERT(!DynamicXmlFileForEach(xml_path, "{}", mapping,
+        collect_record, &collector, &error));
+    NKIT_TEST_EQ(collector.records_.size(), size_t(1));
+    NKIT_TEST_EQ(collector.records_[(size_t)0], etalon[(size_t)0]);
+
+    error.clear();
+    NKIT_TEST_ASSERT(!DynamicXmlFileForEach(xml_path, "{}",
+        "{\"/person/name\": \"string\"}", collect_record, &collector,
+        &error));
+    NKIT_TEST_ASSERT(!error.empty());
+  }
+
+  //---------------------------------------------------------------------------
+  struct CompiledMappingJob
+  {
+    const std::string * xml_;
+    const DynamicXmlMapping * mapping_;
+    const Dynamic * etalon_;
+  };
+
+#if !defined(NKIT_WINNT)
+  void * parse_with_compiled_mapping(void * arg)
+  {
+    const CompiledMappingJob & job = *static_cast<CompiledMappingJob *>(arg);
+    for (size_t i = 0; i < 200; ++i)
+    {
+      std::string error;
+      Dynamic var = DynamicFromXml(*job.xml_, *job.mapping_, &error);
+      if (var != *job.etalon_)
+        abort_with_core("Wrong result of compiled mapping: " + error);
+    }
+    return NULL;
+  }
+#endif
+
+  NKIT_TEST_CASE(xml2var_compiled_mapping)
+  {
+    std::string error;
+    std::string xml_path("./data/sample.xml");
+    std::string xml;
+    NKIT_TEST_ASSERT_WITH_TEXT(
+        text_file_to_string(xml_path, &xml, &error), error);
+
+    std::string mapping_spec("[\"/person\", {\"/name\": \"string\","
+        " \"/nick\": \"string|none\", \"/phone\": [\"/\", \"string\"]}]");
+    Dynamic etalon = DynamicFromXml(xml, "{}", mapping_spec, &error);
+    NKIT_TEST_ASSERT_WITH_TEXT(etalon, error);
+
+    DynamicXmlMapping::Ptr mapping =
+        DynamicXmlMapping::Create("{}", mapping_spec, &error);
+    NKIT_TEST_ASSERT_WITH_TEXT(mapping, error);
+
+    Dynamic first = DynamicFromXml(xml, *mapping, &error);
+    NKIT_TEST_ASSERT_WITH_TEXT(first, error);
+    NKIT_TEST_EQ(first, etalon);
+
+    // failed document does not affect the next ones
+    NKIT_TEST_ASSERT(!DynamicFromXml("<a><person>", *mapping, &error));
+    NKIT_TEST_ASSERT(!error.empty());
+
+    Dynamic second = DynamicFromXmlFile(xml_path, *mapping, &error);
+    NKIT_TEST_ASSERT_WITH_TEXT(second, error);
+    NKIT_TEST_EQ(second, etalon);
+    NKIT_TEST_EQ(first, etalon);
+
+    NKIT_TEST_ASSERT(!DynamicXmlMapping::Create("{}", "\"string\"", &error));
+
+#if !defined(NKIT_WINNT)
+    etalon.Freeze();
+    CompiledMappingJob job = { &xml, mapping.get(), &etalon };
+    const size_t THREADS = 4;
+    pthread_t threads[THREADS];
+    for (size_t i = 0; i < THREADS; ++i)
+      pthread_create(&threads[i], NULL, parse_with_compiled_mapping, &job);
+    for (size_t i = 0; i < THREADS; ++i)
+      pthread_join(threads[i], NULL);
+#endif
+  }
+
+  //---------------------------------------------------------------------------
+  NKIT_TEST_CASE(xml2var_parallel)
+  {
+    std::string error;
+    std::string xml("<?xml version=\"1.0\"?>\n<!-- <fake> -->\n<records a=\"x>\">");
+    for (size_t i = 0; i < 1000; ++i)
+    {
+      std::string id(string_cast(i));
+      xml += "<record id=\"" + id + "\"><name>n" + id + "</name>"
+          "<![CDATA[</records>]]><?pi <x>?><empty/></record>\n";
+      if (i % 100 == 0)
+        xml += "<skipped/>";
+    }
+    xml += "</records>";
+
+    DynamicXmlMapping::Ptr mapping = DynamicXmlMapping::Create("{}",
+        "[\"/record\", {\"/@id\": \"integer\", \"/name\": \"string\"}]",
+        &error);
+    NKIT_TEST_ASSERT_WITH_TEXT(mapping, error);
+
+    Dynamic etalon = DynamicFromXml(xml, *mapping, &error);
+    NKIT_TEST_ASSERT_WITH_TEXT(etalon, error);
+    NKIT_TEST_ASSERT(etalon.size() == 1000);
+
+    const size_t threads[] = { 0, 1, 2, 3, 8 };
+    for (size_t i = 0; i < sizeof(threads) / sizeof(threads[0]); ++i)
+    {
+      Dynamic var = DynamicFromXmlParallel(xml, *mapping, threads[i], &error);
+      NKIT_TEST_ASSERT_WITH_TEXT(var, error);
+      NKIT_TEST_EQ(var, etalon);
+    }
+
+    // error in one of parts
+    std::string broken(xml);
+    broken.replace(broken.find("n700</name>"), 11, "n700</nam>");
+    NKIT_TEST_ASSERT(!DynamicFromXmlParallel(broken, *mapping, 4, &error));
+    NKIT_TEST_ASSERT(!error.empty());
+
+    std::string xml_path("./data/sample.xml");
+    mapping = DynamicXmlMapping::Create("{}",
+        "[\"/person\", {\"/name\": \"string\"}]", &error);
+    NKIT_TEST_ASSERT_WITH_TEXT(mapping, error);
+    etalon = DynamicFromXmlFile(xml_path, *mapping, &error);
+    NKIT_TEST_ASSERT_WITH_TEXT(etalon, error);
+    Dynamic var = DynamicFromXmlFileParallel(xml_path, *mapping, 4, &error);
+    NKIT_TEST_ASSERT_WITH_TEXT(var, error);
+    NKIT_TEST_EQ(var, etalon);
+
+    mapping = DynamicXmlMapping::Create("{}",
+        "{\"/record/name -> name\": \"string\"}", &error);
+    NKIT_TEST_ASSERT_WITH_TEXT(mapping, error);
+    NKIT_TEST_ASSERT(!DynamicFromXmlParallel(xml, *mapping, 4, &error));
+  }
+
   //---------------------------------------------------------------------------
   NKIT_TEST_CASE(xml2var_list_of_lists_with_mask)
   {
@@ -161,6 +493,112 @@ namespace nkit_test
     NKIT_TEST_EQ(var, etalon);
   }
 
+  //---------------------------------------------------------------------------
+  NKIT_TEST_CASE(xml2var_nested_masks)
+  {
+    std::string error;
+    std::string xml_path("./data/sample.xml");
+    std::string xml;
+    NKIT_TEST_ASSERT_WITH_TEXT(
+        text_file_to_string(xml_path, &xml, &error), error);
+
+    Dynamic mapping = DLIST("/person" << DLIST("/*/*" << "string"));
+    Dynamic var = DynamicFromXml(xml, mapping, &error);
+    NKIT_TEST_ASSERT_WITH_TEXT(var, error);
+
+    Dynamic etalon = DLIST(
+           DLIST("img1" << "img2" << "img3"
+               << "New York" << "Park Ave" << "1" << "1"
+               << "Boston" << "Centre St" << "33" << "24")
+        << DLIST("img3" << "img4"
+               << "Moscow" << "Kahovka" << "1" << "2"
+               << "Tula" << "Lenina" << "3" << "78"));
+    NKIT_TEST_EQ(var, etalon);
+
+    mapping = DLIST("/*/*/city" << "string");
+    var = DynamicFromXml(xml, mapping, &error);
+    NKIT_TEST_ASSERT_WITH_TEXT(var, error);
+    etalon = DLIST("New York" << "Boston" << "Moscow" << "Tula");
+    NKIT_TEST_EQ(var, etalon);
+  }
+
+  //---------------------------------------------------------------------------
+  NKIT_TEST_CASE(xml2var_table)
+  {
+    std::string error;
+    std::string xml_path("./data/sample.xml");
+    std::string xml;
+    NKIT_TEST_ASSERT_WITH_TEXT(
+        text_file_to_string(xml_path, &xml, &error), error);
+
+    Dynamic mapping = DLIST("/person" << "table" << DDICT(
+        "/name" << "string" <<
+        "/age" << "integer" <<
+        "/married/@firstTime -> first_time" << "boolean" <<
+        "/nick" << "string" <<
+        "/photos/ph -> ph" << "string|none"));
+
+    Dynamic var = DynamicFromXml(xml, mapping, &error);
+    NKIT_TEST_ASSERT_WITH_TEXT(var, error);
+    NKIT_TEST_ASSERT(var.IsTable());
+
+    StringVector column_names = var.GetColumnNames();
+    NKIT_TEST_EQ(join(column_names, ",", "", ""),
+        std::string("age,first_time,name,nick,ph"));
+    StringVector column_types = var.GetColumnTypes();
+    NKIT_TEST_EQ(join(column_types, ",", "", ""),
+        std::string("INTEGER,BOOL,STRING,STRING,STRING"));
+
+    NKIT_TEST_EQ(var.height(), size_t(2));
+    NKIT_TEST_EQ(var.GetCellValue(0, 0), Dynamic(33));
+    NKIT_TEST_EQ(var.GetCellValue(0, 1), Dynamic(false));
+    NKIT_TEST_EQ(var.GetCellValue(0, 2), Dynamic("Jack"));
+    NKIT_TEST_EQ(var.GetCellValue(0, 3), Dynamic(""));
+    NKIT_TEST_EQ(var.GetCellValue(0, 4), Dynamic("img3"));
+    NKIT_TEST_EQ(var.GetCellValue(1, 0), Dynamic(34));
+    NKIT_TEST_EQ(var.GetCellValue(1, 1), Dynamic(true));
+    NKIT_TEST_EQ(var.GetCellValue(1, 2), Dynamic("Boris"));
+    NKIT_TEST_EQ(var.GetCellValue(1, 4), Dynamic("none"));
+
+    mapping = DLIST("/person" << "table" << DDICT("/photos" << DLIST("/*"
+        << "string")));
+    NKIT_TEST_ASSERT(!DynamicFromXml(xml, mapping, &error));
+    NKIT_TEST_ASSERT(!error.empty());
+  }
+
+  //---------------------------------------------------------------------------
+  // Elements which match mask prefix are nested in each other and in
+  // elements which do not match it at all; state stack must follow them
+  NKIT_TEST_CASE(xml2var_unmatched_nested_masks)
+  {
+    std::string xml(
+        "<root>"
+          "<a><b><a><c>deep</c><a><c>deeper</c></a></a></b><c>1</c></a>"
+          "<d><e><c>other</c></e><c>2</c></d>"
+          "<a><a><a/></a><c>3</c></a>"
+          "<c>top</c>"
+        "</root>");
+    Dynamic etalon = DLIST("1" << "2" << "3");
+
+    std::string error;
+    Dynamic mapping = DLIST("/*/c" << "string");
+    Dynamic var = DynamicFromXml(xml, mapping, &error);
+    NKIT_TEST_ASSERT_WITH_TEXT(var, error);
+    NKIT_TEST_EQ(var, etalon);
+
+    // reused builder starts from clean stack after broken document
+    DynamicXmlMapping::Ptr compiled = DynamicXmlMapping::Create(Dynamic::Dict(),
+        mapping, &error);
+    NKIT_TEST_ASSERT_WITH_TEXT(compiled, error);
+    NKIT_TEST_ASSERT(!DynamicFromXml("<root><a><b><a>", *compiled, &error));
+    for (size_t i = 0; i < 2; ++i)
+    {
+      var = DynamicFromXml(xml, *compiled, &error);
+      NKIT_TEST_ASSERT_WITH_TEXT(var, error);
+      NKIT_TEST_EQ(var, etalon);
+    }
+  }
+
   //---------------------------------------------------------------------------
   NKIT_TEST_CASE(xml2var_list_of_objects_with_mask)
   {